@@ -1,7 +1,11 @@
 #include "AppDebug.h"
 
+#include "CRegex.h"
 #include "Project.h"
 #include "SourceFile.h"
+#include <DataIO.h>
+#include <File.h>
+#include <OS.h>
 #include <stdio.h>
 
 void
@@ -34,3 +38,93 @@ DumpIncludes(Project *proj)
 	for (int32 i = 0; i < proj->CountSystemIncludes(); i++)
 		printf("\t%s\n",proj->SystemIncludeAt(i));
 }
+
+
+static void
+PrintRate(const char *name, bigtime_t time, int32 bytes, int32 matches)
+{
+	double seconds = time / 1000000.0;
+	printf("\t%-22s %9.2fms %9.1f MB/s %8ld matches\n", name, time / 1000.0,
+			seconds > 0 ? bytes / seconds / (1024 * 1024) : 0.0, matches);
+}
+
+
+void
+TimeRegex(Project *proj)
+{
+	// All of the project's sources put together make the test corpus
+	BMallocIO corpus;
+	DPath folder(proj->GetPath().GetFolder());
+	for (int32 i = 0; i < proj->CountGroups(); i++)
+	{
+		SourceGroup *group = proj->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+		{
+			SourceFile *file = group->filelist.ItemAt(j);
+			BString path = file->MakeAbsolutePath(folder,
+				file->GetPath().GetFullPath());
+			
+			BFile source(path.String(), B_READ_ONLY);
+			off_t size;
+			if (source.InitCheck() != B_OK || source.GetSize(&size) != B_OK)
+				continue;
+			
+			char *data = new char[size];
+			ssize_t bytesRead = source.Read(data, size);
+			if (bytesRead > 0)
+				corpus.Write(data, bytesRead);
+			delete [] data;
+		}
+	}
+	
+	const char *text = (const char *)corpus.Buffer();
+	int32 length = corpus.BufferLength();
+	printf("Regular expression timings for project %s, %ld bytes of source:\n",
+			proj->GetName(), length);
+	if (length < 1)
+		return;
+	
+	const char *patterns[] = {
+		"^\\s*#\\s*include\\s*[<\"]([^>\"]+)",
+		"\\bB[A-Z][A-Za-z]+",
+		"([A-Za-z_][A-Za-z0-9_]*)\\s*\\(",
+		"\\s+$",
+		NULL
+	};
+	
+	for (int32 i = 0; patterns[i]; i++)
+	{
+		CRegexPattern pattern(patterns[i]);
+		if (pattern.InitCheck() != B_OK)
+			continue;
+		
+		printf("%s%s\n", patterns[i], pattern.IsJITCompiled() ? " (JIT)" : "");
+		
+		// One CRegex::Match() call per match, which is how the tools used
+		// to loop over a buffer
+		CRegex regex(patterns[i], false);
+		int32 matches = 0;
+		int32 offset = 0;
+		bigtime_t start = system_time();
+		while (offset <= length && regex.Match(text, length, offset) == B_OK)
+		{
+			matches++;
+			int32 end = regex.MatchStart() + regex.MatchLen();
+			offset = (end > offset) ? end : offset + 1;
+		}
+		PrintRate("CRegex::Match()", system_time() - start, length, matches);
+		
+		matches = 0;
+		start = system_time();
+		CRegexIterator iterator(pattern, text, length);
+		while (iterator.Next())
+			matches++;
+		PrintRate("CRegexIterator", system_time() - start, length, matches);
+		
+		BMallocIO output;
+		output.SetBlockSize(length + 1024);
+		start = system_time();
+		pattern.ReplaceAll(text, length, "<\\1>", output, &matches);
+		PrintRate("ReplaceAll()", system_time() - start, length, matches);
+	}
+}
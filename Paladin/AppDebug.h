@@ -5,5 +5,6 @@ class Project;
 
 void DumpDependencies(Project *proj);
 void DumpIncludes(Project *proj);
+void TimeRegex(Project *proj);
 
 #endif
@@ -0,0 +1,380 @@
+#include "BackgroundCompiler.h"
+
+#include <Autolock.h>
+#include <StringList.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "BuildInfo.h"
+#include "CommandRunner.h"
+#include "DebugTools.h"
+#include "FileHash.h"
+#include "Globals.h"
+#include "JobPool.h"
+#include "Project.h"
+#include "SourceFile.h"
+
+// How long a file has to be left alone before it is compiled. Editors may
+// write a file more than once when saving.
+#define SETTLE_TIME 1500000
+
+
+BackgroundCompiler::BackgroundCompiler(Project *project, const BMessenger &target)
+	:	fProject(project),
+		fTarget(target),
+		fLock("background compiler"),
+		fPending(20, true),
+		fThreads(NULL),
+		fThreadCount(0),
+		fPaused(false),
+		fQuitting(false)
+{
+	fWakeUp = create_sem(0, "background compiler wake up");
+
+	// Half of the build jobs is plenty for what is usually one file at a
+	// time. Commands started from these threads inherit their priority.
+	fThreadCount = MAX(BuildJobCount() / 2, 1);
+	fThreads = new thread_id[fThreadCount];
+	for (int32 i = 0; i < fThreadCount; i++)
+	{
+		fThreads[i] = spawn_thread(WorkerThread, "background compiler",
+			B_LOW_PRIORITY, this);
+		if (fThreads[i] >= 0 && resume_thread(fThreads[i]) != B_OK)
+			fThreads[i] = -1;
+	}
+}
+
+
+BackgroundCompiler::~BackgroundCompiler(void)
+{
+	fLock.Lock();
+	fQuitting = true;
+	for (int32 i = 0; i < fPending.CountItems(); i++)
+	{
+		pending_file *pending = fPending.ItemAt(i);
+		if (pending->commands)
+			pending->commands->Cancel();
+	}
+	fLock.Unlock();
+
+	release_sem_etc(fWakeUp, fThreadCount, 0);
+	for (int32 i = 0; i < fThreadCount; i++)
+	{
+		if (fThreads[i] < 0)
+			continue;
+
+		status_t result;
+		wait_for_thread(fThreads[i], &result);
+	}
+
+	delete [] fThreads;
+	delete_sem(fWakeUp);
+}
+
+
+void
+BackgroundCompiler::FileChanged(const char *path)
+{
+	if (!path)
+		return;
+
+	BStringList files;
+
+	fProject->Lock();
+	for (int32 i = 0; i < fProject->CountGroups(); i++)
+	{
+		SourceGroup *group = fProject->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+		{
+			SourceFile *file = group->filelist.ItemAt(j);
+			if (!file->CanCompileTo())
+				continue;
+
+			BString filePath(PathOf(file));
+			if (filePath == path || file->DependsOn(path))
+				files.Add(filePath);
+		}
+	}
+	fProject->Unlock();
+
+	for (int32 i = 0; i < files.CountStrings(); i++)
+		Queue(files.StringAt(i));
+}
+
+
+void
+BackgroundCompiler::FileRemoved(SourceFile *file)
+{
+	BString path(PathOf(file));
+
+	// A compile which is running still uses the file, so it is stopped and
+	// waited for
+	for (;;)
+	{
+		fLock.Lock();
+		pending_file *pending = FindPending(path);
+		if (!pending)
+		{
+			fLock.Unlock();
+			return;
+		}
+
+		if (!pending->commands)
+		{
+			delete fPending.RemoveItemAt(fPending.IndexOf(pending));
+			fLock.Unlock();
+			return;
+		}
+
+		pending->commands->Cancel();
+		fLock.Unlock();
+		snooze(10000);
+	}
+}
+
+
+void
+BackgroundCompiler::SetPaused(bool paused)
+{
+	BAutolock lock(fLock);
+	if (fPaused == paused)
+		return;
+
+	fPaused = paused;
+	if (!paused)
+	{
+		release_sem_etc(fWakeUp, fThreadCount, 0);
+		return;
+	}
+
+	// What is compiling now would only race the build for the same objects.
+	// Since this holds the lock, none of them can replace an object after
+	// this.
+	for (int32 i = 0; i < fPending.CountItems(); i++)
+	{
+		pending_file *pending = fPending.ItemAt(i);
+		if (pending->commands)
+			pending->commands->Cancel();
+	}
+}
+
+
+void
+BackgroundCompiler::Queue(const BString &path)
+{
+	BAutolock lock(fLock);
+	if (fQuitting)
+		return;
+
+	pending_file *pending = FindPending(path);
+	if (!pending)
+	{
+		pending = new pending_file;
+		pending->path = path;
+		pending->generation = 0;
+		pending->commands = NULL;
+		fPending.AddItem(pending);
+	}
+
+	pending->due = system_time() + SETTLE_TIME;
+	pending->generation++;
+
+	// What is being compiled now is out of date already
+	if (pending->commands)
+		pending->commands->Cancel();
+
+	STRACE(2,("Queued %s for a background compile\n", path.String()));
+	release_sem(fWakeUp);
+}
+
+
+BackgroundCompiler::pending_file *
+BackgroundCompiler::FindPending(const char *path) const
+{
+	for (int32 i = 0; i < fPending.CountItems(); i++)
+	{
+		pending_file *pending = fPending.ItemAt(i);
+		if (pending->path == path)
+			return pending;
+	}
+	return NULL;
+}
+
+
+BString
+BackgroundCompiler::PathOf(SourceFile *file) const
+{
+	BString path(file->GetPath().GetFullPath());
+	if (path[0] != '/')
+	{
+		path.Prepend("/");
+		path.Prepend(fProject->GetPath().GetFolder());
+	}
+	return path;
+}
+
+
+SourceFile *
+BackgroundCompiler::FindFile(const char *path) const
+{
+	// Must be called with the project locked
+	for (int32 i = 0; i < fProject->CountGroups(); i++)
+	{
+		SourceGroup *group = fProject->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+		{
+			SourceFile *file = group->filelist.ItemAt(j);
+			if (file->CanCompileTo() && PathOf(file) == path)
+				return file;
+		}
+	}
+	return NULL;
+}
+
+
+BackgroundCompiler::pending_file *
+BackgroundCompiler::NextDue(bigtime_t &wait)
+{
+	wait = B_INFINITE_TIMEOUT;
+	if (fPaused)
+		return NULL;
+
+	bigtime_t now = system_time();
+	for (int32 i = 0; i < fPending.CountItems(); i++)
+	{
+		pending_file *pending = fPending.ItemAt(i);
+		if (pending->commands)
+			continue;
+
+		if (pending->due <= now)
+			return pending;
+
+		wait = MIN(wait, pending->due - now);
+	}
+	return NULL;
+}
+
+
+void
+BackgroundCompiler::Compile(pending_file *pending, int32 generation,
+							CommandGroup &commands)
+{
+	// The file is looked up again since it may have left the project while
+	// it waited. Once it is compiling, FileRemoved() waits for it.
+	const BString &path = pending->path;
+	fProject->Lock();
+	SourceFile *file = FindFile(path.String());
+	BuildInfo info;
+	info.CopySettings(*fProject->GetBuildInfo());
+	BString options = fProject->GetCompileOptions();
+	fProject->Unlock();
+
+	if (!file)
+		return;
+
+	struct stat before;
+	uint64 hashBefore;
+	if (stat(path.String(), &before) != 0
+		|| HashFile(path.String(), &hashBefore) != B_OK)
+		return;
+
+	BString object(file->GetObjectPath(info).GetFullPath());
+	BString temp(object);
+	temp << ".background";
+
+	STRACE(1,("Compiling %s in the background\n", path.String()));
+	{
+		JobSlot slot(gJobPool);
+		file->CompileTo(info, options.String(), temp.String());
+	}
+
+	// A change to the file after it was read is caught here, one while the
+	// compiler ran by the generation having changed
+	bool keep = !commands.IsCanceled() && info.errorList.CountErrors() == 0;
+	if (keep)
+	{
+		struct stat after;
+		uint64 hashAfter;
+		keep = stat(path.String(), &after) == 0
+			&& after.st_mtime == before.st_mtime
+			&& after.st_size == before.st_size
+			&& HashFile(path.String(), &hashAfter) == B_OK
+			&& hashAfter == hashBefore;
+	}
+
+	// A build which started in the meantime builds the file itself. The
+	// project is locked as a build takes its snapshot with it held.
+	fProject->Lock();
+	fLock.Lock();
+	bool replaced = keep && !fPaused && pending->generation == generation
+		&& rename(temp.String(), object.String()) == 0;
+	if (replaced)
+		file->UpdateModTime();
+	fLock.Unlock();
+	fProject->Unlock();
+
+	if (!replaced)
+	{
+		unlink(temp.String());
+		STRACE(1,("Discarded the background compile of %s\n", path.String()));
+		return;
+	}
+
+	BMessage message(M_BACKGROUND_COMPILED);
+	message.AddString("path", path);
+	fTarget.SendMessage(&message);
+}
+
+
+int32
+BackgroundCompiler::WorkerThread(void *data)
+{
+	BackgroundCompiler *compiler = (BackgroundCompiler*)data;
+
+	// Lets a newer save stop the compiler instead of waiting for it
+	CommandGroup commands;
+	CommandGroup::SetThreadGroup(&commands);
+
+	for (;;)
+	{
+		compiler->fLock.Lock();
+		if (compiler->fQuitting)
+		{
+			compiler->fLock.Unlock();
+			break;
+		}
+
+		bigtime_t wait;
+		int32 generation = 0;
+		pending_file *pending = compiler->NextDue(wait);
+		if (pending)
+		{
+			pending->commands = &commands;
+			generation = pending->generation;
+		}
+		compiler->fLock.Unlock();
+
+		if (!pending)
+		{
+			acquire_sem_etc(compiler->fWakeUp, 1, B_RELATIVE_TIMEOUT, wait);
+			continue;
+		}
+
+		compiler->Compile(pending, generation, commands);
+
+		// Saved again in the meantime, so it is compiled once more when it
+		// settles. Otherwise it is done, one way or the other.
+		compiler->fLock.Lock();
+		pending->commands = NULL;
+		if (pending->generation == generation)
+			delete compiler->fPending.RemoveItemAt(compiler->fPending.IndexOf(pending));
+		compiler->fLock.Unlock();
+
+		// Nothing can cancel the group any more until it is handed out again
+		commands.Reset();
+	}
+
+	CommandGroup::SetThreadGroup(NULL);
+	return 0;
+}
@@ -0,0 +1,84 @@
+#ifndef BACKGROUND_COMPILER_H
+#define BACKGROUND_COMPILER_H
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+#include <String.h>
+
+#include "ObjectList.h"
+
+class CommandGroup;
+class Project;
+class SourceFile;
+
+enum
+{
+	M_BACKGROUND_COMPILED = 'bgcd'
+};
+
+// Compiles a project's files soon after they are saved, so that the next
+// build finds their objects up to date and only has to link. A file is
+// compiled once it has been left alone for a moment, by low priority
+// threads which share the job pool with the builds.
+//
+// Each file is compiled into a temporary object first. It only replaces the
+// real one if the compile worked and the file didn't change while it ran;
+// otherwise it is thrown away and the build does the work as usual. Errors
+// are left for the build to report. M_BACKGROUND_COMPILED is sent to the
+// target with the "path" of each file whose object was replaced.
+class BackgroundCompiler
+{
+public:
+							BackgroundCompiler(Project *project,
+												const BMessenger &target);
+							~BackgroundCompiler(void);
+
+			// A file was written. Source files are queued themselves, and
+			// headers queue the project's files which include them.
+			void			FileChanged(const char *path);
+
+			// Must be called before a file is removed from the project.
+			// Returns once nothing uses the file any more.
+			void			FileRemoved(SourceFile *file);
+
+			// The absolute path a file is queued and reported by
+			BString			PathOf(SourceFile *file) const;
+
+			// While a build runs nothing new is started, so that the two
+			// don't compete for the same files. Pausing stops the compiles
+			// which are running.
+			void			SetPaused(bool paused);
+
+private:
+	struct pending_file
+	{
+		BString			path;
+		bigtime_t		due;
+		int32			generation;
+		CommandGroup	*commands;
+	};
+
+			void			Queue(const BString &path);
+			pending_file *	FindPending(const char *path) const;
+			SourceFile *	FindFile(const char *path) const;
+
+			// Returns a file which is due, or the time until the next one
+			// is in wait
+			pending_file *	NextDue(bigtime_t &wait);
+			void			Compile(pending_file *pending, int32 generation,
+									CommandGroup &commands);
+	static	int32			WorkerThread(void *data);
+
+			Project			*fProject;
+			BMessenger		fTarget;
+			BLocker			fLock;
+			sem_id			fWakeUp;
+			BObjectList<pending_file>	fPending;
+			thread_id		*fThreads;
+			int32			fThreadCount;
+			bool			fPaused;
+			bool			fQuitting;
+};
+
+#endif
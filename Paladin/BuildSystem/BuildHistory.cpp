@@ -0,0 +1,214 @@
+#include "BuildHistory.h"
+
+#include <Autolock.h>
+#include <File.h>
+#include <stdio.h>
+
+#include "DebugTools.h"
+#include "TextFile.h"
+
+#define HISTORY_NAME "BuildHistory"
+#define HISTORY_HEADER "# Paladin build history 2"
+
+BuildHistory::BuildHistory(void)
+	:	fLock("build history"),
+		fTotalRSS(0),
+		fMeasuredCount(0),
+		fTotalDuration(0),
+		fTimedCount(0),
+		fDirty(false)
+{
+}
+
+
+status_t
+BuildHistory::Load(const char *objectFolder)
+{
+	if (!objectFolder)
+		return B_BAD_VALUE;
+
+	BAutolock lock(fLock);
+	fPath = objectFolder;
+	fPath << "/" << HISTORY_NAME;
+	fEntries.clear();
+	fTotalRSS = 0;
+	fMeasuredCount = 0;
+	fTotalDuration = 0;
+	fTimedCount = 0;
+	fDirty = false;
+
+	TextFile file(fPath.String(), B_READ_ONLY);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+
+	const char *start;
+	int32 length;
+	
+	// A history from another version is simply started over
+	if (!file.NextLine(start, length) || BString(start, length) != HISTORY_HEADER)
+		return B_OK;
+	
+	while (file.NextLine(start, length))
+	{
+		BString line(start, length);
+		if (line.CountChars() < 1 || line[0] == '#')
+			continue;
+
+		// "<peak RSS>\t<duration>\t<failed>\t<path>". The path comes last
+		// because it may contain spaces.
+		long long peakRSS, duration;
+		int failed, pathStart;
+		if (sscanf(line.String(), "%lld\t%lld\t%d\t%n", &peakRSS, &duration,
+				&failed, &pathStart) != 3 || peakRSS < 0 || duration < 0
+			|| pathStart >= line.Length())
+			continue;
+
+		history_entry entry;
+		entry.peakRSS = (off_t)peakRSS;
+		entry.duration = (bigtime_t)duration;
+		entry.failed = failed != 0;
+		fEntries[BString(line.String() + pathStart)] = entry;
+		
+		if (entry.peakRSS > 0)
+		{
+			fTotalRSS += entry.peakRSS;
+			fMeasuredCount++;
+		}
+		if (entry.duration > 0)
+		{
+			fTotalDuration += entry.duration;
+			fTimedCount++;
+		}
+	}
+
+	return B_OK;
+}
+
+
+status_t
+BuildHistory::Save(void)
+{
+	BAutolock lock(fLock);
+	if (fPath.CountChars() < 1)
+		return B_NO_INIT;
+
+	if (!fDirty)
+		return B_OK;
+
+	BString data(HISTORY_HEADER);
+	data << "\n";
+
+	char numbers[64];
+	for (EntryMap::const_iterator i = fEntries.begin(); i != fEntries.end(); i++)
+	{
+		sprintf(numbers, "%lld\t%lld\t%d\t", (long long)i->second.peakRSS,
+			(long long)i->second.duration, i->second.failed ? 1 : 0);
+		data << numbers << i->first << "\n";
+	}
+
+	BFile file(fPath.String(), B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+
+	ssize_t written = file.Write(data.String(), data.Length());
+	if (written != data.Length())
+		return B_IO_ERROR;
+
+	fDirty = false;
+	return B_OK;
+}
+
+
+off_t
+BuildHistory::PredictMemory(const char *path)
+{
+	BAutolock lock(fLock);
+	if (fMeasuredCount == 0)
+		return 0;
+
+	EntryMap::const_iterator i = fEntries.find(BString(path));
+	if (i != fEntries.end() && i->second.peakRSS > 0)
+		return i->second.peakRSS;
+
+	return fTotalRSS / fMeasuredCount;
+}
+
+
+void
+BuildHistory::RecordMemory(const char *path, off_t peakRSS)
+{
+	// Nothing was measured, e.g. because the command couldn't be started
+	if (!path || peakRSS <= 0)
+		return;
+
+	BAutolock lock(fLock);
+	history_entry &entry = fEntries[BString(path)];
+	off_t old = entry.peakRSS;
+	if (peakRSS >= old)
+		entry.peakRSS = peakRSS;
+	else
+		entry.peakRSS = old - (old - peakRSS) / 4;
+
+	if (entry.peakRSS != old)
+	{
+		if (old == 0)
+			fMeasuredCount++;
+		fTotalRSS += entry.peakRSS - old;
+		fDirty = true;
+		STRACE(2,("%s peaked at %lld KB\n", path, (long long)peakRSS / 1024));
+	}
+}
+
+
+bigtime_t
+BuildHistory::PredictDuration(const char *path)
+{
+	BAutolock lock(fLock);
+	if (fTimedCount == 0)
+		return 0;
+
+	EntryMap::const_iterator i = fEntries.find(BString(path));
+	if (i != fEntries.end() && i->second.duration > 0)
+		return i->second.duration;
+
+	return fTotalDuration / fTimedCount;
+}
+
+
+bool
+BuildHistory::Failed(const char *path)
+{
+	BAutolock lock(fLock);
+	EntryMap::const_iterator i = fEntries.find(BString(path));
+	return i != fEntries.end() && i->second.failed;
+}
+
+
+void
+BuildHistory::RecordBuild(const char *path, bigtime_t duration, bool failed)
+{
+	if (!path)
+		return;
+
+	BAutolock lock(fLock);
+	history_entry &entry = fEntries[BString(path)];
+	if (entry.failed != failed)
+	{
+		entry.failed = failed;
+		fDirty = true;
+	}
+
+	if (failed || duration <= 0)
+		return;
+
+	// Build times vary from one run to the next, so average with the last
+	bigtime_t old = entry.duration;
+	entry.duration = old > 0 ? (old + duration) / 2 : duration;
+	if (entry.duration == old)
+		return;
+
+	if (old == 0)
+		fTimedCount++;
+	fTotalDuration += entry.duration - old;
+	fDirty = true;
+}
@@ -0,0 +1,62 @@
+#ifndef BUILD_HISTORY_H
+#define BUILD_HISTORY_H
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+#include <map>
+
+// What earlier builds of a project have learned about its files. It is kept
+// in the objects folder so that it goes away with a clean build, and only
+// saved when something changed.
+class BuildHistory
+{
+public:
+						BuildHistory(void);
+
+			status_t	Load(const char *objectFolder);
+			status_t	Save(void);
+
+	// The most memory compiling the file is expected to take. Files which
+	// haven't been built before are expected to need as much as the average
+	// of the others. 0 when nothing is known at all.
+			off_t		PredictMemory(const char *path);
+
+	// Remembers the peak resident size of a build of the file. A new high is
+	// taken as is, but a lower one only pulls the old value down slowly, so
+	// a single small build doesn't undo what was learned.
+			void		RecordMemory(const char *path, off_t peakRSS);
+
+	// How long building the file is expected to take, guessed the same way
+	// as its memory
+			bigtime_t	PredictDuration(const char *path);
+
+	// Whether the last build of the file had errors
+			bool		Failed(const char *path);
+
+	// The time is only kept from builds which worked, since one with errors
+	// usually stops early
+			void		RecordBuild(const char *path, bigtime_t duration,
+									bool failed);
+
+private:
+	struct history_entry
+	{
+		off_t		peakRSS;
+		bigtime_t	duration;
+		bool		failed;
+	};
+
+	typedef std::map<BString, history_entry>	EntryMap;
+
+	BLocker			fLock;
+	BString			fPath;
+	EntryMap		fEntries;
+	off_t			fTotalRSS;
+	int32			fMeasuredCount;
+	bigtime_t		fTotalDuration;
+	int32			fTimedCount;
+	bool			fDirty;
+};
+
+#endif
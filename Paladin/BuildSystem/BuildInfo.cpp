@@ -4,3 +4,18 @@ BuildInfo::BuildInfo(void)
 	:	includeList(20,true)
 {
 }
+
+
+void
+BuildInfo::CopySettings(const BuildInfo &from)
+{
+	projectFolder = from.projectFolder;
+	objectFolder = from.objectFolder;
+	
+	includeList.MakeEmpty();
+	for (int32 i = 0; i < from.includeList.CountItems(); i++)
+		includeList.AddItem(new ProjectPath(*from.includeList.ItemAt(i)));
+	includeString = from.includeString;
+	
+	errorList.msglist.MakeEmpty();
+}
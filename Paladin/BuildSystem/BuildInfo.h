@@ -13,6 +13,10 @@ class BuildInfo
 public:
 							BuildInfo(void);
 	
+			// Takes the folders and include paths of another BuildInfo, but
+			// not its messages, so a build thread can have its own
+			void			CopySettings(const BuildInfo &from);
+	
 	DPath					projectFolder;
 	DPath					objectFolder;
 	
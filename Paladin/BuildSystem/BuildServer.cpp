@@ -0,0 +1,714 @@
+#include "BuildServer.h"
+
+#include <Autolock.h>
+#include <Catalog.h>
+#include <Entry.h>
+#include <FindDirectory.h>
+#include <Locale.h>
+#include <Looper.h>
+#include <Message.h>
+#include <Messenger.h>
+#include <Path.h>
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "DebugTools.h"
+#include "DPath.h"
+#include "ErrorParser.h"
+#include "Globals.h"
+#include "Project.h"
+#include "ProjectBuilder.h"
+#include "SourceFile.h"
+#include "StatCache.h"
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "BuildServer"
+
+// Messages bigger than this are not something a client would send
+#define MAX_MESSAGE_SIZE (1024 * 1024)
+
+
+static status_t
+write_all(int fd, const void *data, size_t size)
+{
+	const char *buffer = (const char*)data;
+	while (size > 0)
+	{
+		ssize_t written = write(fd, buffer, size);
+		if (written < 0 && errno == EINTR)
+			continue;
+		if (written <= 0)
+			return B_IO_ERROR;
+
+		buffer += written;
+		size -= written;
+	}
+	return B_OK;
+}
+
+
+static status_t
+read_all(int fd, void *data, size_t size)
+{
+	char *buffer = (char*)data;
+	while (size > 0)
+	{
+		ssize_t bytesRead = read(fd, buffer, size);
+		if (bytesRead < 0 && errno == EINTR)
+			continue;
+		if (bytesRead <= 0)
+			return B_IO_ERROR;
+
+		buffer += bytesRead;
+		size -= bytesRead;
+	}
+	return B_OK;
+}
+
+
+// Messages go over the socket flattened, each after its size
+static status_t
+send_message(int fd, const BMessage &msg)
+{
+	int32 size = msg.FlattenedSize();
+	char *buffer = new char[size];
+	status_t status = msg.Flatten(buffer, size);
+	if (status == B_OK)
+		status = write_all(fd, &size, sizeof(size));
+	if (status == B_OK)
+		status = write_all(fd, buffer, size);
+	delete [] buffer;
+	return status;
+}
+
+
+static status_t
+receive_message(int fd, BMessage &msg)
+{
+	int32 size;
+	status_t status = read_all(fd, &size, sizeof(size));
+	if (status != B_OK)
+		return status;
+
+	if (size <= 0 || size > MAX_MESSAGE_SIZE)
+		return B_BAD_DATA;
+
+	char *buffer = new char[size];
+	status = read_all(fd, buffer, size);
+	if (status == B_OK)
+		status = msg.Unflatten(buffer);
+	delete [] buffer;
+	return status;
+}
+
+
+static int
+connect_to(const char *path)
+{
+	struct sockaddr_un address;
+	if (strlen(path) >= sizeof(address.sun_path))
+		return -1;
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0)
+		return -1;
+
+	if (connect(fd, (struct sockaddr*)&address, sizeof(address)) != 0)
+	{
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+
+// Receives a builder's messages and passes what "Paladin -b" would have
+// printed on to the client
+class ServerOutput : public BLooper
+{
+public:
+							ServerOutput(int socket);
+							~ServerOutput(void);
+
+			void			MessageReceived(BMessage *msg);
+
+	// Ends the wait for the build without it having finished
+			void			Stop(void);
+
+			sem_id			Finished(void) const { return fFinished; }
+			int				Status(void) const { return fStatus; }
+			bool			ClientGone(void) const { return fClientGone; }
+
+private:
+			void			Print(const BString &text);
+			void			Finish(int status);
+
+	int						fSocket;
+	sem_id					fFinished;
+	int32					fDone;
+	int						fStatus;
+	bool					fClientGone;
+};
+
+
+ServerOutput::ServerOutput(int socket)
+	:	BLooper("build server output"),
+		fSocket(socket),
+		fDone(0),
+		fStatus(-1),
+		fClientGone(false)
+{
+	fFinished = create_sem(0, "build finished");
+}
+
+
+ServerOutput::~ServerOutput(void)
+{
+	delete_sem(fFinished);
+}
+
+
+void
+ServerOutput::MessageReceived(BMessage *msg)
+{
+	// Whatever comes after the end of the build is of no interest
+	if (atomic_get(&fDone) != 0)
+		return;
+
+	switch (msg->what)
+	{
+		case M_BUILDING_FILE:
+		{
+			SourceFile *file;
+			if (msg->FindPointer("sourcefile", (void**)&file) != B_OK)
+				break;
+
+			BString text;
+			text.SetToFormat(B_TRANSLATE("Building %s\n"),
+				file->GetPath().GetFileName());
+			Print(text);
+			break;
+		}
+
+		case M_LINKING_PROJECT:
+		{
+			Print(B_TRANSLATE("Linking\n"));
+			break;
+		}
+
+		case M_UPDATING_RESOURCES:
+		{
+			Print(B_TRANSLATE("Updating resources\n"));
+			break;
+		}
+
+		case M_BUILD_WARNINGS:
+		{
+			BString errstr;
+			if (msg->FindString("errstr", &errstr) == B_OK)
+				Print(errstr << "\n");
+			break;
+		}
+
+		case M_BUILD_FAILURE:
+		{
+			BString errstr;
+			if (msg->FindString("errstr", &errstr) == B_OK)
+				Print(errstr << "\n");
+			else
+			{
+				ErrorList errors;
+				errors.Unflatten(*msg);
+				BString text;
+				text.SetToFormat(B_TRANSLATE("Build failure\n%s"),
+					errors.AsString().String());
+				Print(text);
+			}
+			Finish(-1);
+			break;
+		}
+
+		case M_BUILD_SUCCESS:
+		{
+			Print(B_TRANSLATE("Success\n"));
+			Finish(0);
+			break;
+		}
+
+		default:
+			BLooper::MessageReceived(msg);
+	}
+}
+
+
+void
+ServerOutput::Stop(void)
+{
+	Finish(-1);
+}
+
+
+void
+ServerOutput::Print(const BString &text)
+{
+	BMessage msg(M_SERVER_OUTPUT);
+	msg.AddString("text", text);
+	if (send_message(fSocket, msg) != B_OK)
+	{
+		// There is no one left to build for
+		STRACE(1,("Build server client went away\n"));
+		fClientGone = true;
+		Finish(-1);
+	}
+}
+
+
+void
+ServerOutput::Finish(int status)
+{
+	if (atomic_test_and_set(&fDone, 1, 0) != 0)
+		return;
+
+	fStatus = status;
+	release_sem(fFinished);
+}
+
+
+BuildServer::BuildServer(void)
+	:	fSocket(-1),
+		fListenThread(-1),
+		fLock("build server"),
+		fProjects(20, true),
+		fConnections(20, true),
+		fQuitting(false)
+{
+}
+
+
+BuildServer::~BuildServer(void)
+{
+	fLock.Lock();
+	fQuitting = true;
+
+	// Builds still running are stopped and their clients told so
+	for (int32 i = 0; i < fConnections.CountItems(); i++)
+	{
+		server_connection *connection = fConnections.ItemAt(i);
+		if (connection->output)
+			connection->output->Stop();
+		if (connection->builder)
+			connection->builder->QuitBuild();
+		else
+		{
+			// Still waiting for the request
+			shutdown(connection->socket, SHUT_RDWR);
+		}
+	}
+	fLock.Unlock();
+
+	if (fListenThread >= 0)
+	{
+		// Wakes the listening thread up, which then sees that it is done
+		int fd = connect_to(fPath.String());
+		if (fd >= 0)
+			close(fd);
+
+		status_t result;
+		wait_for_thread(fListenThread, &result);
+	}
+
+	// The connections take themselves out of the list as they finish
+	for (;;)
+	{
+		fLock.Lock();
+		server_connection *connection = fConnections.ItemAt(0);
+		thread_id thread = connection ? connection->thread : -1;
+		fLock.Unlock();
+
+		if (!connection)
+			break;
+
+		status_t result;
+		wait_for_thread(thread, &result);
+	}
+
+	if (fSocket >= 0)
+	{
+		close(fSocket);
+		unlink(fPath.String());
+	}
+
+	for (int32 i = 0; i < fProjects.CountItems(); i++)
+		delete fProjects.ItemAt(i)->project;
+}
+
+
+status_t
+BuildServer::Start(const char *path)
+{
+	if (!path)
+		return B_BAD_VALUE;
+
+	struct sockaddr_un address;
+	if (strlen(path) >= sizeof(address.sun_path))
+		return B_NAME_TOO_LONG;
+
+	// A socket nobody answers on is left over from a server which didn't
+	// quit properly
+	int existing = connect_to(path);
+	if (existing >= 0)
+	{
+		close(existing);
+		return B_BUSY;
+	}
+	unlink(path);
+
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, path);
+
+	fSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fSocket < 0)
+		return errno;
+
+	// Only the user who started the server may build with it
+	mode_t mask = umask(0077);
+	int result = bind(fSocket, (struct sockaddr*)&address, sizeof(address));
+	umask(mask);
+
+	if (result != 0 || listen(fSocket, 16) != 0)
+	{
+		status_t status = errno;
+		close(fSocket);
+		fSocket = -1;
+		return status;
+	}
+	fPath = path;
+
+	// A client going away in the middle of a build shows up as a failed
+	// write instead of ending the server
+	signal(SIGPIPE, SIG_IGN);
+
+	fListenThread = spawn_thread(ListenThread, "build server", B_NORMAL_PRIORITY,
+								this);
+	if (fListenThread < 0)
+		return fListenThread;
+
+	return resume_thread(fListenThread);
+}
+
+
+BString
+BuildServer::DefaultPath(void)
+{
+	const char *path = getenv("PALADIN_BUILD_SERVER");
+	if (path && strlen(path) > 0)
+		return BString(path);
+
+	DPath socketPath(B_SYSTEM_TEMP_DIRECTORY);
+	BString name;
+	name << "Paladin_build_server_" << (int32)getuid();
+	socketPath << name.String();
+	return BString(socketPath.GetFullPath());
+}
+
+
+status_t
+BuildServer::RunClient(int32 argc, char **argv, int &status)
+{
+	BMessage request(M_SERVER_BUILD);
+
+	int32 count = 0;
+	for (int32 i = 0; i < argc; i++)
+	{
+		BString arg(argv[i]);
+		if (arg == "-r")
+		{
+			request.AddBool("rebuild", true);
+			continue;
+		}
+
+		// Other options, workspaces and projects which have to be looked
+		// for are left to a build of its own
+		if (arg[0] == '-' || arg.EndsWith(".plw"))
+			return B_BAD_VALUE;
+
+		if (!arg.EndsWith(".pld"))
+			arg << ".pld";
+
+		// The server knows its projects by their normalized path
+		BEntry entry(arg.String());
+		BPath path;
+		if (!entry.Exists() || entry.GetPath(&path) != B_OK)
+			return B_ENTRY_NOT_FOUND;
+
+		request.AddString("path", path.Path());
+		count++;
+	}
+
+	if (count < 1)
+		return B_BAD_VALUE;
+
+	int fd = connect_to(DefaultPath().String());
+	if (fd < 0)
+		return B_NAME_NOT_FOUND;
+
+	if (send_message(fd, request) != B_OK)
+	{
+		close(fd);
+		return B_IO_ERROR;
+	}
+
+	// From here on the build belongs to the server
+	status = -1;
+	BMessage reply;
+	while (receive_message(fd, reply) == B_OK)
+	{
+		if (reply.what == M_SERVER_OUTPUT)
+		{
+			BString text;
+			if (reply.FindString("text", &text) == B_OK)
+			{
+				fputs(text.String(), stdout);
+				fflush(stdout);
+			}
+		}
+		else if (reply.what == M_SERVER_DONE)
+		{
+			int32 result;
+			if (reply.FindInt32("status", &result) == B_OK)
+				status = result;
+			close(fd);
+			return B_OK;
+		}
+	}
+
+	fprintf(stderr, B_TRANSLATE("Lost the connection to the build server\n"));
+	close(fd);
+	return B_OK;
+}
+
+
+BuildServer::server_project *
+BuildServer::ProjectFor(const char *path)
+{
+	BAutolock lock(fLock);
+	for (int32 i = 0; i < fProjects.CountItems(); i++)
+	{
+		server_project *entry = fProjects.ItemAt(i);
+		if (entry->path == path)
+			return entry;
+	}
+
+	server_project *entry = new server_project;
+	entry->path = path;
+	entry->project = NULL;
+	entry->modified = 0;
+	fProjects.AddItem(entry);
+	return entry;
+}
+
+
+status_t
+BuildServer::LoadProject(server_project *entry, BString &error)
+{
+	// Must be called with the entry locked
+	struct stat info;
+	if (stat(entry->path.String(), &info) != 0)
+	{
+		error.SetToFormat(B_TRANSLATE("Can't find file %s\n"),
+			entry->path.String());
+		return B_ENTRY_NOT_FOUND;
+	}
+
+	if (entry->project && entry->modified == info.st_mtime)
+		return B_OK;
+
+	// The project was changed since it was loaded, so start over with it
+	delete entry->project;
+	entry->project = NULL;
+
+	STRACE(1,("Build server loading %s\n", entry->path.String()));
+	Project *proj = new Project;
+	if (proj->Load(entry->path.String()) != B_OK)
+	{
+		error.SetToFormat(B_TRANSLATE("Couldn't load the project %s\n"),
+			entry->path.String());
+		delete proj;
+		return B_ERROR;
+	}
+
+	if (proj->IsReadOnly())
+	{
+		error = B_TRANSLATE(
+			"%path% is on a read-only disk. Please copy the project to another disk "
+			"or remount the disk with write support to be able to build it.\n");
+		error.ReplaceFirst("%path%", entry->path.String());
+		delete proj;
+		return B_READ_ONLY_DEVICE;
+	}
+
+	entry->project = proj;
+	entry->modified = info.st_mtime;
+	return B_OK;
+}
+
+
+int
+BuildServer::Build(server_connection *connection, const BMessage &request)
+{
+	bool rebuild;
+	if (request.FindBool("rebuild", &rebuild) != B_OK)
+		rebuild = false;
+
+	// The projects are built one after the other. A client wanting them at
+	// the same time can just as well ask for each on its own.
+	BString path;
+	for (int32 i = 0; request.FindString("path", i, &path) == B_OK; i++)
+	{
+		int status = BuildProject(connection, path.String(), rebuild);
+		if (status != 0)
+			return status;
+	}
+	return 0;
+}
+
+
+int
+BuildServer::BuildProject(server_connection *connection, const char *path,
+						bool rebuild)
+{
+	server_project *entry = ProjectFor(path);
+	BAutolock projectLock(entry->lock);
+
+	BString error;
+	if (LoadProject(entry, error) != B_OK)
+	{
+		BMessage msg(M_SERVER_OUTPUT);
+		msg.AddString("text", error);
+		send_message(connection->socket, msg);
+		return -1;
+	}
+
+	if (rebuild)
+		entry->project->ForceRebuild();
+
+	ServerOutput *output = new ServerOutput(connection->socket);
+	output->Run();
+	ProjectBuilder *builder = new ProjectBuilder(BMessenger(output));
+
+	fLock.Lock();
+	bool quitting = fQuitting;
+	if (!quitting)
+	{
+		connection->output = output;
+		connection->builder = builder;
+	}
+	fLock.Unlock();
+
+	if (!quitting)
+	{
+		// Files may have changed since any earlier build. Only what belongs
+		// to this project is forgotten, so the other projects keep theirs.
+		Project *proj = entry->project;
+		gStatCache.RemoveFolder(proj->GetPath().GetFolder());
+		for (int32 i = 0; i < proj->CountLocalIncludes(); i++)
+			gStatCache.RemoveFolder(proj->LocalIncludeAt(i).Absolute().String());
+
+		builder->BuildProject(entry->project, POSTBUILD_NOTHING);
+		while (acquire_sem(output->Finished()) == B_INTERRUPTED)
+			;
+	}
+
+	fLock.Lock();
+	connection->output = NULL;
+	connection->builder = NULL;
+	fLock.Unlock();
+
+	if (output->ClientGone())
+		builder->QuitBuild();
+	delete builder;
+
+	int status = quitting ? -1 : output->Status();
+	output->Lock();
+	output->Quit();
+	return status;
+}
+
+
+int32
+BuildServer::ListenThread(void *data)
+{
+	BuildServer *server = (BuildServer*)data;
+
+	for (;;)
+	{
+		int fd = accept(server->fSocket, NULL, NULL);
+		if (fd < 0)
+		{
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		BAutolock lock(server->fLock);
+		if (server->fQuitting)
+		{
+			close(fd);
+			break;
+		}
+
+		server_connection *connection = new server_connection;
+		connection->server = server;
+		connection->socket = fd;
+		connection->output = NULL;
+		connection->builder = NULL;
+		connection->thread = spawn_thread(ConnectionThread, "build server client",
+										B_NORMAL_PRIORITY, connection);
+		if (connection->thread < 0)
+		{
+			close(fd);
+			delete connection;
+			continue;
+		}
+
+		server->fConnections.AddItem(connection);
+		resume_thread(connection->thread);
+	}
+
+	return 0;
+}
+
+
+int32
+BuildServer::ConnectionThread(void *data)
+{
+	server_connection *connection = (server_connection*)data;
+	BuildServer *server = connection->server;
+
+	BMessage request;
+	if (receive_message(connection->socket, request) == B_OK
+		&& request.what == M_SERVER_BUILD)
+	{
+		BMessage done(M_SERVER_DONE);
+		done.AddInt32("status", server->Build(connection, request));
+		send_message(connection->socket, done);
+	}
+
+	close(connection->socket);
+
+	BAutolock lock(server->fLock);
+	server->fConnections.RemoveItem(connection);
+	return 0;
+}
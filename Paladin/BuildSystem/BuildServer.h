@@ -0,0 +1,88 @@
+#ifndef BUILD_SERVER_H
+#define BUILD_SERVER_H
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+#include "ObjectList.h"
+
+class Project;
+class ProjectBuilder;
+class ServerOutput;
+
+enum
+{
+	// Client to server: "path" for each project, "rebuild" to build
+	// everything again
+	M_SERVER_BUILD = 'sbld',
+
+	// Server to client: "text" to print, and "status" to exit with at the end
+	M_SERVER_OUTPUT = 'sout',
+	M_SERVER_DONE = 'sdon'
+};
+
+// Keeps Paladin running between command line builds, so that they don't
+// each pay for starting up, loading the project and scanning its
+// dependencies again. Builds are asked for over a local socket by
+// "Paladin -c", which prints what the server sends back and exits with the
+// build's status.
+//
+// Projects stay loaded until their file changes. Builds of different
+// projects run at the same time and share the job pool, while builds of the
+// same project wait for each other.
+class BuildServer
+{
+public:
+							BuildServer(void);
+							~BuildServer(void);
+
+			status_t		Start(const char *path);
+
+	// The socket used when none is given, PALADIN_BUILD_SERVER if it is set
+	static	BString			DefaultPath(void);
+
+	// Hands "Paladin -c" arguments to a running server and waits for the
+	// build. Returns an error without having built anything when no server
+	// is running or the arguments need a build of its own, in which case the
+	// caller builds the projects itself.
+	static	status_t		RunClient(int32 argc, char **argv, int &status);
+
+private:
+	struct server_project
+	{
+		BString				path;
+		Project				*project;
+		time_t				modified;
+		BLocker				lock;
+	};
+
+	struct server_connection
+	{
+		BuildServer			*server;
+		int					socket;
+		thread_id			thread;
+		ServerOutput		*output;
+		ProjectBuilder		*builder;
+	};
+
+			server_project *ProjectFor(const char *path);
+			status_t		LoadProject(server_project *entry, BString &error);
+			int				Build(server_connection *connection,
+									const BMessage &request);
+			int				BuildProject(server_connection *connection,
+										const char *path, bool rebuild);
+
+	static	int32			ListenThread(void *data);
+	static	int32			ConnectionThread(void *data);
+
+	BString					fPath;
+	int						fSocket;
+	thread_id				fListenThread;
+	BLocker					fLock;
+	BObjectList<server_project>	fProjects;
+	BObjectList<server_connection>	fConnections;
+	bool					fQuitting;
+};
+
+#endif
@@ -0,0 +1,260 @@
+#include "BuildSnapshot.h"
+
+#include <File.h>
+#include <Resources.h>
+#include <algorithm>
+#include <stdio.h>
+#include <vector>
+
+#include "BuildHistory.h"
+#include "BuildTimings.h"
+#include "CommandRunner.h"
+#include "DebugTools.h"
+#include "ObjectManifest.h"
+#include "Project.h"
+#include "SourceFile.h"
+
+struct build_order
+{
+	SourceFile	*file;
+	bool		failed;
+	bigtime_t	duration;
+};
+
+
+static bool
+compare_build_order(const build_order &one, const build_order &two)
+{
+	if (one.failed != two.failed)
+		return one.failed;
+	return one.duration > two.duration;
+}
+
+
+BuildSnapshot::BuildSnapshot(void)
+	:	fTargetType(TARGET_APP),
+		fFiles(20,false),
+		fAllFiles(20,false),
+		fNextFile(0)
+{
+}
+
+
+void
+BuildSnapshot::CopyProject(Project *project)
+{
+	Unset();
+	
+	fProjectName = project->GetName();
+	fTargetType = project->TargetType();
+	fTargetPath = project->GetPath().GetFolder();
+	fTargetPath.Append(project->GetTargetName());
+	fRunArgs = project->GetRunArgs();
+	
+	fInfo.CopySettings(*project->GetBuildInfo());
+	fCompileOptions = project->GetCompileOptions();
+	fLinkCommand = project->GetLinkCommand();
+	fResourceCommand = project->GetResourceCommand();
+	project->GetBuildProducts(fProducts);
+	
+	for (int32 i = 0; i < project->CountGroups(); i++)
+	{
+		SourceGroup *group = project->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+			fAllFiles.AddItem(group->filelist.ItemAt(j));
+	}
+}
+
+
+void
+BuildSnapshot::SetTo(Project *project, BuildHistory *history)
+{
+	CopyProject(project);
+	
+	// A file saved during the build is marked dirty again and so is built
+	// the next time
+	project->SortDirtyList();
+	SourceFile *file;
+	while ((file = project->GetNextDirtyFile()) != NULL)
+	{
+		fFiles.AddItem(file);
+		project->MakeFileClean(file);
+	}
+	
+	if (!history || fFiles.CountItems() < 2)
+		return;
+	
+	// The sort is stable, so files nothing is known about keep the project's
+	// order among themselves
+	std::vector<build_order> order;
+	for (int32 i = 0; i < fFiles.CountItems(); i++)
+	{
+		build_order item;
+		item.file = fFiles.ItemAt(i);
+		const char *path = item.file->GetPath().GetFullPath();
+		item.failed = history->Failed(path);
+		item.duration = history->PredictDuration(path);
+		order.push_back(item);
+	}
+	std::stable_sort(order.begin(), order.end(), compare_build_order);
+	
+	fFiles.MakeEmpty();
+	for (size_t i = 0; i < order.size(); i++)
+		fFiles.AddItem(order[i].file);
+}
+
+
+void
+BuildSnapshot::SetToFiles(Project *project, const BObjectList<SourceFile> &files)
+{
+	CopyProject(project);
+	
+	for (int32 i = 0; i < files.CountItems(); i++)
+		fFiles.AddItem(files.ItemAt(i));
+}
+
+
+void
+BuildSnapshot::Unset(void)
+{
+	fProjectName = "";
+	fTargetType = TARGET_APP;
+	fTargetPath.SetTo("");
+	fRunArgs = "";
+	
+	fCompileOptions = "";
+	fLinkCommand = "";
+	fResourceCommand = "";
+	fProducts.MakeEmpty();
+	
+	fFiles.MakeEmpty();
+	fAllFiles.MakeEmpty();
+	fNextFile = 0;
+}
+
+
+int32
+BuildSnapshot::NextFile(SourceFile **file)
+{
+	int32 index = atomic_add(&fNextFile, 1);
+	if (index >= fFiles.CountItems())
+	{
+		*file = NULL;
+		return -1;
+	}
+	
+	*file = fFiles.ItemAt(index);
+	return index;
+}
+
+
+void
+BuildSnapshot::PrecompileFile(SourceFile *file, BuildInfo &info)
+{
+	if (file == NULL)
+		return;
+	
+	file->Precompile(info,"");
+}
+
+
+void
+BuildSnapshot::CompileFile(SourceFile *file, BuildInfo &info)
+{
+	if (file == NULL)
+		return;
+	
+	file->Compile(info,fCompileOptions.String());
+}
+
+
+void
+BuildSnapshot::CheckSyntax(SourceFile *file, BuildInfo &info)
+{
+	if (file == NULL)
+		return;
+	
+	file->CheckSyntax(info,fCompileOptions.String());
+}
+
+
+void
+BuildSnapshot::Link(BuildInfo &info)
+{
+	// Throw out objects from files which were removed from the project
+	// before something picks them up
+	ObjectManifest manifest;
+	manifest.Load(fInfo.objectFolder.GetFullPath());
+	int32 removed = manifest.Update(fProducts);
+	manifest.Save();
+	
+	STRACE(1,("%s: object manifest has %ld entries, removed %ld stale files\n",
+			ProjectName(), manifest.CountEntries(), removed));
+	
+	BString errorMessage;
+	RunBuildCommand(fLinkCommand.String(),errorMessage);
+	
+	STRACE(1, ("Linking %s:\n%s\nErrors:\n%s\n", ProjectName(), fLinkCommand.String(),
+		errorMessage.String()));
+	
+	if (errorMessage.CountChars() > 0)
+	{
+		PhaseTimer timer(TIMING_PARSE_ERRORS);
+		ParseLDErrors(errorMessage.String(),info.errorList);
+	}
+}
+
+
+void
+BuildSnapshot::UpdateResources(void)
+{
+	if (fResourceCommand.CountChars() < 1)
+	{
+		STRACE(1, ("Resources for %s: No resource files to add\n", ProjectName()));
+		return;
+	}
+	
+	BString errorMessage;
+	RunBuildCommand(fResourceCommand.String(),errorMessage);
+	
+	STRACE(1, ("Resources for %s:\n%s\nErrors:%s\n", ProjectName(),
+		fResourceCommand.String(), errorMessage.String()));
+	
+	if (errorMessage.CountChars() > 0)
+		printf("Resource errors: %s\n",errorMessage.String());
+}
+
+
+status_t
+BuildSnapshot::UpdateAttributes(void)
+{
+	BResources res;
+	
+	BFile file(TargetPath(), B_READ_WRITE);
+	if (file.InitCheck() != B_OK)
+		return B_BAD_VALUE;
+	
+	if (res.SetTo(&file) != B_OK)
+		return B_ERROR;
+	
+	ResourceToAttribute(file,res,'MIMS',"BEOS:APP_SIG");
+	ResourceToAttribute(file,res,'MIMS',"BEOS:TYPE");
+	ResourceToAttribute(file,res,'MSGG',"BEOS:FILE_TYPES");
+	ResourceToAttribute(file,res,'APPV',"BEOS:APP_VERSION");
+	ResourceToAttribute(file,res,'APPF',"BEOS:APP_FLAGS");
+	ResourceToAttribute(file,res,'ICON',"BEOS:L:STD_ICON");
+	ResourceToAttribute(file,res,'MICN',"BEOS:M:STD_ICON");
+	ResourceToAttribute(file,res,'VICN',"BEOS:ICON");
+	
+	return B_OK;
+}
+
+
+void
+BuildSnapshot::PostBuild(SourceFile *file, BuildInfo &info)
+{
+	if (file == NULL)
+		return;
+	
+	file->PostBuild(info,NULL);
+}
@@ -0,0 +1,86 @@
+#ifndef BUILD_SNAPSHOT_H
+#define BUILD_SNAPSHOT_H
+
+#include <String.h>
+#include <StringList.h>
+
+#include "BuildInfo.h"
+#include "DPath.h"
+#include "ErrorParser.h"
+#include "ObjectList.h"
+
+class BuildHistory;
+class Project;
+class SourceFile;
+
+// Everything a build needs from its project, copied when the build starts.
+// The build threads only read it, so they don't need the project's lock
+// while compiling or linking, and changes made to the project in the
+// meantime are picked up by the next build.
+class BuildSnapshot
+{
+public:
+							BuildSnapshot(void);
+	
+			// The project must be locked. Takes the project's dirty files in
+			// the order they are to be built and marks them clean. With a
+			// history, files which failed last time come first so that their
+			// errors show up early, and the rest are started longest first so
+			// that the build doesn't end waiting on one big file.
+			void			SetTo(Project *project, BuildHistory *history = NULL);
+			
+			// Takes the given files instead and leaves the project's dirty
+			// files alone. The project must be locked.
+			void			SetToFiles(Project *project,
+										const BObjectList<SourceFile> &files);
+			void			Unset(void);
+			
+			const char *	ProjectName(void) const { return fProjectName.String(); }
+			int32			TargetType(void) const { return fTargetType; }
+			const char *	TargetPath(void) const { return fTargetPath.GetFullPath(); }
+			const char *	RunArgs(void) const { return fRunArgs.String(); }
+			
+			// The project's folders and include paths, without messages
+			const BuildInfo &	Info(void) const { return fInfo; }
+			
+			int32			CountFiles(void) const { return fFiles.CountItems(); }
+			SourceFile *	FileAt(int32 index) const { return fFiles.ItemAt(index); }
+			
+			// Hands out the files to build one at a time and without
+			// locking. Returns the file's place in the build order, or -1
+			// with file set to NULL once all of them have been taken.
+			int32			NextFile(SourceFile **file);
+			
+			// Messages go to the errorList of the BuildInfo given
+			void			PrecompileFile(SourceFile *file, BuildInfo &info);
+			void			CompileFile(SourceFile *file, BuildInfo &info);
+			void			CheckSyntax(SourceFile *file, BuildInfo &info);
+			void			Link(BuildInfo &info);
+			void			UpdateResources(void);
+			status_t		UpdateAttributes(void);
+			
+			// Every file in the project, for the post-build step
+			int32			CountAllFiles(void) const { return fAllFiles.CountItems(); }
+			SourceFile *	AllFileAt(int32 index) const { return fAllFiles.ItemAt(index); }
+			void			PostBuild(SourceFile *file, BuildInfo &info);
+	
+private:
+			void			CopyProject(Project *project);
+	
+	BString					fProjectName;
+	int32					fTargetType;
+	DPath					fTargetPath;
+	BString					fRunArgs;
+	
+	BuildInfo				fInfo;
+	BString					fCompileOptions;
+	BString					fLinkCommand;
+	BString					fResourceCommand;
+	BStringList				fProducts;
+	
+	BObjectList<SourceFile>	fFiles;
+	BObjectList<SourceFile>	fAllFiles;
+	int32					fNextFile;
+};
+
+#endif
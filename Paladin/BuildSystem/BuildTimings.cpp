@@ -0,0 +1,422 @@
+#include "BuildTimings.h"
+
+#include <File.h>
+#include <stdio.h>
+#include <string.h>
+#include <TLS.h>
+
+#include "SourceFile.h"
+
+static int32 sThreadRecordSlot = tls_allocate();
+
+static const char *sPhaseNames[] = {
+	"queue",
+	"precompile",
+	"compile",
+	"parse errors",
+	"post-build"
+};
+
+
+static int
+compare_timings(const file_timing *one, const file_timing *two)
+{
+	if (one->BuildTime() > two->BuildTime())
+		return -1;
+	if (one->BuildTime() < two->BuildTime())
+		return 1;
+	return one->path.Compare(two->path);
+}
+
+
+static BString
+json_escape(const char *string)
+{
+	BString out;
+	for (const char *c = string; c && *c; c++)
+	{
+		switch (*c)
+		{
+			case '"':
+				out << "\\\"";
+				break;
+			case '\\':
+				out << "\\\\";
+				break;
+			case '\n':
+				out << "\\n";
+				break;
+			case '\t':
+				out << "\\t";
+				break;
+			default:
+			{
+				if ((unsigned char)*c < 0x20)
+				{
+					char hex[8];
+					sprintf(hex, "\\u%04x", *c);
+					out << hex;
+				}
+				else
+					out << *c;
+			}
+		}
+	}
+	return out;
+}
+
+
+static BString
+format_time(bigtime_t usecs)
+{
+	char buffer[32];
+	sprintf(buffer, "%8.2fs", usecs / 1000000.0);
+	return BString(buffer);
+}
+
+
+file_timing::file_timing(SourceFile *sourcefile)
+	:	file(sourcefile),
+		thread(-1),
+		queued(0),
+		nested(0),
+		peakRSS(0),
+		cpuTime(0)
+{
+	if (file)
+		path = file->GetPath().GetFullPath();
+
+	for (int32 i = 0; i < TIMING_PHASE_COUNT; i++)
+	{
+		start[i] = 0;
+		duration[i] = 0;
+	}
+}
+
+
+bigtime_t
+file_timing::BuildTime(void) const
+{
+	// Queue time isn't work spent on the file, so it isn't counted here
+	bigtime_t total = 0;
+	for (int32 i = TIMING_PRECOMPILE; i < TIMING_PHASE_COUNT; i++)
+		total += duration[i];
+	return total;
+}
+
+
+BuildTimings::BuildTimings(void)
+	:	BLocker("build timings"),
+		fList(20, true),
+		fBuildStart(0),
+		fBuildEnd(0),
+		fLink(NULL),
+		fResources(NULL)
+{
+	fLink.path = "Link";
+	fResources.path = "Resources";
+}
+
+
+BuildTimings::~BuildTimings(void)
+{
+}
+
+
+void
+BuildTimings::Reset(void)
+{
+	Lock();
+	fList.MakeEmpty();
+	fBuildStart = system_time();
+	fBuildEnd = 0;
+
+	fLink = file_timing(NULL);
+	fLink.path = "Link";
+	fResources = file_timing(NULL);
+	fResources.path = "Resources";
+	Unlock();
+}
+
+
+void
+BuildTimings::Finish(void)
+{
+	Lock();
+	fBuildEnd = system_time();
+	SortBySlowest();
+	Unlock();
+}
+
+
+file_timing *
+BuildTimings::AddFile(SourceFile *file)
+{
+	Lock();
+	file_timing *record = new file_timing(file);
+	record->queued = system_time();
+	fList.AddItem(record);
+	Unlock();
+	return record;
+}
+
+
+file_timing *
+BuildTimings::FindFile(SourceFile *file)
+{
+	Lock();
+	file_timing *record = NULL;
+	for (int32 i = 0; i < fList.CountItems(); i++)
+	{
+		if (fList.ItemAt(i)->file == file)
+		{
+			record = fList.ItemAt(i);
+			break;
+		}
+	}
+	Unlock();
+	return record;
+}
+
+
+int32
+BuildTimings::CountFiles(void) const
+{
+	return fList.CountItems();
+}
+
+
+file_timing *
+BuildTimings::FileAt(int32 index) const
+{
+	return fList.ItemAt(index);
+}
+
+
+void
+BuildTimings::StartPhase(file_timing *record, int32 phase)
+{
+	if (!record || phase < 0 || phase >= TIMING_PHASE_COUNT)
+		return;
+
+	bigtime_t now = system_time();
+	if (phase == TIMING_PRECOMPILE)
+	{
+		// Picking a file up from the queue ends its wait
+		record->start[TIMING_QUEUE] = record->queued;
+		record->duration[TIMING_QUEUE] = now - record->queued;
+		record->thread = find_thread(NULL);
+	}
+
+	record->start[phase] = now;
+	record->nested = record->duration[TIMING_PARSE_ERRORS];
+}
+
+
+void
+BuildTimings::EndPhase(file_timing *record, int32 phase)
+{
+	if (!record || phase < 0 || phase >= TIMING_PHASE_COUNT)
+		return;
+
+	// Error parsing happens inside the precompile and compile steps, so take
+	// out whatever was added to it since the phase started
+	bigtime_t elapsed = system_time() - record->start[phase];
+	elapsed -= record->duration[TIMING_PARSE_ERRORS] - record->nested;
+	record->duration[phase] += MAX(elapsed, 0);
+}
+
+
+void
+BuildTimings::BeginLink(void)
+{
+	fLink.thread = find_thread(NULL);
+	StartPhase(&fLink, TIMING_COMPILE);
+	SetThreadRecord(&fLink);
+}
+
+
+void
+BuildTimings::EndLink(void)
+{
+	EndPhase(&fLink, TIMING_COMPILE);
+	SetThreadRecord(NULL);
+}
+
+
+void
+BuildTimings::BeginResources(void)
+{
+	fResources.thread = find_thread(NULL);
+	StartPhase(&fResources, TIMING_COMPILE);
+	SetThreadRecord(&fResources);
+}
+
+
+void
+BuildTimings::EndResources(void)
+{
+	EndPhase(&fResources, TIMING_COMPILE);
+	SetThreadRecord(NULL);
+}
+
+
+BString
+BuildTimings::Summary(int32 limit)
+{
+	Lock();
+	SortBySlowest();
+
+	BString out;
+	out << "Build timings (slowest first)\n";
+	out << "    Total     Queue  Precomp   Compile    Errors  PostBld   "
+			"Peak RSS       CPU  File\n";
+
+	int32 count = fList.CountItems();
+	if (limit > 0 && limit < count)
+		count = limit;
+
+	char rss[32];
+	for (int32 i = 0; i < count; i++)
+	{
+		file_timing *record = fList.ItemAt(i);
+		sprintf(rss, "%8.1fMB", record->peakRSS / (1024.0 * 1024.0));
+
+		out << format_time(record->BuildTime()) << " "
+			<< format_time(record->duration[TIMING_QUEUE]) << " "
+			<< format_time(record->duration[TIMING_PRECOMPILE]) << " "
+			<< format_time(record->duration[TIMING_COMPILE]) << " "
+			<< format_time(record->duration[TIMING_PARSE_ERRORS]) << " "
+			<< format_time(record->duration[TIMING_POSTBUILD]) << " "
+			<< rss << " " << format_time(record->cpuTime) << "  "
+			<< record->path << "\n";
+	}
+
+	if (fList.CountItems() > count)
+		out << "(" << fList.CountItems() - count << " more files)\n";
+
+	sprintf(rss, "%.1fMB", fLink.peakRSS / (1024.0 * 1024.0));
+	out << "Link:      " << format_time(fLink.duration[TIMING_COMPILE])
+		<< "  peak RSS " << rss << "\n";
+	out << "Resources: " << format_time(fResources.duration[TIMING_COMPILE]) << "\n";
+
+	bigtime_t end = fBuildEnd > 0 ? fBuildEnd : system_time();
+	out << "Wall time: " << format_time(end - fBuildStart) << "\n";
+	Unlock();
+
+	return out;
+}
+
+
+status_t
+BuildTimings::WriteChromeTrace(const char *path)
+{
+	if (!path)
+		return B_BAD_VALUE;
+
+	BFile file(path, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+
+	Lock();
+
+	// Chrome's trace viewer (chrome://tracing) and Perfetto both read this.
+	// Each build thread becomes a track and each phase a complete event.
+	BString data("{\"traceEvents\":[\n");
+	bool first = true;
+	for (int32 i = 0; i < fList.CountItems() + 2; i++)
+	{
+		file_timing *record;
+		if (i < fList.CountItems())
+			record = fList.ItemAt(i);
+		else
+			record = (i == fList.CountItems()) ? &fLink : &fResources;
+
+		BString name = json_escape(record->path.String());
+		for (int32 phase = TIMING_PRECOMPILE; phase < TIMING_PHASE_COUNT; phase++)
+		{
+			if (record->start[phase] == 0)
+				continue;
+
+			if (!first)
+				data << ",\n";
+			first = false;
+
+			data << "{\"name\":\"" << name << "\",\"cat\":\""
+				<< sPhaseNames[phase] << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+				<< (int32)record->thread
+				<< ",\"ts\":" << record->start[phase] - fBuildStart
+				<< ",\"dur\":" << record->duration[phase]
+				<< ",\"args\":{\"queue_us\":" << record->duration[TIMING_QUEUE]
+				<< ",\"peak_rss\":" << record->peakRSS
+				<< ",\"cpu_us\":" << record->cpuTime << "}}";
+		}
+	}
+	data << "\n],\"displayTimeUnit\":\"ms\"}\n";
+
+	Unlock();
+
+	ssize_t written = file.Write(data.String(), data.Length());
+	return (written == data.Length()) ? B_OK : B_IO_ERROR;
+}
+
+
+void
+BuildTimings::SetThreadRecord(file_timing *record)
+{
+	tls_set(sThreadRecordSlot, record);
+}
+
+
+file_timing *
+BuildTimings::ThreadRecord(void)
+{
+	return (file_timing *)tls_get(sThreadRecordSlot);
+}
+
+
+void
+BuildTimings::RecordChildUsage(off_t peakRSS, bigtime_t cpuTime)
+{
+	file_timing *record = ThreadRecord();
+	if (!record)
+		return;
+
+	// Precompiling and compiling may each run a command. Memory is a peak,
+	// but CPU time adds up.
+	record->peakRSS = MAX(record->peakRSS, peakRSS);
+	record->cpuTime += cpuTime;
+}
+
+
+void
+BuildTimings::AddThreadPhase(int32 phase, bigtime_t duration)
+{
+	file_timing *record = ThreadRecord();
+	if (!record || phase < 0 || phase >= TIMING_PHASE_COUNT)
+		return;
+
+	if (record->start[phase] == 0)
+		record->start[phase] = system_time() - duration;
+	record->duration[phase] += duration;
+}
+
+
+void
+BuildTimings::SortBySlowest(void)
+{
+	fList.SortItems(compare_timings);
+}
+
+
+PhaseTimer::PhaseTimer(int32 phase)
+	:	fPhase(phase),
+		fStart(system_time())
+{
+}
+
+
+PhaseTimer::~PhaseTimer(void)
+{
+	BuildTimings::AddThreadPhase(fPhase, system_time() - fStart);
+}
@@ -0,0 +1,100 @@
+#ifndef BUILD_TIMINGS_H
+#define BUILD_TIMINGS_H
+
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+#include "ObjectList.h"
+
+class SourceFile;
+
+enum
+{
+	TIMING_QUEUE = 0,
+	TIMING_PRECOMPILE,
+	TIMING_COMPILE,
+	TIMING_PARSE_ERRORS,
+	TIMING_POSTBUILD,
+	TIMING_PHASE_COUNT
+};
+
+class file_timing
+{
+public:
+				file_timing(SourceFile *file);
+
+	bigtime_t	BuildTime(void) const;
+
+	SourceFile	*file;
+	BString		path;
+	thread_id	thread;
+	bigtime_t	queued;
+	bigtime_t	start[TIMING_PHASE_COUNT];
+	bigtime_t	duration[TIMING_PHASE_COUNT];
+	bigtime_t	nested;
+	off_t		peakRSS;
+	bigtime_t	cpuTime;
+};
+
+// Collects per-file timings for a single run of the ProjectBuilder. Build
+// threads register the record they are working on with SetThreadRecord() so
+// that code deep inside the source types can report into it without having
+// to pass it around.
+class BuildTimings : public BLocker
+{
+public:
+							BuildTimings(void);
+							~BuildTimings(void);
+
+			void			Reset(void);
+			void			Finish(void);
+
+			file_timing *	AddFile(SourceFile *file);
+			file_timing *	FindFile(SourceFile *file);
+			int32			CountFiles(void) const;
+			file_timing *	FileAt(int32 index) const;
+
+			void			StartPhase(file_timing *record, int32 phase);
+			void			EndPhase(file_timing *record, int32 phase);
+
+			// Linking and xres are timed like a file so that the usage of
+			// their child processes is captured, too
+			void			BeginLink(void);
+			void			EndLink(void);
+			void			BeginResources(void);
+			void			EndResources(void);
+			const file_timing &	LinkTiming(void) const { return fLink; }
+			const file_timing &	ResourceTiming(void) const { return fResources; }
+
+			BString			Summary(int32 limit = 0);
+			status_t		WriteChromeTrace(const char *path);
+
+	static	void			SetThreadRecord(file_timing *record);
+	static	file_timing *	ThreadRecord(void);
+	static	void			RecordChildUsage(off_t peakRSS, bigtime_t cpuTime);
+	static	void			AddThreadPhase(int32 phase, bigtime_t duration);
+
+private:
+			void			SortBySlowest(void);
+
+	BObjectList<file_timing>	fList;
+	bigtime_t				fBuildStart;
+	bigtime_t				fBuildEnd;
+	file_timing				fLink;
+	file_timing				fResources;
+};
+
+// Adds the time from construction to destruction to a phase of the calling
+// thread's current record. Used to split error parsing out of compile times.
+class PhaseTimer
+{
+public:
+						PhaseTimer(int32 phase);
+						~PhaseTimer(void);
+private:
+	int32				fPhase;
+	bigtime_t			fStart;
+};
+
+#endif
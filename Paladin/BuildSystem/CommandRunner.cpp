@@ -0,0 +1,382 @@
+#include "CommandRunner.h"
+
+#include <Autolock.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/wait.h>
+#include <TLS.h>
+#include <unistd.h>
+
+#include "BuildTimings.h"
+#include "DebugTools.h"
+#include "Globals.h"
+#include "JobPool.h"
+
+// How often the process group is sampled while the command runs
+#define SAMPLE_INTERVAL 50000
+
+// How often all teams are looked through for new ones in the process group.
+// Every running command does this, so it is kept well apart.
+#define TEAM_SCAN_INTERVAL 200000
+
+// Upper bound on the number of processes tracked for CPU accounting. A
+// compile rarely has more than four (sh, g++, cc1plus, as).
+#define MAX_TRACKED_TEAMS 32
+
+typedef struct
+{
+	team_id		team;
+	bigtime_t	cputime;
+} team_sample;
+
+// Upper bound on the number of commands running at once for
+// StopAllCommands(). Commands beyond this aren't tracked.
+#define MAX_RUNNING_GROUPS 256
+
+static int32 sCommandGroupSlot = tls_allocate();
+
+// Every process group currently running. StopAllCommands() may be called from
+// a signal handler, so this is managed with atomics instead of a lock.
+static int32 sRunningGroups[MAX_RUNNING_GROUPS];
+
+
+static void
+add_running_group(pid_t group)
+{
+	for (int32 i = 0; i < MAX_RUNNING_GROUPS; i++)
+	{
+		if (atomic_test_and_set(&sRunningGroups[i], group, 0) == 0)
+			return;
+	}
+}
+
+
+static void
+remove_running_group(pid_t group)
+{
+	for (int32 i = 0; i < MAX_RUNNING_GROUPS; i++)
+	{
+		if (atomic_test_and_set(&sRunningGroups[i], 0, group) == group)
+			return;
+	}
+}
+
+
+CommandGroup::CommandGroup(void)
+	:	fLock("command group"),
+		fCanceled(false)
+{
+}
+
+
+CommandGroup::~CommandGroup(void)
+{
+}
+
+
+status_t
+CommandGroup::Add(pid_t group)
+{
+	BAutolock lock(fLock);
+	if (fCanceled)
+		return B_CANCELED;
+
+	fGroups.AddItem((void *)(addr_t)group);
+	return B_OK;
+}
+
+
+void
+CommandGroup::Remove(pid_t group)
+{
+	BAutolock lock(fLock);
+	fGroups.RemoveItem((void *)(addr_t)group);
+}
+
+
+void
+CommandGroup::Cancel(void)
+{
+	fLock.Lock();
+	fCanceled = true;
+
+	// The commands are run through sh, so signalling the whole group is what
+	// reaches the compiler itself. gcc removes its partial output when it
+	// gets SIGTERM.
+	for (int32 i = 0; i < fGroups.CountItems(); i++)
+	{
+		pid_t group = (pid_t)(addr_t)fGroups.ItemAt(i);
+		STRACE(1,("Stopping process group %d\n",(int)group));
+		kill(-group, SIGTERM);
+	}
+	fLock.Unlock();
+
+	// Threads of the group may still be waiting for a job slot. Done without
+	// the lock, which the waiting threads take to check for cancelling.
+	gJobPool.WakeWaiters();
+}
+
+
+void
+CommandGroup::Reset(void)
+{
+	BAutolock lock(fLock);
+	fCanceled = false;
+}
+
+
+bool
+CommandGroup::IsCanceled(void)
+{
+	BAutolock lock(fLock);
+	return fCanceled;
+}
+
+
+void
+CommandGroup::SetThreadGroup(CommandGroup *group)
+{
+	tls_set(sCommandGroupSlot, group);
+}
+
+
+CommandGroup *
+CommandGroup::ThreadGroup(void)
+{
+	return (CommandGroup *)tls_get(sCommandGroupSlot);
+}
+
+
+CommandRunner::CommandRunner(void)
+	:	fGroup(-1),
+		fExitStatus(-1),
+		fPeakRSS(0),
+		fCPUTime(0),
+		fWallTime(0),
+		fCanceled(false),
+		fOutputHook(NULL),
+		fOutputCookie(NULL)
+{
+}
+
+
+CommandRunner::~CommandRunner(void)
+{
+}
+
+
+status_t
+CommandRunner::Run(const char *command, BString &out, bool redirectStdErr)
+{
+	out = "";
+	fExitStatus = -1;
+	fPeakRSS = 0;
+	fCPUTime = 0;
+	fWallTime = 0;
+	fCanceled = false;
+
+	if (!command)
+		return B_BAD_VALUE;
+
+	CommandGroup *commandGroup = CommandGroup::ThreadGroup();
+	if (commandGroup && commandGroup->IsCanceled())
+	{
+		fCanceled = true;
+		return B_CANCELED;
+	}
+
+	int fds[2];
+	if (pipe(fds) != 0)
+		return B_BUSTED_PIPE;
+
+	// Other build threads fork at the same time. Their children must not
+	// keep this pipe open, or its end would only be seen once they exit.
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+
+	bigtime_t start = system_time();
+
+	pid_t pid = fork();
+	if (pid < 0)
+	{
+		close(fds[0]);
+		close(fds[1]);
+		return B_ERROR;
+	}
+
+	if (pid == 0)
+	{
+		// Child. Only async-signal-safe calls from here on.
+		setpgid(0, 0);
+		close(fds[0]);
+		dup2(fds[1], STDOUT_FILENO);
+		if (redirectStdErr)
+			dup2(fds[1], STDERR_FILENO);
+		close(fds[1]);
+
+		execl("/bin/sh", "sh", "-c", command, (char *)NULL);
+		_exit(127);
+	}
+
+	// Set the group from this side, too, so that sampling never races the
+	// child's own setpgid() call
+	setpgid(pid, pid);
+	fGroup = pid;
+	close(fds[1]);
+
+	add_running_group(fGroup);
+
+	// If the build was stopped while this was being started, the group can't
+	// be added and the command is stopped right away
+	if (commandGroup && commandGroup->Add(fGroup) != B_OK)
+		kill(-fGroup, SIGTERM);
+
+	team_sample samples[MAX_TRACKED_TEAMS];
+	int32 sampleCount = 0;
+
+	char buffer[4096];
+	bigtime_t lastSample = 0;
+	bigtime_t lastScan = 0;
+	while (true)
+	{
+		fd_set readset;
+		FD_ZERO(&readset);
+		FD_SET(fds[0], &readset);
+
+		struct timeval timeout;
+		timeout.tv_sec = 0;
+		timeout.tv_usec = SAMPLE_INTERVAL;
+
+		int result = select(fds[0] + 1, &readset, NULL, NULL, &timeout);
+		if (result < 0 && errno != EINTR)
+			break;
+
+		if (result > 0)
+		{
+			ssize_t bytesRead = read(fds[0], buffer, sizeof(buffer) - 1);
+			if (bytesRead <= 0)
+				break;
+			out.Append(buffer, bytesRead);
+			if (fOutputHook)
+				fOutputHook(buffer, bytesRead, fOutputCookie);
+		}
+		else if (result == 0 && fOutputHook)
+			fOutputHook(NULL, 0, fOutputCookie);
+
+		bigtime_t now = system_time();
+		if (now - lastSample < SAMPLE_INTERVAL)
+			continue;
+		lastSample = now;
+
+		// Look for teams which joined the command's process group
+		if (now - lastScan >= TEAM_SCAN_INTERVAL)
+		{
+			lastScan = now;
+
+			int32 cookie = 0;
+			team_info teamInfo;
+			while (sampleCount < MAX_TRACKED_TEAMS
+				&& get_next_team_info(&cookie, &teamInfo) == B_OK)
+			{
+				if (getpgid(teamInfo.team) != fGroup)
+					continue;
+
+				int32 i = 0;
+				while (i < sampleCount && samples[i].team != teamInfo.team)
+					i++;
+
+				if (i == sampleCount)
+				{
+					samples[i].team = teamInfo.team;
+					samples[i].cputime = 0;
+					sampleCount++;
+				}
+			}
+		}
+
+		// Add up the memory of the group's teams and remember the latest
+		// CPU time seen for each. Those which have exited keep their last.
+		off_t rss = 0;
+		for (int32 i = 0; i < sampleCount; i++)
+		{
+			team_usage_info usage;
+			if (get_team_usage_info(samples[i].team, B_TEAM_USAGE_SELF, &usage) != B_OK)
+				continue;
+
+			ssize_t areaCookie = 0;
+			area_info areaInfo;
+			while (get_next_area_info(samples[i].team, &areaCookie, &areaInfo) == B_OK)
+				rss += areaInfo.ram_size;
+
+			samples[i].cputime = usage.user_time + usage.kernel_time;
+		}
+
+		if (rss > fPeakRSS)
+			fPeakRSS = rss;
+	}
+	close(fds[0]);
+
+	int status = 0;
+	pid_t waited;
+	while ((waited = waitpid(pid, &status, 0)) < 0 && errno == EINTR)
+		;
+	if (waited < 0)
+		fExitStatus = -1;
+	else
+		fExitStatus = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+	remove_running_group(fGroup);
+	if (commandGroup)
+	{
+		commandGroup->Remove(fGroup);
+		fCanceled = commandGroup->IsCanceled();
+	}
+	fGroup = -1;
+
+	for (int32 i = 0; i < sampleCount; i++)
+		fCPUTime += samples[i].cputime;
+
+	fWallTime = system_time() - start;
+
+	STRACE(2,("Command finished in %lldus, peak RSS %lld bytes, CPU %lldus: %s\n",
+			fWallTime, fPeakRSS, fCPUTime, command));
+
+	return fCanceled ? B_CANCELED : B_OK;
+}
+
+
+void
+CommandRunner::SetOutputHook(CommandOutputHook hook, void *cookie)
+{
+	fOutputHook = hook;
+	fOutputCookie = cookie;
+}
+
+
+status_t
+RunBuildCommand(const char *command, BString &out, bool redirectStdErr,
+				int *exitStatus)
+{
+	CommandRunner runner;
+	status_t status = runner.Run(command, out, redirectStdErr);
+	if (status == B_OK || status == B_CANCELED)
+		BuildTimings::RecordChildUsage(runner.PeakRSS(), runner.CPUTime());
+	if (exitStatus)
+		*exitStatus = runner.ExitStatus();
+	return status;
+}
+
+
+void
+StopAllCommands(void)
+{
+	for (int32 i = 0; i < MAX_RUNNING_GROUPS; i++)
+	{
+		pid_t group = atomic_get(&sRunningGroups[i]);
+		if (group > 0)
+			kill(-group, SIGTERM);
+	}
+}
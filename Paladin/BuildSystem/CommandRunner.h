@@ -0,0 +1,92 @@
+#ifndef COMMAND_RUNNER_H
+#define COMMAND_RUNNER_H
+
+#include <List.h>
+#include <Locker.h>
+#include <OS.h>
+#include <String.h>
+
+// The process groups of the commands run by a set of build threads.
+// Cancelling it stops all of them at once, along with anything they started,
+// instead of waiting for each compiler to finish.
+class CommandGroup
+{
+public:
+						CommandGroup(void);
+						~CommandGroup(void);
+	
+	// Fails with B_CANCELED once the group has been cancelled
+			status_t	Add(pid_t group);
+			void		Remove(pid_t group);
+	
+			void		Cancel(void);
+			void		Reset(void);
+			bool		IsCanceled(void);
+	
+	// Commands run by the calling thread are added to this group
+	static	void		SetThreadGroup(CommandGroup *group);
+	static	CommandGroup *	ThreadGroup(void);
+	
+private:
+	BLocker				fLock;
+	BList				fGroups;
+	bool				fCanceled;
+};
+
+// Gets the output of a command as it arrives. It is also called with no data
+// every so often while the command is quiet, so that it can pass on anything
+// it has been holding back.
+typedef void (*CommandOutputHook)(const char *data, size_t length, void *cookie);
+
+// Runs a shell command for the build system and keeps an eye on the
+// processes it spawns. Unlike popen(), the child is started in its own
+// process group so that the whole tree (sh -> g++ -> cc1plus) can be
+// sampled for resource usage while it runs.
+class CommandRunner
+{
+public:
+						CommandRunner(void);
+						~CommandRunner(void);
+
+			status_t	Run(const char *command, BString &out,
+							bool redirectStdErr = true);
+
+			void		SetOutputHook(CommandOutputHook hook, void *cookie);
+
+			int			ExitStatus(void) const { return fExitStatus; }
+
+			// Largest combined resident size of the process group seen
+			// while the command was running, in bytes
+			off_t		PeakRSS(void) const { return fPeakRSS; }
+
+			// User + kernel time used by the process group
+			bigtime_t	CPUTime(void) const { return fCPUTime; }
+
+			bigtime_t	WallTime(void) const { return fWallTime; }
+
+			// True if the command was stopped by cancelling its thread's
+			// CommandGroup
+			bool		WasCanceled(void) const { return fCanceled; }
+
+private:
+	pid_t				fGroup;
+	int					fExitStatus;
+	off_t				fPeakRSS;
+	bigtime_t			fCPUTime;
+	bigtime_t			fWallTime;
+	bool				fCanceled;
+	CommandOutputHook	fOutputHook;
+	void				*fOutputCookie;
+};
+
+// Convenience wrapper used by the source types. The usage of the command is
+// added to the calling build thread's timing record, if it has one. Returns
+// B_CANCELED if the build was stopped while the command ran.
+status_t	RunBuildCommand(const char *command, BString &out,
+							bool redirectStdErr = true, int *exitStatus = NULL);
+
+// Stops every command started through CommandRunner. Safe to call from a
+// signal handler.
+void		StopAllCommands(void);
+
+#endif
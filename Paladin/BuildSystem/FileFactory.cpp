@@ -1,4 +1,8 @@
 #include "FileFactory.h"
+
+#include <Autolock.h>
+#include <string.h>
+
 #include "DPath.h"
 #include "SourceType.h"
 #include "SourceTypeC.h"
@@ -13,7 +17,8 @@
 FileFactory gFileFactory;
 
 FileFactory::FileFactory(void)
-	:	fList(20,true)
+	:	fList(20,true),
+		fExtensionLock("file factory extensions")
 {
 	LoadTypes();
 }
@@ -70,6 +75,33 @@ FileFactory::CreateSourceFile(const char *folder, const char *name, uint32 optio
 }
 
 
+bool
+FileFactory::IsBuildFile(const char *path)
+{
+	if (!path)
+		return false;
+	
+	const char *name = strrchr(path, '/');
+	name = name ? name + 1 : path;
+	const char *ext = strrchr(name, '.');
+	BString key(ext ? ext + 1 : "");
+	
+	BAutolock lock(fExtensionLock);
+	std::map<BString, bool>::iterator i = fBuildExtensions.find(key);
+	if (i != fBuildExtensions.end())
+		return i->second;
+	
+	// Source types only say whether they build through their files, so make
+	// one for this file and ask it
+	SourceFile *file = CreateSourceFileItem(path);
+	bool usesBuild = file && file->UsesBuild();
+	delete file;
+	
+	fBuildExtensions[key] = usesBuild;
+	return usesBuild;
+}
+
+
 SourceType *
 FileFactory::FindTypeForExtension(const char *ext)
 {
@@ -1,6 +1,9 @@
 #ifndef FILEFACTORY_H
 #define FILEFACTORY_H
 
+#include <Locker.h>
+#include <map>
+
 #include "ObjectList.h"
 #include "SourceType.h"
 
@@ -13,10 +16,17 @@ public:
 		SourceFile *	CreateSourceFileItem(const char *path);
 		entry_ref		CreateSourceFile(const char *folder, const char *name,
 										uint32 options = 0);
+		
+		// True if the file is of a type which a build does something with.
+		// This is decided once per extension. Safe to call from any thread.
+		bool			IsBuildFile(const char *path);
 
 private:
 		SourceType *	FindTypeForExtension(const char *ext);
 		BObjectList<SourceType>	fList;
+		
+		BLocker					fExtensionLock;
+		std::map<BString, bool>	fBuildExtensions;
 };
 
 extern FileFactory gFileFactory;
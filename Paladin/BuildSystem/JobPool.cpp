@@ -0,0 +1,352 @@
+#include "JobPool.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <String.h>
+
+#include "CommandRunner.h"
+#include "DebugTools.h"
+
+// How often a job waiting for a slot checks whether it was cancelled
+#define CANCEL_CHECK_INTERVAL 100000
+
+enum
+{
+	// No jobserver in use
+	TOKEN_NONE = -1,
+	// Every make job may run one thing without asking for a token
+	TOKEN_IMPLICIT = -2
+};
+
+JobPool::JobPool(int32 slots)
+	:	fSem(-1),
+		fSlots(0),
+		fOwed(0),
+		fMemoryBudget(0),
+		fMemoryInUse(0),
+		fMemoryJobs(0),
+		fJobServerRead(-1),
+		fJobServerWrite(-1),
+		fImplicitToken(1)
+{
+	pthread_mutex_init(&fMemoryLock, NULL);
+	pthread_cond_init(&fMemoryFreed, NULL);
+	SetSlots(slots);
+}
+
+
+JobPool::~JobPool(void)
+{
+	if (fSem >= 0)
+		delete_sem(fSem);
+	
+	pthread_cond_destroy(&fMemoryFreed);
+	pthread_mutex_destroy(&fMemoryLock);
+}
+
+
+status_t
+JobPool::UseJobServer(const char *makeflags)
+{
+	if (!makeflags)
+		return B_NAME_NOT_FOUND;
+	
+	// make uses the last one given
+	BString flags(makeflags);
+	int32 pos = flags.FindLast("--jobserver-auth=");
+	int32 length = 17;
+	if (pos < 0)
+	{
+		pos = flags.FindLast("--jobserver-fds=");
+		length = 16;
+	}
+	if (pos < 0)
+		return B_NAME_NOT_FOUND;
+	
+	BString value;
+	flags.CopyInto(value, pos + length, flags.Length() - pos - length);
+	int32 end = value.FindFirst(' ');
+	if (end >= 0)
+		value.Truncate(end);
+	
+	int readFD = -1;
+	int writeFD = -1;
+	if (value.Compare("fifo:", 5) == 0)
+	{
+		readFD = open(value.String() + 5, O_RDWR);
+		if (readFD < 0)
+		{
+			fprintf(stderr, "Paladin: can't open the jobserver fifo %s\n",
+				value.String() + 5);
+			return B_ENTRY_NOT_FOUND;
+		}
+		writeFD = readFD;
+	}
+	else if (sscanf(value.String(), "%d,%d", &readFD, &writeFD) != 2
+		|| readFD < 0 || writeFD < 0)
+		return B_BAD_VALUE;
+	else if (fcntl(readFD, F_GETFD) < 0 || fcntl(writeFD, F_GETFD) < 0)
+	{
+		// make only passes the descriptors on to commands it knows to be a
+		// make, so this is what happens without a '+' in front of the rule
+		fprintf(stderr, "Paladin: the jobserver isn't available. Prefix the "
+			"command with '+' in the makefile to use it.\n");
+		return B_FILE_ERROR;
+	}
+	
+	fJobServerRead = readFD;
+	fJobServerWrite = writeFD;
+	STRACE(1,("Using the make jobserver on %d,%d\n", readFD, writeFD));
+	return B_OK;
+}
+
+
+int32
+JobPool::AcquireToken(void)
+{
+	if (fJobServerRead < 0)
+		return TOKEN_NONE;
+	
+	if (atomic_test_and_set(&fImplicitToken, 0, 1) == 1)
+		return TOKEN_IMPLICIT;
+	
+	for (;;)
+	{
+		unsigned char token;
+		ssize_t bytes = read(fJobServerRead, &token, 1);
+		if (bytes == 1)
+			return token;
+		
+		if (bytes < 0 && errno == EINTR)
+			continue;
+		
+		if (bytes < 0 && errno == EAGAIN)
+		{
+			// The descriptor may have been left non-blocking by make
+			struct pollfd waitFor;
+			waitFor.fd = fJobServerRead;
+			waitFor.events = POLLIN;
+			poll(&waitFor, 1, -1);
+			continue;
+		}
+		
+		// Go on without one rather than stopping the build
+		return TOKEN_NONE;
+	}
+}
+
+
+void
+JobPool::ReleaseToken(int32 token)
+{
+	if (token == TOKEN_NONE)
+		return;
+	
+	if (token == TOKEN_IMPLICIT)
+	{
+		atomic_set(&fImplicitToken, 1);
+		return;
+	}
+	
+	// make notices lost tokens and reduces its limit, so one which can't be
+	// written back is not fatal
+	unsigned char byte = (unsigned char)token;
+	while (write(fJobServerWrite, &byte, 1) < 0 && errno == EINTR)
+		;
+}
+
+
+void
+JobPool::SetSlots(int32 slots)
+{
+	if (slots < 1)
+		slots = 1;
+	
+	if (fSem < 0)
+	{
+		fSem = create_sem(slots, "build job pool");
+		fSlots = slots;
+		STRACE(2,("Build job pool has %ld slots\n",slots));
+		return;
+	}
+	
+	int32 change = slots - fSlots;
+	fSlots = slots;
+	STRACE(2,("Build job pool has %ld slots\n",slots));
+	
+	if (change > 0)
+	{
+		// Slots which haven't been given up yet are simply kept
+		while (change > 0)
+		{
+			int32 owed = atomic_get(&fOwed);
+			if (owed == 0)
+				break;
+			if (atomic_test_and_set(&fOwed, owed - 1, owed) == owed)
+				change--;
+		}
+		if (change > 0)
+			release_sem_etc(fSem, change, 0);
+	}
+	else if (change < 0)
+	{
+		// Take the free ones now and the rest as their jobs finish
+		int32 remove = -change;
+		while (remove > 0 && acquire_sem_etc(fSem, 1, B_RELATIVE_TIMEOUT, 0) == B_OK)
+			remove--;
+		atomic_add(&fOwed, remove);
+	}
+}
+
+
+void
+JobPool::SetMemoryBudget(off_t budget)
+{
+	pthread_mutex_lock(&fMemoryLock);
+	fMemoryBudget = MAX(budget, 0);
+	STRACE(2,("Build memory budget is %lld MB\n",(long long)fMemoryBudget / 1048576));
+	
+	// A bigger budget may let waiting jobs go
+	pthread_cond_broadcast(&fMemoryFreed);
+	pthread_mutex_unlock(&fMemoryLock);
+}
+
+
+status_t
+JobPool::AcquireMemory(off_t memory)
+{
+	CommandGroup *group = CommandGroup::ThreadGroup();
+	
+	pthread_mutex_lock(&fMemoryLock);
+	while (fMemoryBudget > 0 && fMemoryJobs > 0
+		&& fMemoryInUse + memory > fMemoryBudget)
+	{
+		// Checked with the lock held, so a WakeWaiters() after the group
+		// was cancelled can't be missed
+		if (group && group->IsCanceled())
+		{
+			pthread_mutex_unlock(&fMemoryLock);
+			return B_CANCELED;
+		}
+		
+		STRACE(2,("Build job needing %lld MB waits for memory\n",
+			(long long)memory / 1048576));
+		pthread_cond_wait(&fMemoryFreed, &fMemoryLock);
+	}
+	
+	fMemoryInUse += memory;
+	fMemoryJobs++;
+	pthread_mutex_unlock(&fMemoryLock);
+	return B_OK;
+}
+
+
+void
+JobPool::ReleaseMemory(off_t memory)
+{
+	pthread_mutex_lock(&fMemoryLock);
+	fMemoryInUse -= memory;
+	fMemoryJobs--;
+	pthread_cond_broadcast(&fMemoryFreed);
+	pthread_mutex_unlock(&fMemoryLock);
+}
+
+
+status_t
+JobPool::Acquire(int32 &token, off_t memory)
+{
+	token = TOKEN_NONE;
+	CommandGroup *group = CommandGroup::ThreadGroup();
+	
+	status_t status;
+	do
+	{
+		if (group && group->IsCanceled())
+			return B_CANCELED;
+		
+		status = acquire_sem_etc(fSem, 1, B_RELATIVE_TIMEOUT,
+			CANCEL_CHECK_INTERVAL);
+	} while (status == B_INTERRUPTED || status == B_TIMED_OUT);
+	
+	if (status != B_OK)
+		return status;
+	
+	// Memory comes before the token so that a job waiting for memory
+	// doesn't keep one of make's jobs from running
+	status = AcquireMemory(memory);
+	if (status != B_OK)
+	{
+		ReleaseSlot();
+		return status;
+	}
+	
+	token = AcquireToken();
+	return B_OK;
+}
+
+
+void
+JobPool::Release(int32 token, off_t memory)
+{
+	ReleaseToken(token);
+	ReleaseMemory(memory);
+	ReleaseSlot();
+}
+
+
+void
+JobPool::WakeWaiters(void)
+{
+	pthread_mutex_lock(&fMemoryLock);
+	pthread_cond_broadcast(&fMemoryFreed);
+	pthread_mutex_unlock(&fMemoryLock);
+}
+
+
+void
+JobPool::ReleaseSlot(void)
+{
+	for (;;)
+	{
+		int32 owed = atomic_get(&fOwed);
+		if (owed == 0)
+		{
+			release_sem(fSem);
+			return;
+		}
+		
+		// The pool was made smaller, so this slot goes away
+		if (atomic_test_and_set(&fOwed, owed - 1, owed) == owed)
+			return;
+	}
+}
+
+
+JobSlot::JobSlot(JobPool &pool, off_t memory)
+	:	fPool(pool),
+		fToken(TOKEN_NONE),
+		fMemory(MAX(memory, 0))
+{
+	fAcquired = (fPool.Acquire(fToken, fMemory) == B_OK);
+}
+
+
+JobSlot::~JobSlot(void)
+{
+	Release();
+}
+
+
+void
+JobSlot::Release(void)
+{
+	if (fAcquired)
+		fPool.Release(fToken, fMemory);
+	fAcquired = false;
+}
@@ -0,0 +1,92 @@
+#ifndef JOB_POOL_H
+#define JOB_POOL_H
+
+#include <OS.h>
+#include <pthread.h>
+
+// Limits how many build jobs run at once across every ProjectBuilder in the
+// application. A single project never has more build threads than there are
+// slots, so this only makes a difference when several projects are building
+// side by side, e.g. in a workspace build.
+//
+// When run by GNU make with -j, the pool can also take part in make's
+// jobserver: every job past the first one needs a token from make as well
+// as a slot, so Paladin and everything else make runs stay within make's
+// job limit together.
+//
+// Jobs may also say how much memory they are expected to need. Once the
+// jobs running add up to the memory budget, the next one waits until enough
+// is given back, so a build of large files runs fewer jobs at once instead
+// of pushing the system into swapping. A job is always let through when
+// nothing else is running, however much it needs.
+class JobPool
+{
+public:
+					JobPool(int32 slots = 1);
+					~JobPool(void);
+	
+	// Can be changed while jobs are running. When there are fewer slots
+	// than before, slots in use are given up as their jobs finish.
+	void			SetSlots(int32 slots);
+	int32			CountSlots(void) const { return fSlots; }
+	
+	// Looks for --jobserver-auth (or the older --jobserver-fds) in make's
+	// MAKEFLAGS. Either a pair of descriptors or "fifo:<path>" is accepted.
+	status_t		UseJobServer(const char *makeflags);
+	bool			UsesJobServer(void) const { return fJobServerRead >= 0; }
+	
+	// 0 means no limit. Can be changed while jobs are running.
+	void			SetMemoryBudget(off_t budget);
+	off_t			MemoryBudget(void) const { return fMemoryBudget; }
+	
+	// token is what has to be handed back to Release(), together with the
+	// same amount of memory. Fails with B_CANCELED, without holding
+	// anything, once the calling thread's CommandGroup is cancelled.
+	status_t		Acquire(int32 &token, off_t memory = 0);
+	void			Release(int32 token, off_t memory = 0);
+	
+	// Lets the jobs which wait check whether they were cancelled
+	void			WakeWaiters(void);
+	
+private:
+			int32	AcquireToken(void);
+			void	ReleaseToken(int32 token);
+			status_t	AcquireMemory(off_t memory);
+			void	ReleaseMemory(off_t memory);
+			void	ReleaseSlot(void);
+	
+	sem_id			fSem;
+	int32			fSlots;
+	int32			fOwed;
+	
+	pthread_mutex_t	fMemoryLock;
+	pthread_cond_t	fMemoryFreed;
+	off_t			fMemoryBudget;
+	off_t			fMemoryInUse;
+	int32			fMemoryJobs;
+	
+	int				fJobServerRead;
+	int				fJobServerWrite;
+	int32			fImplicitToken;
+};
+
+// Holds a slot of a JobPool, and the memory the job is expected to use,
+// for as long as it exists
+class JobSlot
+{
+public:
+					JobSlot(JobPool &pool, off_t memory = 0);
+					~JobSlot(void);
+	
+	// Gives the slot back before the job is done with, e.g. before waiting
+	// for other jobs which may need it
+	void			Release(void);
+	
+private:
+	JobPool			&fPool;
+	bool			fAcquired;
+	int32			fToken;
+	off_t			fMemory;
+};
+
+#endif
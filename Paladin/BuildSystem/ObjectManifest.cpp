@@ -0,0 +1,184 @@
+#include "ObjectManifest.h"
+
+#include <Directory.h>
+#include <Entry.h>
+#include <File.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "DebugTools.h"
+#include "TextFile.h"
+
+#define MANIFEST_NAME "ObjectManifest"
+#define MANIFEST_HEADER "# Paladin object manifest 1"
+
+ObjectManifest::ObjectManifest(void)
+	:	fExisted(false)
+{
+}
+
+
+status_t
+ObjectManifest::Load(const char *objectFolder)
+{
+	if (!objectFolder)
+		return B_BAD_VALUE;
+	
+	fFolder = objectFolder;
+	fEntries.MakeEmpty();
+	fExisted = false;
+	
+	BString path(fFolder);
+	path << "/" << MANIFEST_NAME;
+	
+	TextFile file(path.String(), B_READ_ONLY);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+	
+	fExisted = true;
+	
+	const char *start;
+	int32 length;
+	while (file.NextLine(start, length))
+	{
+		BString line(start, length);
+		if (line.CountChars() < 1 || line[0] == '#')
+			continue;
+		fEntries.Add(line);
+	}
+	
+	return B_OK;
+}
+
+
+status_t
+ObjectManifest::Save(void)
+{
+	if (fFolder.CountChars() < 1)
+		return B_NO_INIT;
+	
+	BString path(fFolder);
+	path << "/" << MANIFEST_NAME;
+	
+	BFile file(path.String(), B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+	
+	BString data(MANIFEST_HEADER);
+	data << "\n" << fEntries.Join("\n") << "\n";
+	
+	ssize_t written = file.Write(data.String(), data.Length());
+	return (written == data.Length()) ? B_OK : B_IO_ERROR;
+}
+
+
+int32
+ObjectManifest::Update(const BStringList &products)
+{
+	// Entries are kept relative to the objects folder
+	BString prefix(fFolder);
+	prefix << "/";
+	
+	BStringList current;
+	for (int32 i = 0; i < products.CountStrings(); i++)
+	{
+		BString name(products.StringAt(i));
+		if (name.FindFirst(prefix) != 0)
+			continue;
+		
+		name.Remove(0, prefix.Length());
+		if (!current.HasString(name))
+			current.Add(name);
+	}
+	
+	int32 removed = 0;
+	for (int32 i = 0; i < fEntries.CountStrings(); i++)
+	{
+		BString name = fEntries.StringAt(i);
+		if (current.HasString(name))
+			continue;
+		
+		BString path(prefix);
+		path << name;
+		if (BEntry(path.String()).Remove() == B_OK)
+		{
+			STRACE(1,("Removed stale build product %s\n",path.String()));
+			removed++;
+		}
+	}
+	
+	// The first time a project is built with a manifest, objects from
+	// earlier versions of Paladin may still be around under their old names
+	if (!fExisted)
+		removed += RemoveLegacyObjects(current);
+	
+	fEntries = current;
+	fExisted = true;
+	return removed;
+}
+
+
+void
+ObjectManifest::RemoveAll(void)
+{
+	for (int32 i = 0; i < fEntries.CountStrings(); i++)
+	{
+		BString path(fFolder);
+		path << "/" << fEntries.StringAt(i);
+		BEntry(path.String()).Remove();
+	}
+	fEntries.MakeEmpty();
+	
+	if (!fExisted)
+		RemoveLegacyObjects(BStringList());
+	fExisted = true;
+}
+
+
+int32
+ObjectManifest::RemoveLegacyObjects(const BStringList &keep)
+{
+	BDirectory dir(fFolder.String());
+	if (dir.InitCheck() != B_OK)
+		return 0;
+	
+	const char *extensions[] = { ".o", ".rsrc", ".r.txt", ".cpp", ".hpp", NULL };
+	
+	// Collect first. Removing entries while reading a directory isn't safe.
+	BStringList stale;
+	BEntry entry;
+	dir.Rewind();
+	while (dir.GetNextEntry(&entry) == B_OK)
+	{
+		char name[B_FILE_NAME_LENGTH];
+		entry.GetName(name);
+		
+		BString nameString(name);
+		if (keep.HasString(nameString))
+			continue;
+		
+		for (int32 i = 0; extensions[i]; i++)
+		{
+			int32 pos = nameString.FindLast(extensions[i]);
+			if (pos >= 0 && pos == nameString.Length() - (int32)strlen(extensions[i]))
+			{
+				stale.Add(nameString);
+				break;
+			}
+		}
+	}
+	
+	int32 removed = 0;
+	for (int32 i = 0; i < stale.CountStrings(); i++)
+	{
+		BString path(fFolder);
+		path << "/" << stale.StringAt(i);
+		if (BEntry(path.String()).Remove() == B_OK)
+		{
+			STRACE(1,("Removed old build product %s\n",path.String()));
+			removed++;
+		}
+	}
+	
+	return removed;
+}
@@ -0,0 +1,35 @@
+#ifndef OBJECT_MANIFEST_H
+#define OBJECT_MANIFEST_H
+
+#include <String.h>
+#include <StringList.h>
+
+// Remembers which files in a project's objects folder were created by the
+// build, so that the products of files removed from the project can be
+// cleaned up without reading the whole folder.
+class ObjectManifest
+{
+public:
+						ObjectManifest(void);
+	
+			status_t	Load(const char *objectFolder);
+			status_t	Save(void);
+	
+	// Replaces the contents of the manifest with the given paths and removes
+	// the files which are no longer listed. Returns the number removed.
+			int32		Update(const BStringList &products);
+	
+	// Removes every file in the manifest and empties it
+			void		RemoveAll(void);
+	
+			int32		CountEntries(void) const { return fEntries.CountStrings(); }
+	
+private:
+			int32		RemoveLegacyObjects(const BStringList &keep);
+	
+	BString				fFolder;
+	BStringList			fEntries;
+	bool				fExisted;
+};
+
+#endif
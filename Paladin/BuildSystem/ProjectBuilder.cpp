@@ -8,10 +8,13 @@
 #include <Path.h>
 #include <Roster.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
 
 #include "DebugTools.h"
 #include "ErrorParser.h"
 #include "Globals.h"
+#include "JobPool.h"
 #include "LaunchHelper.h"
 #include "Project.h"
 #include "SourceFile.h"
@@ -30,22 +33,46 @@
 #endif
 
 ProjectBuilder::ProjectBuilder(void)
-	:	fIsLinking(false),
+	:	fProject(NULL),
+		fIsLinking(false),
 		fIsBuilding(false),
 		fTotalFilesToBuild(0L),
 		fTotalFilesBuilt(0L),
-		fManager(gCPUCount)
+		fQueuedTime(0),
+		fDiagnostics(NULL),
+		fDiagnosticCount(0),
+		fNextDelivery(0),
+		fDelivering(0),
+		fKeepGoing(false),
+		fFailedFiles(0),
+		fCheckingSyntax(false),
+		fThreadsLeft(0),
+		fRelink(true),
+		fLinkNeeded(true),
+		fManager(BuildJobCount())
 {
 }
 
 
 ProjectBuilder::ProjectBuilder(const BMessenger &target)
 	:	fMsgr(target),
+		fProject(NULL),
 		fIsLinking(false),
 		fIsBuilding(false),
 		fTotalFilesToBuild(0L),
 		fTotalFilesBuilt(0L),
-		fManager(gCPUCount)
+		fQueuedTime(0),
+		fDiagnostics(NULL),
+		fDiagnosticCount(0),
+		fNextDelivery(0),
+		fDelivering(0),
+		fKeepGoing(false),
+		fFailedFiles(0),
+		fCheckingSyntax(false),
+		fThreadsLeft(0),
+		fRelink(true),
+		fLinkNeeded(true),
+		fManager(BuildJobCount())
 {
 }
 
@@ -54,6 +81,7 @@ ProjectBuilder::~ProjectBuilder(void)
 {
 	if (IsBuilding())
 		QuitBuild();
+	ResetDiagnostics(0);
 }
 
 
@@ -99,8 +127,7 @@ ProjectBuilder::BuildProject(Project *proj, int32 postbuild)
 	
 	bool saveproj = false;
 	
-	// Always start the cache fresh on a new build
-	gStatCache.MakeEmpty();
+	fTimings.Reset();
 	
 	// Check any files not already marked as needing built
 	for (int32 i = 0; i < fProject->CountGroups(); i++)
@@ -129,6 +156,9 @@ ProjectBuilder::BuildProject(Project *proj, int32 postbuild)
 			{
 				STRACE(1,("%s does not need to be built\n",file->GetPath().GetFullPath()));
 			}
+			
+			if (fProject->IsFileDirty(file))
+				fTimings.AddFile(file);
 			if (!gBuildMode && !saveproj && dep.Compare(file->GetDependencies()) != 0)
 				saveproj = true;
 		}
@@ -137,28 +167,125 @@ ProjectBuilder::BuildProject(Project *proj, int32 postbuild)
 	if (saveproj)
 		fProject->Save();
 	
+	// From here on the build threads only use the snapshot, so the project
+	// stays free for the windows while they work
+	// The order the files are built in depends on how earlier builds went
+	fHistory.Load(proj->GetObjectPath().GetFullPath());
+	
+	fLinkNeeded = fRelink || TargetOutdated(proj);
+	
+	fProject->Lock();
+	fSnapshot.SetTo(fProject, &fHistory);
+	fProject->Unlock();
+	
 	fIsBuilding = true;
 	
-	int32 threadcount = 1;
-	if (fProject->CountDirtyFiles() > 1 && !gSingleThreadedBuild)
+	// It's kind of silly spawning 4 threads on a quad core system to
+	// build 2 files, so limit spawned threads to whichever is less
+	int32 threadcount = MIN(BuildJobCount(),fSnapshot.CountFiles());
+	if (threadcount < 1)
+		threadcount = 1;
+	fManager.SetMaxThreads(threadcount);
+	
+	fTotalFilesToBuild = fSnapshot.CountFiles();
+	fTotalFilesBuilt = 0;
+	
+	fQueuedTime = 0;
+	for (int32 i = 0; i < fSnapshot.CountFiles(); i++)
 	{
-		// It's kind of silly spawning 4 threads on a quad core system to
-		// build 2 files, so limit spawned threads to whichever is less
-		threadcount = MIN(gCPUCount,fProject->CountDirtyFiles());
+		fQueuedTime += fHistory.PredictDuration(
+			fSnapshot.FileAt(i)->GetPath().GetFullPath());
 	}
+	ResetDiagnostics(fTotalFilesToBuild);
+	
+	fKeepGoing = gKeepGoing;
+	fFailedFiles = 0;
+	fFailures.msglist.MakeEmpty();
+	fCheckingSyntax = false;
 	
-	fTotalFilesToBuild = proj->CountDirtyFiles();
-	fTotalFilesBuilt = 0;
 	for (int32 i = 0; i < threadcount; i++)
 		fManager.SpawnThread(BuildThread,this);
 }
 
 
+void
+ProjectBuilder::CheckSyntax(Project *proj, bool allFiles)
+{
+	if (!proj)
+		return;
+	
+	fProject = proj;
+	fPostBuildAction = POSTBUILD_NOTHING;
+	
+	if ((gPlatform == PLATFORM_HAIKU || gPlatform == PLATFORM_HAIKU_GCC4) &&
+		fProject->IsLocked() && fProject->LockingThread() == find_thread(NULL))
+		fProject->Unlock();
+	
+	STRACE(1,("Checking syntax of Project %s\n",proj->GetName()));
+	
+	// Nothing is marked as built, so the dirty list is left as it is
+	BObjectList<SourceFile> files(20, false);
+	for (int32 i = 0; i < fProject->CountGroups(); i++)
+	{
+		SourceGroup *group = fProject->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+		{
+			SourceFile *file = group->filelist.ItemAt(j);
+			if (!file->CanCheckSyntax())
+				continue;
+			
+			if (allFiles || fProject->IsFileDirty(file)
+				|| proj->CheckNeedsBuild(file))
+				files.AddItem(file);
+		}
+	}
+	
+	fHistory.Load(proj->GetObjectPath().GetFullPath());
+	
+	fProject->Lock();
+	fSnapshot.SetToFiles(fProject, files);
+	fProject->Unlock();
+	
+	fIsBuilding = true;
+	fIsLinking = false;
+	
+	int32 threadcount = MIN(BuildJobCount(),fSnapshot.CountFiles());
+	if (threadcount < 1)
+		threadcount = 1;
+	fManager.SetMaxThreads(threadcount);
+	
+	fTotalFilesToBuild = fSnapshot.CountFiles();
+	fTotalFilesBuilt = 0;
+	fQueuedTime = 0;
+	ResetDiagnostics(fTotalFilesToBuild);
+	
+	fKeepGoing = false;
+	fFailedFiles = 0;
+	fFailures.msglist.MakeEmpty();
+	fCheckingSyntax = true;
+	fThreadsLeft = threadcount;
+	
+	for (int32 i = 0; i < threadcount; i++)
+		fManager.SpawnThread(CheckSyntaxThread,this);
+}
+
+
 void
 ProjectBuilder::QuitBuild(void)
 {
-	if (IsBuilding())
-		fManager.QuitAllThreads();
+	if (!IsBuilding())
+		return;
+	
+	fManager.QuitAllThreads();
+	DeliverDiagnostics(true);
+	SendFailures();
+	
+	// Threads which quit don't reset this themselves
+	Lock();
+	fIsBuilding = false;
+	fIsLinking = false;
+	Unlock();
+	FinishBuild();
 }
 
 
@@ -172,25 +299,29 @@ ProjectBuilder::IsBuilding(void)
 }
 
 
+// Called by whichever thread ends the build, however it ended
+void
+ProjectBuilder::FinishBuild(void)
+{
+	fTimings.Finish();
+	fHistory.Save();
+}
+
+
 void
 ProjectBuilder::DoPostBuild(void)
 {
 	// It's really silly to try to run a library! ;-)
-	if (fProject->TargetType() != TARGET_APP)
+	if (fSnapshot.TargetType() != TARGET_APP)
 		return;
 	
-	BPath path(fProject->GetPath().GetFolder());
-	path.Append(fProject->GetTargetName());
-	
 	LaunchHelper launcher;
 	switch (fPostBuildAction)
 	{
 		case POSTBUILD_RUN:
 		{
-			DPath targetpath = fProject->GetPath().GetFolder();
-			targetpath.Append(fProject->GetTargetName());
-			launcher.SetRef(targetpath.GetFullPath());
-			launcher.ParseToArgs(fProject->GetRunArgs());
+			launcher.SetRef(fSnapshot.TargetPath());
+			launcher.ParseToArgs(fSnapshot.RunArgs());
 			STRACE(1,("Run command: %s\n",launcher.AsString().String()));
 			launcher.Launch();
 			break;
@@ -198,17 +329,16 @@ ProjectBuilder::DoPostBuild(void)
 		case POSTBUILD_RUN_IN_TERMINAL:
 		{
 			BString command;
-			DPath targetpath = fProject->GetPath().GetFolder();
-			targetpath.Append(fProject->GetTargetName());
+			DPath targetpath(fSnapshot.TargetPath());
 			command << "cd '" << targetpath.GetFolder() << "'; '"
-				<< targetpath.GetFileName() << "' " << fProject->GetRunArgs()
+				<< targetpath.GetFileName() << "' " << fSnapshot.RunArgs()
 				<< " 2>&1";
 			
 			STRACE(1,("Terminal Run command: %s\n",command.String()));
 			
 			TerminalWindow *termwin = new TerminalWindow(command.String());
 			BString termtitle = "Terminal Output: ";
-			termtitle << fProject->GetName();
+			termtitle << fSnapshot.ProjectName();
 			termwin->SetTitle(termtitle.String());
 			termwin->Hide();
 			termwin->Show();
@@ -223,8 +353,7 @@ ProjectBuilder::DoPostBuild(void)
 				entry_ref debuggerref;
 				haikuDebugger.GetRef(&debuggerref);
 				
-				BString targetPath(fProject->GetPath().GetFolder());
-				targetPath << "/" << fProject->GetTargetName();
+				BString targetPath(fSnapshot.TargetPath());
 				
 				const char* argv[] = {targetPath.String()};
 				be_roster->Launch(&debuggerref,1,argv);
@@ -256,10 +385,9 @@ ProjectBuilder::DoPostBuild(void)
 					}
 				}
 			
-				BString targetPath(fProject->GetPath().GetFolder());
-				targetPath << "/" << fProject->GetTargetName();
+				BString targetPath(fSnapshot.TargetPath());
 				launcher.AddArg(targetPath.String());
-				launcher.ParseToArgs(fProject->GetRunArgs());
+				launcher.ParseToArgs(fSnapshot.RunArgs());
 				STRACE(1,("Debugger command: %s\n",launcher.AsString().String()));
 				launcher.Launch();
 				break;
@@ -275,25 +403,178 @@ ProjectBuilder::DoPostBuild(void)
 
 
 void
-ProjectBuilder::SendErrorMessage(ErrorList &list)
+ProjectBuilder::SendSuccessMessage(void)
+{
+	BMessage msg(M_BUILD_SUCCESS);
+	msg.AddPointer("project",fProject);
+	fMsgr.SendMessage(&msg);
+}
+
+
+void
+ProjectBuilder::SendErrorMessage(ErrorList &list, bool streaming)
 {
 	BMessage errmsg;
-	if (list.CountErrors() > 0)
+	if (list.CountErrors() > 0 && !streaming)
 		errmsg.what = M_BUILD_FAILURE;
 	else if (list.msglist.CountItems() > 0)
 		errmsg.what = M_BUILD_WARNINGS;
 	else
 		errmsg.what = M_BUILD_MESSAGES;
 	list.Flatten(errmsg);
+	errmsg.AddPointer("project",fProject);
 	fMsgr.SendMessage(&errmsg);
 }
 
 
+// Used for files which finished without any messages
+static ErrorList sNoDiagnostics;
+
+
+void
+ProjectBuilder::ResetDiagnostics(int32 count)
+{
+	// Only called while no build threads are running
+	if (fDiagnostics)
+	{
+		for (int32 i = 0; i < fDiagnosticCount; i++)
+		{
+			if (fDiagnostics[i] != &sNoDiagnostics)
+				delete fDiagnostics[i];
+		}
+		delete [] fDiagnostics;
+		fDiagnostics = NULL;
+	}
+	
+	fDiagnosticCount = count;
+	fNextDelivery = 0;
+	fDelivering = 0;
+	
+	if (count > 0)
+	{
+		fDiagnostics = new ErrorList*[count];
+		memset(fDiagnostics, 0, sizeof(ErrorList*) * count);
+	}
+}
+
+
+void
+ProjectBuilder::PublishDiagnostics(int32 job, ErrorList &list)
+{
+	if (job < 0 || job >= fDiagnosticCount)
+		return;
+	
+	// The slot belongs to this job alone, so nothing needs to be locked to
+	// fill it. The list is moved out so that the thread can reuse its own.
+	ErrorList *result = &sNoDiagnostics;
+	if (list.msglist.CountItems() > 0)
+	{
+		result = new ErrorList;
+		result->msglist.AddList(&list.msglist);
+		list.msglist.MakeEmpty(false);
+	}
+	atomic_pointer_get_and_set(&fDiagnostics[job], result);
+	
+	DeliverDiagnostics(false);
+}
+
+
+bool
+ProjectBuilder::DiagnosticsReady(bool flush)
+{
+	int32 next = atomic_get(&fNextDelivery);
+	if (next >= fDiagnosticCount)
+		return false;
+	
+	return flush || atomic_pointer_get(&fDiagnostics[next]) != NULL;
+}
+
+
+void
+ProjectBuilder::DeliverDiagnostics(bool flush)
+{
+	// Whichever thread gets here first sends everything that is ready. A
+	// file which finishes while it is doing so is picked up by the check
+	// after it lets go.
+	do
+	{
+		if (atomic_test_and_set(&fDelivering, 1, 0) != 0)
+			return;
+		
+		int32 next = fNextDelivery;
+		while (next < fDiagnosticCount)
+		{
+			ErrorList *list = atomic_pointer_get(&fDiagnostics[next]);
+			if (!list && !flush)
+				break;
+			
+			if (list && list != &sNoDiagnostics)
+			{
+				// Errors would end the build for whoever is listening, so
+				// they wait for the end when keeping going
+				if (fKeepGoing && list->CountErrors() > 0)
+				{
+					fFailures.msglist.AddList(&list->msglist);
+					list->msglist.MakeEmpty(false);
+				}
+				else
+					SendErrorMessage(*list, fCheckingSyntax);
+				delete list;
+				atomic_pointer_get_and_set(&fDiagnostics[next], &sNoDiagnostics);
+			}
+			next++;
+		}
+		atomic_set(&fNextDelivery, next);
+		
+		atomic_set(&fDelivering, 0);
+	} while (DiagnosticsReady(flush));
+}
+
+
+void
+ProjectBuilder::SendFailures(void)
+{
+	// Only called once the build threads are done delivering
+	if (fFailures.msglist.CountItems() == 0)
+		return;
+	
+	SendErrorMessage(fFailures);
+	fFailures.msglist.MakeEmpty();
+}
+
+
+bool
+ProjectBuilder::TargetOutdated(Project *proj)
+{
+	DPath targetPath(proj->GetPath().GetFolder());
+	targetPath.Append(proj->GetTargetName());
+	
+	struct stat target;
+	if (stat(targetPath.GetFullPath(), &target) != 0)
+		return true;
+	
+	// Changed settings are saved to the project file
+	struct stat other;
+	if (stat(proj->GetPath().GetFullPath(), &other) == 0
+		&& other.st_mtime > target.st_mtime)
+		return true;
+	
+	for (int32 i = 0; i < proj->CountLibraries(); i++)
+	{
+		if (stat(proj->LibraryAt(i)->GetPath().GetFullPath(), &other) == 0
+			&& other.st_mtime > target.st_mtime)
+			return true;
+	}
+	
+	return false;
+}
+
+
 int32
 ProjectBuilder::BuildThread(void *data)
 {
 	ProjectBuilder *parent = (ProjectBuilder *)data;
-	Project *proj = parent->fProject;
+	BuildSnapshot &snapshot = parent->fSnapshot;
 	
 	thread_id thisThread = find_thread(NULL);
 
@@ -302,24 +583,33 @@ ProjectBuilder::BuildThread(void *data)
 	BString errstr;
 	bool link_needed = false;
 	
-	time_t lastMod = 0;
+	// Each thread collects its messages in its own BuildInfo
+	BuildInfo jobInfo;
+	jobInfo.CopySettings(snapshot.Info());
 	
-	proj->Lock();
-	proj->SortDirtyList();
-	
-	SourceFile *file = proj->GetNextDirtyFile();
-	if (file)
-	{
-		proj->MakeFileClean(file);
-		lastMod = MAX(lastMod,file->GetModTime());
-		file->UpdateModTime();
-	}
-	proj->Unlock();
+	SourceFile *file;
+	int32 job = snapshot.NextFile(&file);
 	
 	while (file)
 	{
+		// Held until the file is done. The pool is shared with any other
+		// projects being built at the same time, and a file which needs a
+		// lot of memory may have to wait for others to finish first.
+		JobSlot slot(gJobPool,
+			parent->fHistory.PredictMemory(file->GetPath().GetFullPath()));
+		
+		// Waiting for the slot ends early when the build is stopped
+		if (parent->fManager.ThreadCheckQuit())
+		{
+			BTRACE(("Thread %ld asked to quit while waiting for a slot\n",thisThread));
+			slot.Release();
+			parent->fManager.RemoveThread(thisThread);
+			return B_OK;
+		}
+		
 		link_needed = true;
 		
+		file->UpdateModTime();
 		file->SetBuildFlag(BUILD_NO);
 		
 		parent->Lock();
@@ -331,98 +621,124 @@ ProjectBuilder::BuildThread(void *data)
 		msg.AddPointer("sourcefile",file);
 		msg.AddInt32("count",parent->fTotalFilesBuilt);
 		msg.AddInt32("total",parent->fTotalFilesToBuild);
+		
+		// A rough guess, assuming the files still waiting are shared evenly
+		// between the threads once this one is done
+		bigtime_t expected = parent->fHistory.PredictDuration(
+			file->GetPath().GetFullPath());
+		if (expected > 0)
+		{
+			bigtime_t queued = atomic_add64(&parent->fQueuedTime, -expected)
+				- expected;
+			msg.AddInt64("remaining", expected
+				+ MAX(queued, 0) / parent->fManager.MaxThreads());
+		}
 		parent->fMsgr.SendMessage(&msg);
 		
 		BTRACE(("Thread %ld is building file %s\n",thisThread,file->GetPath().GetFileName()));
 		
-		BuildInfo *info = proj->GetBuildInfo();
-		info->errorList.msglist.MakeEmpty();
-		proj->PrecompileFile(file);
+		file_timing *timing = parent->fTimings.FindFile(file);
+		if (!timing)
+			timing = parent->fTimings.AddFile(file);
+		BuildTimings::SetThreadRecord(timing);
 		
-		if (info->errorList.msglist.CountItems() > 0)
-		{
-			parent->SendErrorMessage(info->errorList);
-			
-			if (info->errorList.CountErrors() > 0)
-			{
-				msg.MakeEmpty();
-				msg.what = M_BUILDING_DONE;
-				msg.AddPointer("sourcefile",file);
-				parent->fMsgr.SendMessage(&msg);
-				
-				parent->Lock();
-				parent->fIsBuilding = false;
-				parent->Unlock();
-				
-				parent->fManager.RemoveThread(thisThread);
-				parent->fManager.QuitAllThreads();
-				
-				BTRACE(("Thread %ld quit on errors after precompile\n",thisThread));
-				
-				return B_ERROR;
-			}
-			else
-				info->errorList.msglist.MakeEmpty();
-		}
+		ErrorList &errors = jobInfo.errorList;
+		errors.msglist.MakeEmpty();
+		parent->fTimings.StartPhase(timing, TIMING_PRECOMPILE);
+		snapshot.PrecompileFile(file, jobInfo);
+		parent->fTimings.EndPhase(timing, TIMING_PRECOMPILE);
 		
+		// Whatever a stopped command printed isn't worth reporting
 		if (parent->fManager.ThreadCheckQuit())
 		{
-			BTRACE(("Thread %ld asked to quit after precompile\n",thisThread));
+			BTRACE(("Thread %ld asked to quit during precompile\n",thisThread));
+			BuildTimings::SetThreadRecord(NULL);
 			
+			slot.Release();
 			parent->fManager.RemoveThread(thisThread);
 			return B_OK;
 		}
 		
-		proj->CompileFile(file);
-		
-		if (info->errorList.msglist.CountItems() > 0)
+		// Warnings from the precompile step stay in the list and are sent
+		// together with those of the compile
+		if (errors.CountErrors() == 0)
 		{
-			parent->SendErrorMessage(info->errorList);
+			parent->fTimings.StartPhase(timing, TIMING_COMPILE);
+			snapshot.CompileFile(file, jobInfo);
+			parent->fTimings.EndPhase(timing, TIMING_COMPILE);
 			
-			if (info->errorList.CountErrors() > 0)
+			if (parent->fManager.ThreadCheckQuit())
 			{
-				msg.MakeEmpty();
-				msg.what = M_BUILDING_DONE;
-				msg.AddPointer("sourcefile",file);
-				parent->fMsgr.SendMessage(&msg);
-				
-				parent->Lock();
-				parent->fIsBuilding = false;
-				parent->Unlock();
+				// A compiler stopped partway may have left a truncated object
+				// behind which would look up to date on the next build
+				BTRACE(("Thread %ld asked to quit during compile\n",thisThread));
+				BuildTimings::SetThreadRecord(NULL);
+				file->RemoveObjects(jobInfo);
 				
+				slot.Release();
 				parent->fManager.RemoveThread(thisThread);
-				parent->fManager.QuitAllThreads();
-				
-				BTRACE(("Thread %ld quit after compile\n",thisThread));
-				
-				return B_ERROR;
+				return B_OK;
 			}
-			else
-				info->errorList.msglist.MakeEmpty();
 		}
+		BuildTimings::SetThreadRecord(NULL);
+		bool failed = errors.CountErrors() > 0;
+		parent->fHistory.RecordMemory(file->GetPath().GetFullPath(),
+			timing->peakRSS);
+		parent->fHistory.RecordBuild(file->GetPath().GetFullPath(),
+			timing->BuildTime(), failed);
+		
+		parent->PublishDiagnostics(job, errors);
 		
 		msg.MakeEmpty();
 		msg.what = M_BUILDING_DONE;
 		msg.AddPointer("sourcefile",file);
 		parent->fMsgr.SendMessage(&msg);
 		
+		if (failed && parent->fKeepGoing)
+		{
+			// Built again next time, but the other files go on
+			file->SetBuildFlag(BUILD_YES);
+			msg.MakeEmpty();
+			msg.what = M_FILE_NEEDS_BUILD;
+			msg.AddPointer("file",file);
+			parent->fMsgr.SendMessage(&msg);
+			
+			atomic_add(&parent->fFailedFiles, 1);
+			BTRACE(("Thread %ld keeps going after errors\n",thisThread));
+		}
+		else if (failed)
+		{
+			// The other threads may be waiting for the slot, and they have
+			// to get going again to notice that they should quit
+			slot.Release();
+			
+			parent->Lock();
+			parent->fIsBuilding = false;
+			parent->Unlock();
+			
+			parent->fManager.RemoveThread(thisThread);
+			parent->fManager.QuitAllThreads();
+			
+			// Everyone else is gone now, so whatever is still waiting for
+			// an earlier file can be sent
+			parent->DeliverDiagnostics(true);
+			
+			parent->FinishBuild();
+			BTRACE(("Thread %ld quit on errors\n",thisThread));
+			
+			return B_ERROR;
+		}
+		
 		if (parent->fManager.ThreadCheckQuit())
 		{
 			BTRACE(("Thread %ld asked to quit after compile\n",thisThread));
 			
+			slot.Release();
 			parent->fManager.RemoveThread(thisThread);
 			return B_OK;
 		}
 		
-		proj->Lock();
-		file = proj->GetNextDirtyFile();
-		if (file)
-		{
-			proj->MakeFileClean(file);
-			lastMod = MAX(lastMod,file->GetModTime());
-			file->UpdateModTime();
-		}
-		proj->Unlock();
+		job = snapshot.NextFile(&file);
 	}
 	
 	// Now that we've finished building the individual source files, we need to
@@ -445,13 +761,7 @@ ProjectBuilder::BuildThread(void *data)
 		// If no files have been built, it's possible that there was a linker
 		// error. When there is a linker error, the linker deletes the old target,
 		// so if the target exists, we can skip straight to the end.
-		proj->Lock();
-		DPath targetPath(proj->GetPath().GetFolder());
-		
-		targetPath << proj->GetTargetName();
-		proj->Unlock();
-		
-		if (BEntry(targetPath.GetFullPath()).Exists())
+		if (BEntry(snapshot.TargetPath()).Exists())
 			do_postprocess = false;
 	}
 	
@@ -459,133 +769,132 @@ ProjectBuilder::BuildThread(void *data)
 	
 	if (do_postprocess)
 	{
-		while (parent->fManager.CountRunningThreads() > 1)
-			snooze(10000);
+		if (!parent->fManager.WaitForOtherThreads())
+		{
+			BTRACE(("Thread %ld asked to quit before linking\n",thisThread));
+			parent->Lock();
+			parent->fIsLinking = false;
+			parent->Unlock();
+			
+			parent->fManager.RemoveThread(thisThread);
+			return B_OK;
+		}
 		
 		BTRACE(("Thread %ld is performing postcompile processing\n",thisThread));
 		
-		// Check to see if linking is needed
-		BPath targetPath(proj->GetPath().GetFolder());
-		targetPath.Append(proj->GetTargetName(),true);
+		// All the files are done, so anything still held back goes out
+		// before the link messages
+		parent->DeliverDiagnostics(true);
 		
-		BEntry targetEntry(targetPath.Path());
-		if (!targetEntry.Exists())
-			link_needed = true;
-		else
+		// Linking needs every file, so a build which kept going past errors
+		// ends here with all of them
+		if (atomic_get(&parent->fFailedFiles) > 0)
 		{
-			struct stat *s = gStatCache.StatFor(targetPath.Path());
-			if (s || s->st_mtime < lastMod)
-				link_needed = true;
+			parent->SendFailures();
+			
+			parent->Lock();
+			parent->fIsLinking = false;
+			parent->fIsBuilding = false;
+			parent->Unlock();
+			
+			parent->FinishBuild();
+			parent->fManager.RemoveThread(thisThread);
+			BTRACE(("Thread %ld quit after %ld files failed\n",thisThread,
+				parent->fFailedFiles));
+			return B_ERROR;
 		}
 		
-		BuildInfo *info = proj->GetBuildInfo();
+		// Other threads may have built files even if this one didn't
+		link_needed = parent->fLinkNeeded || parent->fTotalFilesBuilt > 0;
+		
+		// None of this takes the project's lock, so the project window
+		// stays usable during a long link
+		ErrorList &errors = jobInfo.errorList;
+		errors.msglist.MakeEmpty();
 		if (link_needed)
 		{
 			parent->fMsgr.SendMessage(M_LINKING_PROJECT);
 			
-			proj->Lock();
-			proj->Link();
+			parent->fTimings.BeginLink();
+			{
+				JobSlot slot(gJobPool);
+				snapshot.Link(jobInfo);
+			}
+			parent->fTimings.EndLink();
 			
-			if (info->errorList.msglist.CountItems() > 0)
+			if (errors.msglist.CountItems() > 0)
 			{
-				parent->SendErrorMessage(info->errorList);
+				parent->SendErrorMessage(errors);
 				
-				if (info->errorList.CountErrors() > 0)
+				if (errors.CountErrors() > 0)
 				{
 					parent->Lock();
 					parent->fIsLinking = false;
 					parent->fIsBuilding = false;
 					parent->Unlock();
-					proj->Unlock();
 					
 					parent->fManager.RemoveThread(thisThread);
 					parent->fManager.QuitAllThreads();
 					
+					parent->FinishBuild();
 					BTRACE(("Thread %ld quit after linker errors\n",thisThread));
 					
 					return B_ERROR;
 				}
 				else
-					info->errorList.msglist.MakeEmpty();
+					errors.msglist.MakeEmpty();
 			}
 			
 			if (parent->fManager.ThreadCheckQuit())
 			{
 				BTRACE(("Thread %ld asked to quit after link\n",thisThread));
 				parent->fManager.RemoveThread(thisThread);
-				proj->Unlock();
 				return B_OK;
 			}
-			
-			proj->Unlock();
 		}
 		
 		// Now that the linking is done, we should add any resource files
 		parent->fMsgr.SendMessage(M_UPDATING_RESOURCES);
 		
-		proj->Lock();
-		proj->UpdateResources();
-		if (info->errorList.msglist.CountItems() > 0)
+		parent->fTimings.BeginResources();
 		{
-			parent->SendErrorMessage(info->errorList);
-			
-			if (info->errorList.CountErrors() > 0)
-			{
-				parent->Lock();
-				parent->fIsLinking = false;
-				parent->fIsBuilding = false;
-				parent->Unlock();
-				proj->Unlock();
-				
-				parent->fManager.RemoveThread(thisThread);
-				parent->fManager.QuitAllThreads();
-				return B_ERROR;
-			}
+			JobSlot slot(gJobPool);
+			snapshot.UpdateResources();
 		}
-		proj->UpdateAttributes();
-		proj->Unlock();
+		parent->fTimings.EndResources();
+		snapshot.UpdateAttributes();
 		
-		// Now that the linking is done, we should add any resource files
 		parent->fMsgr.SendMessage(M_DOING_POSTBUILD);
 		
-		proj->Lock();
-		int32 groupcount = proj->CountGroups();
-		proj->Unlock();
-		
-		for (int32 j = 0; j < groupcount; j++)
+		for (int32 i = 0; i < snapshot.CountAllFiles(); i++)
 		{
-			// Locking isn't necessary here -- it reduces contention for the lock
-			// and the build threads don't change the groups themselves
-			SourceGroup *group = proj->GroupAt(j);
-			int32 filecount = group->filelist.CountItems();
+			file = snapshot.AllFileAt(i);
+			file_timing *timing = parent->fTimings.FindFile(file);
+			parent->fTimings.StartPhase(timing, TIMING_POSTBUILD);
+			snapshot.PostBuild(file, jobInfo);
+			parent->fTimings.EndPhase(timing, TIMING_POSTBUILD);
 			
-			for (int32 i = 0; i < filecount; i++)
+			if (errors.msglist.CountItems() > 0)
 			{
-				proj->Lock();
-				file = group->filelist.ItemAt(i);
-				proj->PostBuild(file);
-				proj->Unlock();
-				
-				if (info->errorList.msglist.CountItems() > 0)
-				{
-					parent->SendErrorMessage(info->errorList);
-					info->errorList.msglist.MakeEmpty();
-				}
+				parent->SendErrorMessage(errors);
+				errors.msglist.MakeEmpty();
 			}
 		}
 		
+		parent->FinishBuild();
 		parent->Lock();
 		parent->fIsLinking = false;
 		parent->fIsBuilding = false;
 		parent->Unlock();
-		parent->fMsgr.SendMessage(M_BUILD_SUCCESS);
+		parent->SendSuccessMessage();
 		
 		parent->DoPostBuild();
 	}
 	
 	if (parent->fTotalFilesBuilt == 0)
 	{
-		parent->fMsgr.SendMessage(M_BUILD_SUCCESS);
+		parent->FinishBuild();
+		parent->SendSuccessMessage();
 		parent->DoPostBuild();
 	}
 	
@@ -594,17 +903,24 @@ ProjectBuilder::BuildThread(void *data)
 }
 
 
-ThreadManager::ThreadManager(uint8 max)
-	:	fMaxThreads(max),
+typedef struct
+{
+	ThreadManager	*manager;
+	thread_func		func;
+	void			*data;
+} thread_start;
+
+
+ThreadManager::ThreadManager(int32 max)
+	:	fMaxThreads(0),
 		fThreadCount(0),
-		fQuitFlag(false)
+		fQuitFlag(false),
+		fThreadArray(NULL)
 {
-	if (max < 1)
-		fMaxThreads = 1;
-	
-	fThreadArray = new thread_id[max];
+	pthread_mutex_init(&fLock, NULL);
+	pthread_cond_init(&fThreadExited, NULL);
 	
-	memset(fThreadArray, -1, sizeof(thread_id) * fMaxThreads);
+	SetMaxThreads(max);
 }
 
 
@@ -612,40 +928,93 @@ ThreadManager::~ThreadManager(void)
 {
 	QuitAllThreads();
 	delete [] fThreadArray;
+	
+	pthread_cond_destroy(&fThreadExited);
+	pthread_mutex_destroy(&fLock);
+}
+
+
+void
+ThreadManager::SetMaxThreads(int32 max)
+{
+	if (max < 1)
+		max = 1;
+	
+	pthread_mutex_lock(&fLock);
+	if (max != fMaxThreads && fThreadCount == 0)
+	{
+		delete [] fThreadArray;
+		fThreadArray = new thread_id[max];
+		fMaxThreads = max;
+		
+		for (int32 i = 0; i < fMaxThreads; i++)
+			fThreadArray[i] = -1;
+	}
+	pthread_mutex_unlock(&fLock);
 }
 
 
 thread_id
 ThreadManager::SpawnThread(thread_func func, void *data)
 {
-	BAutolock lock(fLock);
+	pthread_mutex_lock(&fLock);
 	
 	if (fThreadCount == fMaxThreads)
+	{
+		pthread_mutex_unlock(&fLock);
 		return B_ERROR;
+	}
 	
-	thread_id t = spawn_thread(func,"build thread", B_NORMAL_PRIORITY, data);
+	thread_start *start = new thread_start;
+	start->manager = this;
+	start->func = func;
+	start->data = data;
+	
+	thread_id t = spawn_thread(ThreadEntry,"build thread", B_NORMAL_PRIORITY, start);
 	if (t >= 0)
 	{
-		int8 slot = FindFreeSlot();
+		int32 slot = FindFreeSlot();
 		if (slot >= 0)
 		{
 			BTRACE(("Spawning build thread %ld\n",t));
-			resume_thread(t);
 			fThreadArray[slot] = t;
 			fThreadCount++;
+			resume_thread(t);
 		}
 		else
+		{
 			kill_thread(t);
+			delete start;
+		}
 	}
+	else
+		delete start;
 	
+	pthread_mutex_unlock(&fLock);
 	return t;	
 }
 
 
+int32
+ThreadManager::ThreadEntry(void *data)
+{
+	thread_start *start = (thread_start *)data;
+	thread_func func = start->func;
+	void *funcData = start->data;
+	
+	// Anything the thread runs through CommandRunner can then be stopped
+	// by QuitAllThreads()
+	CommandGroup::SetThreadGroup(&start->manager->fCommands);
+	delete start;
+	
+	return func(funcData);
+}
+
+
 void
 ThreadManager::RemoveThread(thread_id tid)
 {
-	BAutolock lock(fLock);
+	pthread_mutex_lock(&fLock);
 	
 	for (int32 i = 0; i < fMaxThreads; i++)
 	{
@@ -653,17 +1022,21 @@ ThreadManager::RemoveThread(thread_id tid)
 		{
 			fThreadArray[i] = -1;
 			fThreadCount--;
-			return;
+			pthread_cond_broadcast(&fThreadExited);
+			break;
 		}
 	}
+	
+	pthread_mutex_unlock(&fLock);
 }
 
 
-uint8
+int32
 ThreadManager::CountRunningThreads(void)
 {
-	BAutolock lock(fLock);
-	uint8 count = fThreadCount;
+	pthread_mutex_lock(&fLock);
+	int32 count = fThreadCount;
+	pthread_mutex_unlock(&fLock);
 	
 	return count;
 }
@@ -672,37 +1045,38 @@ ThreadManager::CountRunningThreads(void)
 void
 ThreadManager::QuitAllThreads(void)
 {
-	fLock.Lock();
+	pthread_mutex_lock(&fLock);
 	fQuitFlag = true;
-	fLock.Unlock();
+	pthread_cond_broadcast(&fThreadExited);
+	pthread_mutex_unlock(&fLock);
+	
+	// Threads only check the quit flag between files, so without this they
+	// would first wait for their compilers to finish
+	fCommands.Cancel();
+	
+	pthread_mutex_lock(&fLock);
+	while (fThreadCount > 0)
+		pthread_cond_wait(&fThreadExited, &fLock);
 	
-	while (true)
-	{
-		bool done = false;
-		
-		fLock.Lock();
-		if (fThreadCount <= 0)
-			done = true;
-		fLock.Unlock();
-		
-		if (done)
-			break;
-		
-		snooze(10000);
-	}
 	fQuitFlag = false;
+	fCommands.Reset();
+	pthread_mutex_unlock(&fLock);
 }
 
 
 void
 ThreadManager::KillAllThreads(bigtime_t quit_timeout)
 {
-	BAutolock lock(fLock);
+	pthread_mutex_lock(&fLock);
 	fQuitFlag = true;
+	pthread_mutex_unlock(&fLock);
+	
+	fCommands.Cancel();
 	
 	if (quit_timeout > 0)
 		snooze(quit_timeout);
 	
+	pthread_mutex_lock(&fLock);
 	for (int32 i = 0; i < fMaxThreads; i++)
 	{
 		thread_id tid = fThreadArray[i];
@@ -713,22 +1087,38 @@ ThreadManager::KillAllThreads(bigtime_t quit_timeout)
 		}
 	}
 	fThreadCount = 0;
+	pthread_cond_broadcast(&fThreadExited);
+	pthread_mutex_unlock(&fLock);
+}
+
+
+bool
+ThreadManager::WaitForOtherThreads(void)
+{
+	pthread_mutex_lock(&fLock);
+	while (fThreadCount > 1 && !fQuitFlag)
+		pthread_cond_wait(&fThreadExited, &fLock);
+	
+	bool value = !fQuitFlag;
+	pthread_mutex_unlock(&fLock);
+	return value;
 }
 
 
 bool
 ThreadManager::ThreadCheckQuit(void)
 {
-	BAutolock lock(fLock);
+	pthread_mutex_lock(&fLock);
 	bool value = fQuitFlag;
+	pthread_mutex_unlock(&fLock);
 	return value;
 }
 
 
-int8
+int32
 ThreadManager::FindFreeSlot(void)
 {
-	for (int8 i = 0; i < fMaxThreads; i++)
+	for (int32 i = 0; i < fMaxThreads; i++)
 	{
 		thread_id tid = fThreadArray[i];
 		if (tid < 0)
@@ -737,3 +1127,83 @@ ThreadManager::FindFreeSlot(void)
 	return -1;
 }
 
+
+int32
+ProjectBuilder::CheckSyntaxThread(void *data)
+{
+	ProjectBuilder *parent = (ProjectBuilder *)data;
+	BuildSnapshot &snapshot = parent->fSnapshot;
+	
+	thread_id thisThread = find_thread(NULL);
+	
+	BMessage msg;
+	BuildInfo jobInfo;
+	jobInfo.CopySettings(snapshot.Info());
+	ErrorList &errors = jobInfo.errorList;
+	
+	SourceFile *file;
+	int32 job = snapshot.NextFile(&file);
+	
+	while (file)
+	{
+		// Most of a compile's memory goes to parsing, so the same guess
+		// serves here
+		JobSlot slot(gJobPool,
+			parent->fHistory.PredictMemory(file->GetPath().GetFullPath()));
+		
+		parent->Lock();
+		parent->fTotalFilesBuilt++;
+		parent->Unlock();
+		
+		msg.MakeEmpty();
+		msg.what = M_BUILDING_FILE;
+		msg.AddPointer("sourcefile",file);
+		msg.AddInt32("count",parent->fTotalFilesBuilt);
+		msg.AddInt32("total",parent->fTotalFilesToBuild);
+		msg.AddBool("syntaxonly",true);
+		parent->fMsgr.SendMessage(&msg);
+		
+		errors.msglist.MakeEmpty();
+		snapshot.CheckSyntax(file, jobInfo);
+		
+		if (parent->fManager.ThreadCheckQuit())
+		{
+			BTRACE(("Thread %ld asked to quit during syntax check\n",thisThread));
+			slot.Release();
+			parent->fManager.RemoveThread(thisThread);
+			return B_OK;
+		}
+		
+		if (errors.CountErrors() > 0)
+			atomic_add(&parent->fFailedFiles, 1);
+		parent->PublishDiagnostics(job, errors);
+		
+		msg.MakeEmpty();
+		msg.what = M_BUILDING_DONE;
+		msg.AddPointer("sourcefile",file);
+		parent->fMsgr.SendMessage(&msg);
+		
+		job = snapshot.NextFile(&file);
+	}
+	
+	// The last thread to run out of files finishes up. The others have all
+	// handed in their messages by then.
+	if (atomic_add(&parent->fThreadsLeft, -1) == 1)
+	{
+		parent->DeliverDiagnostics(true);
+		
+		parent->Lock();
+		parent->fIsBuilding = false;
+		parent->Unlock();
+		
+		msg.MakeEmpty();
+		msg.what = M_SYNTAX_CHECK_DONE;
+		msg.AddPointer("project",parent->fProject);
+		msg.AddInt32("total",parent->fTotalFilesToBuild);
+		msg.AddInt32("failed",atomic_get(&parent->fFailedFiles));
+		parent->fMsgr.SendMessage(&msg);
+	}
+	
+	parent->fManager.RemoveThread(thisThread);
+	return B_OK;
+}
@@ -4,7 +4,12 @@
 #include <Locker.h>
 #include <Messenger.h>
 #include <String.h>
+#include <pthread.h>
 
+#include "BuildHistory.h"
+#include "BuildSnapshot.h"
+#include "BuildTimings.h"
+#include "CommandRunner.h"
 #include "ErrorParser.h"
 
 enum
@@ -27,7 +32,8 @@ enum
 	M_BUILD_WARNINGS = 'blwr',
 	M_BUILD_FAILURE = 'blfa',
 	M_BUILD_SUCCESS = 'blsc',
-	M_FILE_NEEDS_BUILD = 'fnbl'
+	M_FILE_NEEDS_BUILD = 'fnbl',
+	M_SYNTAX_CHECK_DONE = 'blsy'
 };
 
 class Project;
@@ -35,26 +41,40 @@ class Project;
 class ThreadManager
 {
 public:
-						ThreadManager(uint8 max = 32);
+						ThreadManager(int32 max = 32);
 						~ThreadManager(void);
-						
+	
+	// Must only be called while no threads are running
+	void				SetMaxThreads(int32 max);
+	int32				MaxThreads(void) const { return fMaxThreads; }
+	
 	thread_id			SpawnThread(thread_func func, void *data);
 	void				RemoveThread(thread_id tid);
 	
-	uint8				CountRunningThreads(void);
+	int32				CountRunningThreads(void);
+	
+	// Asks the threads to quit, stops any commands they are running and
+	// waits for them to finish
 	void				QuitAllThreads(void);
 	void				KillAllThreads(bigtime_t quit_timeout = 0);
 	
+	// Blocks until the calling thread is the only one left. Returns false
+	// if the threads were asked to quit in the meantime.
+	bool				WaitForOtherThreads(void);
+	
 	bool				ThreadCheckQuit(void);
 	
 private:
-	int8				FindFreeSlot(void);
+	static	int32		ThreadEntry(void *data);
+	int32				FindFreeSlot(void);
 	
-	BLocker				fLock;
-	uint8				fMaxThreads;
-	uint8				fThreadCount;
+	pthread_mutex_t		fLock;
+	pthread_cond_t		fThreadExited;
+	int32				fMaxThreads;
+	int32				fThreadCount;
 	bool				fQuitFlag;
 	thread_id			*fThreadArray;
+	CommandGroup		fCommands;
 };
 
 class ProjectBuilder : public BLocker
@@ -64,15 +84,51 @@ public:
 						ProjectBuilder(const BMessenger &target);
 						~ProjectBuilder(void);
 						
+			// The stat cache is shared by every builder, so emptying it
+			// before a build is up to the caller
 			void		BuildProject(Project *proj, int32 postbuild);
+			
+			// Builds link the target every time unless this is turned off.
+			// It is then only linked when files were built, or when it is
+			// missing or older than the project file or its libraries.
+			void		SetRelink(bool relink) { fRelink = relink; }
+			
+			// Runs the compiler on the project's C and C++ files without
+			// creating objects, either on all of them or only on those which
+			// need to be built. Messages come as each file is done and
+			// M_SYNTAX_CHECK_DONE at the end.
+			void		CheckSyntax(Project *proj, bool allFiles);
 			void		QuitBuild(void);
 			bool		IsBuilding(void);
 			
+			Project *	GetProject(void) const { return fProject; }
+			BuildTimings &	GetTimings(void) { return fTimings; }
+			
 private:
 			void		DoBuild(void);
 			void		DoPostBuild(void);
-			void		SendErrorMessage(ErrorList &list);
+			void		FinishBuild(void);
+			void		SendSuccessMessage(void);
+			// While streaming, errors are sent as warnings, which doesn't
+			// end the build for whoever is listening
+			void		SendErrorMessage(ErrorList &list, bool streaming = false);
+			
+			// Every file has its own list of messages. They are handed in as
+			// the files finish and sent on in the order the files were taken,
+			// so the output doesn't depend on which thread was faster. When
+			// flushing, files which never finished are skipped.
+			void		ResetDiagnostics(int32 count);
+			void		PublishDiagnostics(int32 job, ErrorList &list);
+			void		DeliverDiagnostics(bool flush);
+			bool		DiagnosticsReady(bool flush);
+			
+			// Sends the errors held back when keeping going, if there are any
+			void		SendFailures(void);
+			
+			// Called before the snapshot is taken
+			bool		TargetOutdated(Project *proj);
 	static	int32		BuildThread(void *data);
+	static	int32		CheckSyntaxThread(void *data);
 	
 	BMessenger			fMsgr;
 	Project				*fProject;
@@ -81,9 +137,38 @@ private:
 	int32				fTotalFilesToBuild;
 	int32				fTotalFilesBuilt;
 	
+	// The expected build time of the files not started yet
+	int64				fQueuedTime;
+	
+	ErrorList			**fDiagnostics;
+	int32				fDiagnosticCount;
+	int32				fNextDelivery;
+	int32				fDelivering;
+	
+	// When keeping going after errors, files which fail don't stop the
+	// build. Their messages are collected here and sent as one failure
+	// once every file has been tried, and nothing is linked.
+	bool				fKeepGoing;
+	int32				fFailedFiles;
+	ErrorList			fFailures;
+	
+	bool				fCheckingSyntax;
+	int32				fThreadsLeft;
+	
 	int32				fPostBuildAction;
 	
+	bool				fRelink;
+	bool				fLinkNeeded;
+	
+	// What the build threads work from instead of the project
+	BuildSnapshot		fSnapshot;
+	
 	ThreadManager		fManager;
+	BuildTimings		fTimings;
+	
+	// How much memory each file took to build before, so that the job pool
+	// can hold jobs back before they run out of memory
+	BuildHistory		fHistory;
 };
 
 #endif
@@ -1,15 +1,21 @@
 #include "SourceFile.h"
 
+#include <Entry.h>
+#include <File.h>
+#include <Node.h>
 #include <Path.h>
 #include <sys/stat.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "BuildInfo.h"
+#include "DebugTools.h"
 #include "Globals.h"
 #include "StatCache.h"
 
 SourceFile::SourceFile(const char *path)
-	:	fNeedsBuild(BUILD_YES),
+	:	fDependenciesScanned(false),
+		fNeedsBuild(BUILD_YES),
 		fType(TYPE_UNKNOWN),
 		fModTime(0)
 {
@@ -18,7 +24,8 @@ SourceFile::SourceFile(const char *path)
 
 
 SourceFile::SourceFile(const entry_ref &ref)
-	:	fNeedsBuild(BUILD_YES),
+	:	fDependenciesScanned(false),
+		fNeedsBuild(BUILD_YES),
 		fType(TYPE_UNKNOWN),
 		fModTime(0)
 {
@@ -35,20 +42,24 @@ SourceFile::~SourceFile(void)
 void
 SourceFile::SetPath(const char *path)
 {
-	fPath = path;
+	fPath.SetTo(path);
 	
 	fNeedsBuild = BUILD_MAYBE;
 	
-	BString ext = fPath.GetExtension();
-	if (ext == "cpp" || ext == "c" || ext == "cc" || ext == "cxx")
+	const char *ext = fPath.Extension();
+	if (!ext)
+		fType = TYPE_UNKNOWN;
+	else if (strcmp(ext, "cpp") == 0 || strcmp(ext, "c") == 0
+			|| strcmp(ext, "cc") == 0 || strcmp(ext, "cxx") == 0)
 		fType = TYPE_C;
-	else if (ext == "so" || ext == "a" || ext == "o")
+	else if (strcmp(ext, "so") == 0 || strcmp(ext, "a") == 0
+			|| strcmp(ext, "o") == 0)
 		fType = TYPE_LIB;
-	else if (ext == "rsrc" || ext == "rdef")
+	else if (strcmp(ext, "rsrc") == 0 || strcmp(ext, "rdef") == 0)
 		fType = TYPE_RESOURCE;
-	else if (ext == "l")
+	else if (strcmp(ext, "l") == 0)
 		fType = TYPE_LEX;
-	else if (ext == "y")
+	else if (strcmp(ext, "y") == 0)
 		fType = TYPE_YACC;
 	else
 		fType = TYPE_UNKNOWN;
@@ -57,13 +68,6 @@ SourceFile::SetPath(const char *path)
 }
 
 
-DPath
-SourceFile::GetPath(void) const
-{
-	return fPath;
-}
-
-
 void
 SourceFile::SetBuildFlag(const int8 &value)
 {
@@ -90,11 +94,11 @@ SourceFile::UpdateModTime(void)
 {
 /*
 	struct stat data;
-	if (stat(fPath.GetFullPath(),&data))
+	if (stat(fPath.FullPath(),&data))
 		return;
 */
 	struct stat data;
-	GetStat(fPath.GetFullPath(),&data);
+	GetStat(fPath.FullPath(),&data);
 	fModTime = data.st_mtime;
 }
 
@@ -104,7 +108,7 @@ SourceFile::GetModTime(void) const
 {
 //	return fModTime;
 	struct stat data;
-	GetStat(fPath.GetFullPath(),&data);
+	GetStat(fPath.FullPath(),&data);
 	return data.st_mtime;
 }
 
@@ -134,41 +138,44 @@ SourceFile::DependsOn(const char *path) const
 		return false;
 	
 	// strip absolute paths down to their filenames
-	BString pathstr(path);
-	int32 pos = pathstr.FindLast("/");
-	if (pos >= 0)
-		pathstr = path + pos + 1;
+	const char *filename = strrchr(path, '/');
+	if (filename)
+		filename++;
+	else
+		filename = path;
 	
-	return (fDependencies.FindFirst(pathstr) != B_ERROR) ? true : false;
+	return (fDependencies.FindFirst(filename) != B_ERROR) ? true : false;
 }
 
 
 DPath
 SourceFile::FindDependency(BuildInfo &info, const char *name)
 {
-	DPath testpath;
-	
 	if (!name || strlen(name) < 1)
-		return testpath;
+		return DPath();
 	
-	DPath file(name);
+	const char *filename = strrchr(name, '/');
+	filename = filename ? filename + 1 : name;
 	
 	// First check the project folder -- typically many includes kept there. :)
-	testpath = info.projectFolder.GetFullPath();
-	testpath.Append(file.GetFileName());
+	BString testpath(info.projectFolder.GetFullPath());
+	testpath << "/" << filename;
 	
-	if (BEntry(testpath.GetFullPath()).Exists())
-		return testpath;
+	struct stat statData;
+	if (stat(testpath.String(), &statData) == 0)
+		return DPath(testpath);
 	
 	int32 count = info.includeList.CountItems();
 	for (int32 i = 0; i < count; i++)
 	{
-		testpath = info.includeList.ItemAt(i)->Absolute().String();
-		testpath.Append(file.GetFileName());
+		const char *folder = info.includeList.ItemAt(i)->AbsoluteHandle().FullPath();
+		if (!folder)
+			continue;
 		
-		BEntry entry(testpath.GetFullPath());
-		if (entry.Exists())
-			return testpath;
+		testpath = folder;
+		testpath << "/" << filename;
+		if (stat(testpath.String(), &statData) == 0)
+			return DPath(testpath);
 	}
 	
 	return DPath();
@@ -200,6 +207,32 @@ SourceFile::PostBuild(BuildInfo &info, const char *options)
 }
 
 
+bool
+SourceFile::CanCheckSyntax(void) const
+{
+	return false;
+}
+
+
+void
+SourceFile::CheckSyntax(BuildInfo &info, const char *options)
+{
+}
+
+
+bool
+SourceFile::CanCompileTo(void) const
+{
+	return false;
+}
+
+
+void
+SourceFile::CompileTo(BuildInfo &info, const char *options, const char *objectPath)
+{
+}
+
+
 void
 SourceFile::RemoveObjects(BuildInfo &info)
 {
@@ -227,6 +260,254 @@ SourceFile::GetResourcePath(BuildInfo &info)
 }
 
 
+void
+SourceFile::GetBuildProducts(BuildInfo &info, BStringList &list)
+{
+	BString folder(info.objectFolder.GetFullPath());
+	folder << "/";
+	
+	// Libraries and prebuilt resources live outside the objects folder
+	// and must never be cleaned up
+	BString path(GetObjectPath(info).GetFullPath());
+	if (path.FindFirst(folder) == 0)
+		list.Add(path);
+	
+	path = GetResourcePath(info).GetFullPath();
+	if (path.FindFirst(folder) == 0)
+		list.Add(path);
+}
+
+
+DPath
+SourceFile::GetBuildPath(BuildInfo &info, const char *extension)
+{
+	// Hash the path relative to the project so that moving the project
+	// doesn't change the names
+	BString key(GetPath().GetFullPath());
+	BString projectFolder(info.projectFolder.GetFullPath());
+	projectFolder << "/";
+	if (key.FindFirst(projectFolder) == 0)
+		key.Remove(0, projectFolder.Length());
+	
+	// 32-bit FNV-1a. Only needs to tell apart the files of one project.
+	uint32 hash = 2166136261UL;
+	for (const char *c = key.String(); *c; c++)
+	{
+		hash ^= (uint8)*c;
+		hash *= 16777619UL;
+	}
+	
+	char hashString[16];
+	sprintf(hashString, "-%08lx", (unsigned long)hash);
+	
+	BString name(GetPath().GetBaseName());
+	name << hashString << extension;
+	
+	DPath path(info.objectFolder);
+	path.Append(name);
+	return path;
+}
+
+
+void
+SourceFile::ScanIncludeDependencies(BuildInfo &info)
+{
+	// Generator inputs can't be handed to g++ -MM, so look for #include
+	// lines ourselves. Lex and Yacc copy them into the generated file from
+	// anywhere they can appear, so the whole file is scanned.
+	BString abspath(MakeAbsolutePath(info.projectFolder, GetPath().GetFullPath()));
+	
+	BFile file(abspath.String(), B_READ_ONLY);
+	off_t size;
+	if (file.InitCheck() != B_OK || file.GetSize(&size) != B_OK)
+		return;
+	
+	BString data;
+	char *buffer = data.LockBuffer(size + 1);
+	ssize_t bytesRead = file.Read(buffer, size);
+	data.UnlockBuffer(bytesRead > 0 ? bytesRead : 0);
+	
+	DPath folder(DPath(abspath).GetFolder());
+	
+	BStringList components;
+	int32 lineStart = 0;
+	while (lineStart < data.Length())
+	{
+		int32 lineEnd = data.FindFirst("\n", lineStart);
+		if (lineEnd < 0)
+			lineEnd = data.Length();
+		
+		BString line;
+		data.CopyInto(line, lineStart, lineEnd - lineStart);
+		lineStart = lineEnd + 1;
+		
+		line.Trim();
+		if (line.FindFirst("#") != 0)
+			continue;
+		
+		line.Remove(0, 1);
+		line.Trim();
+		if (line.FindFirst("include") != 0)
+			continue;
+		
+		line.Remove(0, 7);
+		line.Trim();
+		
+		char close;
+		if (line[0] == '"')
+			close = '"';
+		else if (line[0] == '<')
+			close = '>';
+		else
+			continue;
+		
+		int32 end = line.FindFirst(close, 1);
+		if (end < 2)
+			continue;
+		
+		BString name;
+		line.CopyInto(name, 1, end - 1);
+		
+		// Quoted includes are looked for next to the source first. Anything
+		// which can't be found is a system header and isn't tracked.
+		DPath depPath;
+		if (close == '"')
+		{
+			depPath = folder;
+			depPath.Append(name.String());
+			if (!BEntry(depPath.GetFullPath()).Exists())
+				depPath = DPath();
+		}
+		
+		if (depPath.IsEmpty())
+			depPath = FindDependency(info, name.String());
+		
+		if (!depPath.IsEmpty() && !components.HasString(depPath.GetFullPath()))
+			components.Add(depPath.GetFullPath());
+	}
+	
+	fDependencies = components.Join("|");
+	STRACE(2,("fDependencies now: %s\n",fDependencies.String()));
+}
+
+
+bool
+SourceFile::DependencyIsNewer(BuildInfo &info, time_t time, bool use_cache)
+{
+	if (!fDependenciesScanned && fDependencies.CountChars() < 1)
+	{
+		UpdateDependencies(info);
+		fDependenciesScanned = true;
+	}
+	
+	BStringList components;
+	fDependencies.Split("|", true, components);
+	for (int32 i = 0; i < components.CountStrings(); i++)
+	{
+		struct stat depstat;
+		if (GetStat(components.StringAt(i).String(), &depstat, use_cache) == B_OK
+			&& depstat.st_mtime > time)
+		{
+			STRACE(2,("%s: dependency %s was updated\n",GetPath().GetFullPath(),
+					components.StringAt(i).String()));
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool
+SourceFile::IsOutOfDate(const char *output, time_t inputTime, bool use_cache)
+{
+	struct stat outstat;
+	if (GetStat(output, &outstat, use_cache) != B_OK)
+		return true;
+	
+	return inputTime > outstat.st_mtime;
+}
+
+
+static bool
+files_match(const char *pathOne, const char *pathTwo)
+{
+	BFile one(pathOne, B_READ_ONLY);
+	BFile two(pathTwo, B_READ_ONLY);
+	
+	off_t sizeOne, sizeTwo;
+	if (one.InitCheck() != B_OK || two.InitCheck() != B_OK
+		|| one.GetSize(&sizeOne) != B_OK || two.GetSize(&sizeTwo) != B_OK
+		|| sizeOne != sizeTwo)
+		return false;
+	
+	char bufferOne[16384], bufferTwo[16384];
+	ssize_t bytesRead;
+	while ((bytesRead = one.Read(bufferOne, sizeof(bufferOne))) > 0)
+	{
+		if (two.Read(bufferTwo, bytesRead) != bytesRead
+			|| memcmp(bufferOne, bufferTwo, bytesRead) != 0)
+			return false;
+	}
+	return bytesRead == 0;
+}
+
+
+void
+SourceFile::BeginGeneratedFile(const char *path)
+{
+	BString oldPath(path);
+	oldPath << ".old";
+	
+	BEntry entry(path);
+	if (entry.Exists())
+		entry.Rename(oldPath.String(), true);
+}
+
+
+void
+SourceFile::FinishGeneratedFile(const char *path, const char *product,
+								bool succeeded)
+{
+	BString oldPath(path);
+	oldPath << ".old";
+	
+	BEntry oldEntry(oldPath.String());
+	if (!oldEntry.Exists())
+	{
+		// A failed generator may have left part of a file behind
+		if (!succeeded)
+			BEntry(path).Remove();
+		return;
+	}
+	
+	if (succeeded && !files_match(path, oldPath.String()))
+	{
+		oldEntry.Remove();
+		return;
+	}
+	
+	// Either the generator failed or it made the same file as last time. Put
+	// the old one back and mark it current. If whatever was built from it was
+	// up to date, it still is, so it is kept ahead of the file it came from.
+	struct stat oldstat, productstat;
+	bool productCurrent = succeeded && product
+		&& stat(oldPath.String(), &oldstat) == 0
+		&& stat(product, &productstat) == 0
+		&& productstat.st_mtime >= oldstat.st_mtime;
+	
+	oldEntry.Rename(path, true);
+	if (!succeeded)
+		return;
+	
+	time_t now = real_time_clock();
+	BNode(path).SetModificationTime(now);
+	if (productCurrent)
+	{
+		BNode(product).SetModificationTime(now);
+		STRACE(1,("%s is unchanged, %s is still current\n",path,product));
+	}
+}
+
 BString
 SourceFile::MakeAbsolutePath(DPath relative, const char *path)
 {
@@ -250,12 +531,7 @@ SourceFile::GetStat(const char *path, struct stat *s, bool use_cache) const
 	
 	if (gUseStatCache && use_cache)
 	{
-		struct stat *info = gStatCache.StatFor(path);
-		if (!info)
-			return B_ERROR;
-		
-		*s = *info;
-		return B_OK;
+		return gStatCache.GetStat(path, s) == B_OK ? B_OK : B_ERROR;
 	}
 	
 	return stat(path,s);
@@ -306,15 +582,15 @@ compare_source_files(const SourceFile *one, const SourceFile *two)
 	if (!one)
 		return 1;
 	
-	DPath pathone(one->GetPath());
-	DPath pathtwo(two->GetPath());
+	const char *nameone = one->GetPathHandle().FileName();
+	const char *nametwo = two->GetPathHandle().FileName();
 	
-	if (!pathone.GetFileName())
-		return (pathtwo.GetFileName() != NULL) ? 1 : 0;
+	if (!nameone)
+		return (nametwo != NULL) ? 1 : 0;
 	else
-	if (!pathtwo.GetFileName())
+	if (!nametwo)
 		return -1;
 	
-	return strcmp(pathone.GetFileName(),pathtwo.GetFileName());
+	return strcmp(nameone,nametwo);
 }
 
@@ -2,10 +2,12 @@
 #define SOURCE_FILE_H
 
 #include <String.h>
+#include <StringList.h>
 
 #include "DPath.h"
 #include "ErrorParser.h"
 #include "ObjectList.h"
+#include "PathTable.h"
 
 class BuildInfo;
 class BMenu;
@@ -37,7 +39,8 @@ public:
 	virtual				~SourceFile(void);
 						
 			void		SetPath(const char *path);
-			DPath		GetPath(void) const;
+			const DPath &	GetPath(void) const { return fPath.Path(); }
+			const PathHandle &	GetPathHandle(void) const { return fPath; }
 			
 			void		SetBuildFlag(const int8 &value);
 			int8		BuildFlag(void) const;
@@ -61,23 +64,62 @@ public:
 	virtual	void		Precompile(BuildInfo &info, const char *options);
 	virtual	void		Compile(BuildInfo &info, const char *options);
 	virtual	void		PostBuild(BuildInfo &info, const char *options);
+	
+	// Only reports the compiler's messages, without creating anything
+	virtual	bool		CanCheckSyntax(void) const;
+	virtual	void		CheckSyntax(BuildInfo &info, const char *options);
+	
+	// Compiles into another file than the usual object, so that the result
+	// can be looked at before it replaces the object
+	virtual	bool		CanCompileTo(void) const;
+	virtual	void		CompileTo(BuildInfo &info, const char *options,
+								const char *objectPath);
 	virtual	void		RemoveObjects(BuildInfo &info);
 
 	virtual	DPath		GetObjectPath(BuildInfo &info);
 	virtual	DPath		GetLibraryPath(BuildInfo &info);
 	virtual	DPath		GetResourcePath(BuildInfo &info);
 	
+	// Every file which building this one creates in the objects folder. The
+	// project keeps a manifest of these to clean up after removed files.
+	virtual	void		GetBuildProducts(BuildInfo &info, BStringList &list);
+	
 			BString		MakeAbsolutePath(DPath relative, const char *path);
 	
 			status_t	GetStat(const char *path, struct stat *s,
 								bool use_cache = true) const;
 protected:
+			// Path in the objects folder for a file generated from this one.
+			// The name includes a hash of the source's location so that
+			// files with the same name in different folders don't collide.
+			DPath		GetBuildPath(BuildInfo &info, const char *extension);
+			
+			// Helpers for source types which are turned into another file
+			// (Lex, Yacc, Rez) before being built. Each step only runs when
+			// its own output is out of date.
+			void		ScanIncludeDependencies(BuildInfo &info);
+			bool		DependencyIsNewer(BuildInfo &info, time_t time,
+										bool use_cache = true);
+			bool		IsOutOfDate(const char *output, time_t inputTime,
+									bool use_cache = true);
+			
+			// A generated file is moved aside while its generator runs. If
+			// the new one is identical, the old one is kept so that nothing
+			// built from it is rebuilt.
+			void		BeginGeneratedFile(const char *path);
+			void		FinishGeneratedFile(const char *path, const char *product,
+											bool succeeded);
+	
 	BString			fDependencies;
 	
+	// Set once the dependencies were looked for, since a file which has none
+	// shouldn't be scanned again every time it is checked
+	bool			fDependenciesScanned;
+	
 private:
 	friend class Project;
 	
-	DPath			fPath;
+	PathHandle		fPath;
 					
 	int8			fNeedsBuild;
 	SourceFileType	fType;
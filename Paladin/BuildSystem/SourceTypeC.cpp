@@ -5,6 +5,8 @@
 #include <StringList.h>
 
 #include "BuildInfo.h"
+#include "BuildTimings.h"
+#include "CommandRunner.h"
 #include "DebugTools.h"
 #include "Globals.h"
 
@@ -286,11 +288,7 @@ SourceFileC::CheckNeedsBuild(BuildInfo &info, bool check_deps)
 	}
 	
 	// Object file existence
-	BString objname(GetPath().GetBaseName());
-	objname << ".o";
-	
-	DPath objpath(info.objectFolder);
-	objpath.Append(objname);
+	DPath objpath(GetBuildPath(info, ".o"));
 	if (!BEntry(objpath.GetFullPath()).Exists())
 	{
 		STRACE(2,("%s::CheckNeedsBuild: object doesn't exist\n",GetPath().GetFullPath()));
@@ -329,11 +327,12 @@ SourceFileC::CheckNeedsBuild(BuildInfo &info, bool check_deps)
 	
 	// Dependency check
 	BString str(GetDependencies());
-	if (str.CountChars() < 1)
+	if (!fDependenciesScanned && str.CountChars() < 1)
 	{
 		STRACE(2,("%s::CheckNeedsBuild: initial dependency update\n",
 				GetPath().GetFullPath()));
 		UpdateDependencies(info);
+		fDependenciesScanned = true;
 		str = GetDependencies();
 	}
 	
@@ -379,7 +378,67 @@ SourceTypeC::GetName(void) const
 
 void
 SourceFileC::Compile(BuildInfo &info, const char *options)
-					
+{
+	CompileTo(info, options, GetObjectPath(info).GetFullPath());
+}
+
+
+bool
+SourceFileC::CanCompileTo(void) const
+{
+	return true;
+}
+
+
+void
+SourceFileC::CompileTo(BuildInfo &info, const char *options, const char *objectPath)
+{
+	BString abspath = AbsolutePath(info);
+	BString compileString = CompilerCommand(info, options, abspath.String());
+	
+	// This will make sure that we can still build if ccache is borked
+	if (gUseCCache && gCCacheAvailable)
+		compileString.Prepend("ccache ");
+	
+	compileString	<< " -o '" << objectPath << "' 2>&1";
+	
+	BString errmsg;
+	RunBuildCommand(compileString.String(), errmsg, true);
+	STRACE(1,("Compiling %s\nCommand:%s\nOutput:%s\n",
+			abspath.String(),compileString.String(),errmsg.String()));
+	
+	PhaseTimer timer(TIMING_PARSE_ERRORS);
+	ParseGCCErrors(errmsg.String(),info.errorList);
+}
+
+
+bool
+SourceFileC::CanCheckSyntax(void) const
+{
+	return true;
+}
+
+
+void
+SourceFileC::CheckSyntax(BuildInfo &info, const char *options)
+{
+	BString abspath = AbsolutePath(info);
+	
+	// ccache doesn't cache this, so it is left out
+	BString compileString = CompilerCommand(info, options, abspath.String());
+	compileString << " -fsyntax-only 2>&1";
+	
+	BString errmsg;
+	RunBuildCommand(compileString.String(), errmsg, true);
+	STRACE(1,("Checking syntax of %s\nCommand:%s\nOutput:%s\n",
+			abspath.String(),compileString.String(),errmsg.String()));
+	
+	ParseGCCErrors(errmsg.String(),info.errorList);
+}
+
+
+BString
+SourceFileC::AbsolutePath(BuildInfo &info)
 {
 	BString abspath = GetPath().GetFullPath();
 	if (abspath[0] != '/')
@@ -387,13 +446,16 @@ SourceFileC::Compile(BuildInfo &info, const char *options)
 		abspath.Prepend("/");
 		abspath.Prepend(info.projectFolder.GetFullPath());
 	}
-	
+	return abspath;
+}
+
+
+BString
+SourceFileC::CompilerCommand(BuildInfo &info, const char *options,
+							const char *abspath)
+{
 	BString compileString = "g++ -c ";
 	
-	// This will make sure that we can still build if ccache is borked
-	if (gUseCCache && gCCacheAvailable)
-		compileString.Prepend("ccache ");
-	
 	if (gPlatform == PLATFORM_ZETA)
 		compileString << "-D_ZETA_TS_FIND_DIR_ ";
 	
@@ -407,27 +469,15 @@ SourceFileC::Compile(BuildInfo &info, const char *options)
 	if (options)
 		compileString << options;
 	
-	compileString	<< "'" << abspath
-					<< "' -o '" << GetObjectPath(info).GetFullPath() << "' 2>&1";
-	
-	BString errmsg;
-	RunPipedCommand(compileString.String(), errmsg, true);
-	STRACE(1,("Compiling %s\nCommand:%s\nOutput:%s\n",
-			abspath.String(),compileString.String(),errmsg.String()));
-	
-	ParseGCCErrors(errmsg.String(),info.errorList);
+	compileString << "'" << abspath << "'";
+	return compileString;
 }
 
 
 DPath
 SourceFileC::GetObjectPath(BuildInfo &info)
 {
-	BString objname(GetPath().GetBaseName());
-	objname << ".o";
-	
-	DPath objfolder(info.objectFolder);
-	objfolder.Append(objname);
-	return objfolder;
+	return GetBuildPath(info, ".o");
 }
 
 
@@ -31,9 +31,19 @@ public:
 			void		UpdateDependencies(BuildInfo &info);
 			bool		CheckNeedsBuild(BuildInfo &info, bool check_deps = true);
 			void		Compile(BuildInfo &info, const char *options);
+			bool		CanCheckSyntax(void) const;
+			void		CheckSyntax(BuildInfo &info, const char *options);
+			bool		CanCompileTo(void) const;
+			void		CompileTo(BuildInfo &info, const char *options,
+								const char *objectPath);
 	
 			DPath		GetObjectPath(BuildInfo &info);
 			void		RemoveObjects(BuildInfo &info);
+
+private:
+			BString		CompilerCommand(BuildInfo &info, const char *options,
+										const char *abspath);
+			BString		AbsolutePath(BuildInfo &info);
 };
 
 #endif
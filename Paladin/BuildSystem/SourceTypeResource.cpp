@@ -138,11 +138,7 @@ SourceFileResource::CheckNeedsBuild(BuildInfo &info, bool check_deps)
 	if (BuildFlag() == BUILD_YES)
 		return true;
 	
-	BString objname(GetPath().GetBaseName());
-	objname << ".rsrc";
-	
-	DPath objpath(info.objectFolder);
-	objpath.Append(objname);
+	DPath objpath(GetBuildPath(info, ".rsrc"));
 	if (!BEntry(objpath.GetFullPath()).Exists())
 		return true;
 	
@@ -207,12 +203,7 @@ SourceFileResource::GetResourcePath(BuildInfo &info)
 		return DPath(path);
 	}
 	
-	BString objname(GetPath().GetBaseName());
-	objname << ".rsrc";
-	
-	DPath objfolder(info.objectFolder);
-	objfolder.Append(objname);
-	return objfolder;
+	return GetBuildPath(info, ".rsrc");
 }
 
 
@@ -222,11 +213,7 @@ SourceFileResource::RemoveObjects(BuildInfo &info)
 	if (BString(GetPath().GetExtension()).ICompare("rsrc") == 0)
 		return;
 	
-	DPath path(GetObjectPath(info));
-	BString base = path.GetFolder();
-	base << "/" << path.GetBaseName() << ".rsrc";
-	
-	BEntry(base.String()).Remove();
+	BEntry(GetResourcePath(info).GetFullPath()).Remove();
 }
 
 
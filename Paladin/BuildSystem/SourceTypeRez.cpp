@@ -4,6 +4,8 @@
 #include <Node.h>
 
 #include "BuildInfo.h"
+#include "BuildTimings.h"
+#include "CommandRunner.h"
 #include "DebugTools.h"
 
 SourceTypeRez::SourceTypeRez(void)
@@ -67,39 +69,29 @@ SourceFileRez::UsesBuild(void) const
 }
 
 
+void
+SourceFileRez::UpdateDependencies(BuildInfo &info)
+{
+	if (BString(GetPath().GetExtension()).ICompare("r") == 0)
+		ScanIncludeDependencies(info);
+}
+
+
 bool
 SourceFileRez::CheckNeedsBuild(BuildInfo &info, bool check_deps)
 {
+	// A .r file is built in two steps, and each is skipped when its output
+	// is current:
+	// 1) Preprocessing: text file missing, or older than the .r file or a
+	//    file it includes
+	// 2) rez: resource file missing or older than the text file
+	
 	if (!info.objectFolder.GetFullPath())
 		return false;
 	
 	if (BString(GetPath().GetExtension()).ICompare("r") != 0)
 		return false;
 	
-	if (BuildFlag() == BUILD_YES)
-		return true;
-	
-	BString objname(GetPath().GetBaseName());
-	objname << ".rsrc";
-	
-	DPath objpath(info.objectFolder);
-	objpath.Append(objname);
-	if (!BEntry(objpath.GetFullPath()).Exists())
-		return true;
-	
-	BString tmpname(GetPath().GetBaseName());
-	tmpname << ".r.txt";
-	
-	DPath tmppath(info.objectFolder);
-	tmppath.Append(tmpname);
-	if (!BEntry(tmppath.GetFullPath()).Exists())
-		return true;
-	
-	
-	struct stat objstat;
-	if (stat(objpath.GetFullPath(),&objstat) != 0)
-		return false;
-	
 	// Fix mod times set into the future
 	time_t now = real_time_clock();
 	if (GetModTime() > now)
@@ -108,10 +100,40 @@ SourceFileRez::CheckNeedsBuild(BuildInfo &info, bool check_deps)
 		node.SetModificationTime(now);
 	}
 	
-	if (GetModTime() > objstat.st_mtime)
+	// The includes may have changed along with the file
+	if (check_deps && IsOutOfDate(GetTempFilePath(info).GetFullPath(), GetModTime()))
+		UpdateDependencies(info);
+	
+	if (BuildFlag() == BUILD_YES)
+		return true;
+	
+	return NeedsPreprocess(info, check_deps) || NeedsCompile(info);
+}
+
+
+bool
+SourceFileRez::NeedsPreprocess(BuildInfo &info, bool check_deps, bool use_cache)
+{
+	struct stat tmpstat;
+	if (GetStat(GetTempFilePath(info).GetFullPath(), &tmpstat, use_cache) != B_OK)
+		return true;
+	
+	if (GetModTime() > tmpstat.st_mtime)
+		return true;
+	
+	return check_deps && DependencyIsNewer(info, tmpstat.st_mtime, use_cache);
+}
+
+
+bool
+SourceFileRez::NeedsCompile(BuildInfo &info, bool use_cache)
+{
+	struct stat tmpstat;
+	if (GetStat(GetTempFilePath(info).GetFullPath(), &tmpstat, use_cache) != B_OK)
 		return true;
 	
-	return false;
+	return IsOutOfDate(GetResourcePath(info).GetFullPath(), tmpstat.st_mtime,
+						use_cache);
 }
 
 
@@ -128,27 +150,34 @@ SourceFileRez::Precompile(BuildInfo &info, const char *options)
 	if (BString(GetPath().GetExtension()).ICompare("r") != 0)
 		return;
 	
+	// The files this makes were just written by other steps of the build,
+	// so the stat cache can't be trusted for them
+	if (!NeedsPreprocess(info, true, false))
+	{
+		STRACE(1,("%s: preprocessed file is current\n",abspath.String()));
+		return;
+	}
+	
+	BString tmpPath(GetTempFilePath(info).GetFullPath());
+	BeginGeneratedFile(tmpPath.String());
+	
 	BString pipestr = "gcc -E -x c ";
 	
 	for (int32 i = 0; i < info.includeList.CountItems(); i++)
 		pipestr << "'-I" << info.includeList.ItemAt(i)->Absolute() << "' ";
 	
-	pipestr << "-o '" << GetTempFilePath(info).GetFullPath()
-			<< "' '" << abspath << "' 2>&1";
+	pipestr << "-o '" << tmpPath << "' '" << abspath << "'";
 	
-	FILE *fd = popen(pipestr.String(),"r");
-	if (!fd)
-		return;
-	
-	char buffer[1024];
 	BString errmsg;
-	while (fgets(buffer,1024,fd))
-		errmsg += buffer;
-	pclose(fd);
+	int exitStatus = -1;
+	RunBuildCommand(pipestr.String(), errmsg, true, &exitStatus);
+	FinishGeneratedFile(tmpPath.String(), GetResourcePath(info).GetFullPath(),
+						exitStatus == 0);
 	
 	STRACE(1,("Preprocessing %s\nCommand:%s\nOutput:%s\n",
 			abspath.String(),pipestr.String(),errmsg.String()));
 	
+	PhaseTimer timer(TIMING_PARSE_ERRORS);
 	ParseGCCErrors(errmsg.String(),info.errorList);
 }
 
@@ -166,30 +195,34 @@ SourceFileRez::Compile(BuildInfo &info, const char *options)
 	if (BString(GetPath().GetExtension()).ICompare("r") != 0)
 		return;
 	
+	if (!NeedsCompile(info, false))
+	{
+		STRACE(1,("%s: resource file is current\n",abspath.String()));
+		return;
+	}
+	
 	BString pipestr = "rez -t ";
 	
 	for (int32 i = 0; i < info.includeList.CountItems(); i++)
 		pipestr << "'-I" << info.includeList.ItemAt(i)->Absolute() << "' ";
 	
 	pipestr << "-o '" << GetResourcePath(info).GetFullPath()
-			<< "' '" << GetTempFilePath(info).GetFullPath() << "' 2>&1";
-	
-	FILE *fd = popen(pipestr.String(),"r");
-	if (!fd)
-		return;
+			<< "' '" << GetTempFilePath(info).GetFullPath() << "'";
 	
-	char buffer[1024];
 	BString errmsg;
-	while (fgets(buffer,1024,fd))
-		errmsg += buffer;
-	pclose(fd);
+	RunBuildCommand(pipestr.String(), errmsg, true);
 	
 	STRACE(1,("Compiling %s\nCommand:%s\nOutput:%s\n",
 			abspath.String(),pipestr.String(),errmsg.String()));
 	
+	// The list may already hold warnings from preprocessing, which don't
+	// make the resources any less usable
+	int32 previous = info.errorList.msglist.CountItems();
+	
+	PhaseTimer timer(TIMING_PARSE_ERRORS);
 	ParseRezErrors(errmsg.String(),info.errorList);
 	
-	if (info.errorList.msglist.CountItems() > 0)
+	if (info.errorList.msglist.CountItems() > previous)
 	{
 		BEntry entry(GetResourcePath(info).GetFullPath());
 		entry.Remove();
@@ -203,12 +236,7 @@ SourceFileRez::GetTempFilePath(BuildInfo &info)
 	if (BString(GetPath().GetExtension()).ICompare("r") != 0)
 		return GetPath();
 	
-	BString objname(GetPath().GetBaseName());
-	objname << ".r.txt";
-	
-	DPath objfolder(info.objectFolder);
-	objfolder.Append(objname);
-	return objfolder;
+	return GetBuildPath(info, ".r.txt");
 }
 
 
@@ -218,12 +246,7 @@ SourceFileRez::GetResourcePath(BuildInfo &info)
 	if (BString(GetPath().GetExtension()).ICompare("r") != 0)
 		return GetPath();
 	
-	BString objname(GetPath().GetBaseName());
-	objname << ".rsrc";
-	
-	DPath objfolder(info.objectFolder);
-	objfolder.Append(objname);
-	return objfolder;
+	return GetBuildPath(info, ".rsrc");
 }
 
 
@@ -245,3 +268,14 @@ SourceFileRez::RemoveObjects(BuildInfo &info)
 	base << ".rsrc";
 	BEntry(base.String()).Remove();
 }
+
+
+void
+SourceFileRez::GetBuildProducts(BuildInfo &info, BStringList &list)
+{
+	if (BString(GetPath().GetExtension()).ICompare("r") != 0)
+		return;
+	
+	SourceFile::GetBuildProducts(info, list);
+	list.Add(GetTempFilePath(info).GetFullPath());
+}
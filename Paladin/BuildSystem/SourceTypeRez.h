@@ -25,6 +25,7 @@ public:
 						SourceFileRez(const char *path);
 						SourceFileRez(const entry_ref &ref);
 			bool		UsesBuild(void) const;
+			void		UpdateDependencies(BuildInfo &info);
 			bool		CheckNeedsBuild(BuildInfo &info, bool check_deps = true);
 			void		Precompile(BuildInfo &info, const char *options);
 			void		Compile(BuildInfo &info, const char *options);
@@ -32,6 +33,12 @@ public:
 			DPath		GetTempFilePath(BuildInfo &info);
 			DPath		GetResourcePath(BuildInfo &info);
 			void		RemoveObjects(BuildInfo &info);
+			void		GetBuildProducts(BuildInfo &info, BStringList &list);
+
+private:
+			bool		NeedsPreprocess(BuildInfo &info, bool check_deps,
+										bool use_cache = true);
+			bool		NeedsCompile(BuildInfo &info, bool use_cache = true);
 };
 
 #endif
@@ -4,6 +4,8 @@
 #include <Node.h>
 
 #include "BuildInfo.h"
+#include "BuildTimings.h"
+#include "CommandRunner.h"
 #include "DebugTools.h"
 #include "Globals.h"
 
@@ -64,45 +66,25 @@ SourceFileYacc::UsesBuild(void) const
 }
 
 
+void
+SourceFileYacc::UpdateDependencies(BuildInfo &info)
+{
+	ScanIncludeDependencies(info);
+}
+
+
 bool
 SourceFileYacc::CheckNeedsBuild(BuildInfo &info, bool check_deps)
 {
-	// The checks for a file needing to be built:
-	// 1) Build flag != BUILD_MAYBE => return result
-	// 2) C++ file missing
-	// 3) Object file missing
-	// 4) Yacc mod time > C++ mod time
-	// 5) C++ mod time > object mod time
+	// A Yacc file is built in two steps, and each is skipped when its output
+	// is current:
+	// 1) Yacc -> C++: C++ file missing or older than the Yacc file
+	// 2) C++ -> object: object missing, older than the C++ file, or older
+	//    than a header the Yacc file includes
 	
 	if (!info.objectFolder.GetFullPath())
 		return false;
 	
-	if (BuildFlag() == BUILD_YES)
-		return true;
-	
-	
-	BString cppname(GetPath().GetBaseName());
-	cppname << ".cpp";
-	
-	DPath cppfile(info.objectFolder);
-	cppfile.Append(cppname);
-	if (!BEntry(info.objectFolder.GetFullPath()).Exists())
-		return true;
-	
-	
-	BString objname(GetPath().GetBaseName());
-	objname << ".o";
-	
-	DPath objpath(info.objectFolder);
-	objpath.Append(objname);
-	if (!BEntry(objpath.GetFullPath()).Exists())
-		return true;
-	
-	
-	struct stat cppstat;
-	if (stat(cppfile.GetFullPath(),&cppstat) != 0)
-		return false;
-	
 	// Fix mod times set into the future
 	time_t now = real_time_clock();
 	if (GetModTime() > now)
@@ -111,17 +93,46 @@ SourceFileYacc::CheckNeedsBuild(BuildInfo &info, bool check_deps)
 		node.SetModificationTime(now);
 	}
 	
-	if (GetModTime() > cppstat.st_mtime)
+	bool generate = NeedsGenerate(info);
+	
+	// The includes may have changed along with the file
+	if (generate && check_deps)
+		UpdateDependencies(info);
+	
+	if (BuildFlag() == BUILD_YES || generate)
 		return true;
 	
-	struct stat objstat;
-	if (stat(objpath.GetFullPath(),&objstat) != 0)
+	return NeedsCompile(info, check_deps);
+}
+
+
+bool
+SourceFileYacc::NeedsGenerate(BuildInfo &info, bool use_cache)
+{
+	return IsOutOfDate(GetBuildPath(info, ".cpp").GetFullPath(), GetModTime(),
+						use_cache);
+}
+
+
+bool
+SourceFileYacc::NeedsCompile(BuildInfo &info, bool check_deps, bool use_cache)
+{
+	struct stat cppstat;
+	if (GetStat(GetBuildPath(info, ".cpp").GetFullPath(), &cppstat, use_cache) != B_OK)
+		return true;
+	
+	DPath objpath(GetObjectPath(info));
+	if (IsOutOfDate(objpath.GetFullPath(), cppstat.st_mtime, use_cache))
+		return true;
+	
+	if (!check_deps)
 		return false;
 	
-	if (cppstat.st_mtime > objstat.st_mtime)
+	struct stat objstat;
+	if (GetStat(objpath.GetFullPath(), &objstat, use_cache) != B_OK)
 		return true;
 	
-	return false;
+	return DependencyIsNewer(info, objstat.st_mtime, use_cache);
 }
 
 
@@ -142,18 +153,30 @@ SourceFileYacc::Precompile(BuildInfo &info, const char *options)
 		abspath.Prepend(info.projectFolder.GetFullPath());
 	}
 	
+	// The files this makes were just written by other steps of the build,
+	// so the stat cache can't be trusted for them
+	if (!NeedsGenerate(info, false))
+	{
+		STRACE(1,("%s: generated C++ is current\n",abspath.String()));
+		return;
+	}
+	
 	// Run bison on the .y file to generate C++
-	BString cppPath(info.objectFolder.GetFullPath());
-	cppPath << "/" << GetPath().GetBaseName() << ".cpp";
+	BString cppPath(GetBuildPath(info, ".cpp").GetFullPath());
+	BeginGeneratedFile(cppPath.String());
 	
 	BString bisonString = "bison '-o";
 	bisonString << cppPath << "' '" << abspath << "'";
 	
 	BString errmsg;
-	RunPipedCommand(bisonString.String(), errmsg, true);
+	int exitStatus = -1;
+	RunBuildCommand(bisonString.String(), errmsg, true, &exitStatus);
+	FinishGeneratedFile(cppPath.String(), GetObjectPath(info).GetFullPath(),
+						exitStatus == 0);
 	
 	STRACE(1,("Precompiling %s\nCommand:%s\nOutput:%s\n",
 			abspath.String(),bisonString.String(),errmsg.String()));
+	PhaseTimer timer(TIMING_PARSE_ERRORS);
 	ParseYaccErrors(errmsg.String(),info.errorList);
 }
 
@@ -168,8 +191,13 @@ SourceFileYacc::Compile(BuildInfo &info, const char *options)
 		abspath.Prepend(info.projectFolder.GetFullPath());
 	}
 	
-	BString cppPath(info.objectFolder.GetFullPath());
-	cppPath << "/" << GetPath().GetBaseName() << ".cpp";
+	if (!NeedsCompile(info, true, false))
+	{
+		STRACE(1,("%s: object is current\n",abspath.String()));
+		return;
+	}
+	
+	BString cppPath(GetBuildPath(info, ".cpp").GetFullPath());
 	
 	// Compile the generated C++ file
 	BString compileString = "gcc -c ";
@@ -182,11 +210,12 @@ SourceFileYacc::Compile(BuildInfo &info, const char *options)
 					<< "' -o '" << GetObjectPath(info).GetFullPath() << "'";
 	
 	BString errmsg;
-	RunPipedCommand(compileString.String(), errmsg, true);
+	RunBuildCommand(compileString.String(), errmsg, true);
 	
 	STRACE(1,("Compiling %s\nCommand:%s\nOutput:%s\n",
 			abspath.String(),compileString.String(),errmsg.String()));
 	
+	PhaseTimer timer(TIMING_PARSE_ERRORS);
 	ParseGCCErrors(errmsg.String(),info.errorList);
 }
 
@@ -194,12 +223,7 @@ SourceFileYacc::Compile(BuildInfo &info, const char *options)
 DPath
 SourceFileYacc::GetObjectPath(BuildInfo &info)
 {
-	BString objname(GetPath().GetBaseName());
-	objname << ".o";
-	
-	DPath objfolder(info.objectFolder);
-	objfolder.Append(objname);
-	return objfolder;
+	return GetBuildPath(info, ".o");
 }
 
 
@@ -223,3 +247,12 @@ SourceFileYacc::RemoveObjects(BuildInfo &info)
 		index++;
 	}
 }
+
+
+void
+SourceFileYacc::GetBuildProducts(BuildInfo &info, BStringList &list)
+{
+	SourceFile::GetBuildProducts(info, list);
+	list.Add(GetBuildPath(info, ".cpp").GetFullPath());
+	list.Add(GetBuildPath(info, ".hpp").GetFullPath());
+}
@@ -25,12 +25,19 @@ public:
 						SourceFileYacc(const char *path);
 						SourceFileYacc(const entry_ref &ref);
 			bool		UsesBuild(void) const;
+			void		UpdateDependencies(BuildInfo &info);
 			bool		CheckNeedsBuild(BuildInfo &info, bool check_deps = true);
 			void		Precompile(BuildInfo &info, const char *options);
 			void		Compile(BuildInfo &info, const char *options);
 	
 			DPath		GetObjectPath(BuildInfo &info);
 			void		RemoveObjects(BuildInfo &info);
+			void		GetBuildProducts(BuildInfo &info, BStringList &list);
+
+private:
+			bool		NeedsGenerate(BuildInfo &info, bool use_cache = true);
+			bool		NeedsCompile(BuildInfo &info, bool check_deps,
+									bool use_cache = true);
 };
 
 #endif
@@ -1,6 +1,8 @@
 #include "StatCache.h"
 
+#include <Autolock.h>
 #include <Path.h>
+#include <String.h>
 #include <stdio.h>
 
 StatCache::StatCache(void)
@@ -21,6 +23,7 @@ StatCache::~StatCache(void)
 void
 StatCache::SetRAMLimit(uint32 size)
 {
+	BAutolock lock(fLock);
 	fMaxItems = size / sizeof(struct stat);
 	while (fList.CountItems() > fMaxItems)
 		delete fList.RemoveItemAt(fList.CountItems() - 1);
@@ -37,6 +40,7 @@ StatCache::GetRAMLimit(void) const
 struct stat *
 StatCache::StatFor(entry_ref ref)
 {
+	BAutolock lock(fLock);
 	statdata *item = NULL;
 	for (int32 i = 0; i < fList.CountItems(); i++)
 	{
@@ -85,9 +89,47 @@ StatCache::StatFor(const char *path)
 }
 
 
+status_t
+StatCache::GetStat(const char *path, struct stat *out)
+{
+	if (!path || !out)
+		return B_BAD_VALUE;
+	
+	BAutolock lock(fLock);
+	struct stat *info = StatFor(path);
+	if (!info)
+		return B_ENTRY_NOT_FOUND;
+	
+	*out = *info;
+	return B_OK;
+}
+
+
 void
 StatCache::MakeEmpty(void)
 {
+	BAutolock lock(fLock);
 	fList.MakeEmpty();
 }
 
+
+void
+StatCache::RemoveFolder(const char *path)
+{
+	if (!path)
+		return;
+	
+	BString folder(path);
+	if (folder.ByteAt(folder.Length() - 1) != '/')
+		folder << "/";
+	
+	BAutolock lock(fLock);
+	for (int32 i = fList.CountItems() - 1; i >= 0; i--)
+	{
+		BPath itemPath(&fList.ItemAt(i)->ref);
+		BString itemString(itemPath.Path());
+		itemString << "/";
+		if (itemString.Compare(folder, folder.Length()) == 0)
+			delete fList.RemoveItemAt(i);
+	}
+}
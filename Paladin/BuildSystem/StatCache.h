@@ -3,6 +3,7 @@
 
 #include <sys/stat.h>
 #include <Entry.h>
+#include <Locker.h>
 
 #include "ObjectList.h"
 
@@ -24,9 +25,17 @@ public:
 	struct stat	*	StatFor(entry_ref ref);
 	struct stat	*	StatFor(const char *path);
 	
+	// Thread-safe version of StatFor() which copies the result. Use this when
+	// more than one project may be building at once.
+	status_t		GetStat(const char *path, struct stat *out);
+	
 	void			MakeEmpty(void);
 	
+	// Forgets what is cached for the folder and everything in it
+	void			RemoveFolder(const char *path);
+	
 private:
+	BLocker					fLock;
 	BObjectList<statdata>	fList;
 	int32					fMaxItems;
 };
@@ -0,0 +1,294 @@
+#include "WorkspaceBuilder.h"
+
+#include <Catalog.h>
+#include <stdio.h>
+#include <sys/stat.h>
+
+#include "DebugTools.h"
+#include "DPath.h"
+#include "Globals.h"
+#include "Project.h"
+#include "ProjectBuilder.h"
+#include "SourceFile.h"
+#include "StatCache.h"
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "WorkspaceBuilder"
+
+workspace_item::workspace_item(Project *proj, const BMessenger &target)
+	:	project(proj),
+		builder(new ProjectBuilder(target)),
+		state(WORKSPACE_WAITING),
+		targetModified(0),
+		dependencies(20, false)
+{
+}
+
+
+workspace_item::~workspace_item(void)
+{
+	delete builder;
+}
+
+
+WorkspaceBuilder::WorkspaceBuilder(const BMessenger &target)
+	:	fItems(20, true),
+		fTarget(target)
+{
+}
+
+
+WorkspaceBuilder::~WorkspaceBuilder(void)
+{
+}
+
+
+void
+WorkspaceBuilder::AddProject(Project *proj)
+{
+	if (!proj || FindItem(proj))
+		return;
+	
+	fItems.AddItem(new workspace_item(proj, fTarget));
+}
+
+
+void
+WorkspaceBuilder::Build(void)
+{
+	// Once for all of the projects, since emptying it while one of them is
+	// building would throw away what that one has cached
+	gStatCache.MakeEmpty();
+	
+	for (int32 i = 0; i < fItems.CountItems(); i++)
+	{
+		workspace_item *item = fItems.ItemAt(i);
+		item->targetModified = TargetModified(item->project);
+	}
+	
+	FindDependencies();
+	StartReadyProjects();
+}
+
+
+bool
+WorkspaceBuilder::ProjectFinished(Project *proj, bool success)
+{
+	workspace_item *item = FindItem(proj);
+	
+	// A builder can report more than once, e.g. a failure for each thread
+	// which hit an error. Only the first report counts.
+	if (!item || item->state != WORKSPACE_BUILDING)
+		return IsDone();
+	
+	item->state = success ? WORKSPACE_SUCCEEDED : WORKSPACE_FAILED;
+	STRACE(1,("Workspace project %s finished: %s\n", proj->GetName(),
+			success ? "success" : "failure"));
+	
+	StartReadyProjects();
+	return IsDone();
+}
+
+
+int32
+WorkspaceBuilder::CountProjects(void) const
+{
+	return fItems.CountItems();
+}
+
+
+Project *
+WorkspaceBuilder::ProjectAt(int32 index) const
+{
+	workspace_item *item = fItems.ItemAt(index);
+	return item ? item->project : NULL;
+}
+
+
+ProjectBuilder *
+WorkspaceBuilder::BuilderFor(Project *proj) const
+{
+	workspace_item *item = FindItem(proj);
+	return item ? item->builder : NULL;
+}
+
+
+int32
+WorkspaceBuilder::StateOf(Project *proj) const
+{
+	workspace_item *item = FindItem(proj);
+	return item ? item->state : WORKSPACE_SKIPPED;
+}
+
+
+int32
+WorkspaceBuilder::CountFailures(void) const
+{
+	int32 count = 0;
+	for (int32 i = 0; i < fItems.CountItems(); i++)
+	{
+		int32 state = fItems.ItemAt(i)->state;
+		if (state == WORKSPACE_FAILED || state == WORKSPACE_SKIPPED)
+			count++;
+	}
+	return count;
+}
+
+
+bool
+WorkspaceBuilder::IsDone(void) const
+{
+	for (int32 i = 0; i < fItems.CountItems(); i++)
+	{
+		int32 state = fItems.ItemAt(i)->state;
+		if (state == WORKSPACE_WAITING || state == WORKSPACE_BUILDING)
+			return false;
+	}
+	return true;
+}
+
+
+workspace_item *
+WorkspaceBuilder::FindItem(Project *proj) const
+{
+	for (int32 i = 0; i < fItems.CountItems(); i++)
+	{
+		workspace_item *item = fItems.ItemAt(i);
+		if (item->project == proj)
+			return item;
+	}
+	return NULL;
+}
+
+
+void
+WorkspaceBuilder::FindDependencies(void)
+{
+	// A project depends on another one in the workspace when one of its
+	// libraries has the same file name as the other project's target
+	for (int32 i = 0; i < fItems.CountItems(); i++)
+	{
+		workspace_item *item = fItems.ItemAt(i);
+		Project *proj = item->project;
+		
+		for (int32 j = 0; j < fItems.CountItems(); j++)
+		{
+			workspace_item *other = fItems.ItemAt(j);
+			if (other == item)
+				continue;
+			
+			int32 type = other->project->TargetType();
+			if (type != TARGET_SHARED_LIB && type != TARGET_STATIC_LIB)
+				continue;
+			
+			BString target(other->project->GetTargetName());
+			for (int32 k = 0; k < proj->CountLibraries(); k++)
+			{
+				SourceFile *lib = proj->LibraryAt(k);
+				if (target.Compare(lib->GetPath().GetFileName()) == 0)
+				{
+					STRACE(1,("Workspace: %s depends on %s\n", proj->GetName(),
+							other->project->GetName()));
+					item->dependencies.AddItem(other);
+					break;
+				}
+			}
+		}
+	}
+}
+
+
+void
+WorkspaceBuilder::StartReadyProjects(void)
+{
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (int32 i = 0; i < fItems.CountItems(); i++)
+		{
+			workspace_item *item = fItems.ItemAt(i);
+			if (item->state != WORKSPACE_WAITING)
+				continue;
+			
+			bool ready = true;
+			bool skip = false;
+			for (int32 j = 0; j < item->dependencies.CountItems(); j++)
+			{
+				int32 state = item->dependencies.ItemAt(j)->state;
+				if (state == WORKSPACE_FAILED || state == WORKSPACE_SKIPPED)
+					skip = true;
+				else if (state != WORKSPACE_SUCCEEDED)
+					ready = false;
+			}
+			
+			if (skip)
+			{
+				// Skipping a project may in turn skip the ones depending on it
+				printf(B_TRANSLATE("Skipping %s because a project it depends "
+									"on failed to build\n"), item->project->GetName());
+				item->state = WORKSPACE_SKIPPED;
+				changed = true;
+			}
+			else if (ready)
+			{
+				// Its own files may all be current, but what it links
+				// against isn't
+				bool relink = false;
+				for (int32 j = 0; j < item->dependencies.CountItems(); j++)
+				{
+					workspace_item *dependency = item->dependencies.ItemAt(j);
+					if (TargetModified(dependency->project)
+						!= dependency->targetModified)
+						relink = true;
+				}
+				item->builder->SetRelink(relink);
+				
+				printf(B_TRANSLATE("Building %s\n"), item->project->GetName());
+				item->state = WORKSPACE_BUILDING;
+				item->builder->BuildProject(item->project, POSTBUILD_NOTHING);
+			}
+		}
+	}
+	
+	// If nothing is building but projects are still waiting, they depend on
+	// each other and can never start
+	bool building = false;
+	for (int32 i = 0; i < fItems.CountItems(); i++)
+	{
+		if (fItems.ItemAt(i)->state == WORKSPACE_BUILDING)
+		{
+			building = true;
+			break;
+		}
+	}
+	
+	if (building)
+		return;
+	
+	for (int32 i = 0; i < fItems.CountItems(); i++)
+	{
+		workspace_item *item = fItems.ItemAt(i);
+		if (item->state == WORKSPACE_WAITING)
+		{
+			printf(B_TRANSLATE("Can't build %s: its dependencies on other "
+								"projects form a cycle\n"), item->project->GetName());
+			item->state = WORKSPACE_FAILED;
+		}
+	}
+}
+
+
+time_t
+WorkspaceBuilder::TargetModified(Project *proj) const
+{
+	DPath targetPath(proj->GetPath().GetFolder());
+	targetPath.Append(proj->GetTargetName());
+	
+	// Not from the stat cache, which may still hold the time from before
+	// the target was linked
+	struct stat target;
+	if (stat(targetPath.GetFullPath(), &target) != 0)
+		return 0;
+	return target.st_mtime;
+}
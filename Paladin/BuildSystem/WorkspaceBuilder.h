@@ -0,0 +1,76 @@
+#ifndef WORKSPACE_BUILDER_H
+#define WORKSPACE_BUILDER_H
+
+#include <Messenger.h>
+#include <time.h>
+
+#include "ObjectList.h"
+
+class Project;
+class ProjectBuilder;
+
+enum
+{
+	WORKSPACE_WAITING = 0,
+	WORKSPACE_BUILDING,
+	WORKSPACE_SUCCEEDED,
+	WORKSPACE_FAILED,
+	WORKSPACE_SKIPPED
+};
+
+class workspace_item
+{
+public:
+							workspace_item(Project *proj,
+											const BMessenger &target);
+							~workspace_item(void);
+	
+	Project					*project;
+	ProjectBuilder			*builder;
+	int32					state;
+	
+	// When the target was last changed before the build, 0 if it was
+	// missing
+	time_t					targetModified;
+	
+	// Projects whose targets this one links against. Not owned.
+	BObjectList<workspace_item>	dependencies;
+};
+
+// Builds several projects at once from the command line. Every project gets
+// its own ProjectBuilder, and all of them share gJobPool, so one project can
+// link while another is still compiling. A project which links against the
+// target of another project in the workspace isn't started until that
+// project has been built successfully, and is relinked if that changed the
+// target. Otherwise a project is only linked when something in it changed.
+class WorkspaceBuilder
+{
+public:
+							WorkspaceBuilder(const BMessenger &target);
+							~WorkspaceBuilder(void);
+	
+			void			AddProject(Project *proj);
+			void			Build(void);
+	
+	// Call this for every M_BUILD_SUCCESS and M_BUILD_FAILURE received from
+	// one of the builders. Returns true once every project has finished.
+			bool			ProjectFinished(Project *proj, bool success);
+	
+			int32			CountProjects(void) const;
+			Project *		ProjectAt(int32 index) const;
+			ProjectBuilder *BuilderFor(Project *proj) const;
+			int32			StateOf(Project *proj) const;
+			int32			CountFailures(void) const;
+			bool			IsDone(void) const;
+	
+private:
+			workspace_item *FindItem(Project *proj) const;
+			void			FindDependencies(void);
+			void			StartReadyProjects(void);
+			time_t			TargetModified(Project *proj) const;
+	
+	BObjectList<workspace_item>	fItems;
+	BMessenger				fTarget;
+};
+
+#endif
@@ -0,0 +1,42 @@
+#include "BuildTimingsWindow.h"
+
+#include <Catalog.h>
+#include <Font.h>
+#include <LayoutBuilder.h>
+#include <ScrollView.h>
+#include <String.h>
+
+#include "BuildTimings.h"
+
+#undef B_TRANSLATION_CONTEXT
+#define B_TRANSLATION_CONTEXT "BuildTimingsWindow"
+
+// Beyond this many files the report is more noise than help
+#define SLOWEST_FILE_LIMIT 25
+
+BuildTimingsWindow::BuildTimingsWindow(const char *projectName,
+										BuildTimings &timings)
+  :	DWindow(BRect(0,0,640,360), B_TRANSLATE("Build timings"))
+{
+	MakeCenteredOnShow(true);
+	
+	BString title(B_TRANSLATE("Build timings: %project%"));
+	title.ReplaceFirst("%project%", projectName);
+	SetTitle(title.String());
+	
+	fReport = new BTextView("report");
+	fReport->SetFontAndColor(be_fixed_font);
+	fReport->MakeEditable(false);
+	fReport->SetWordWrap(false);
+	
+	if (timings.CountFiles() > 0)
+		fReport->SetText(timings.Summary(SLOWEST_FILE_LIMIT).String());
+	else
+		fReport->SetText(B_TRANSLATE("No files have been built yet. Build the "
+									"project to see which files are slowest."));
+	
+	BScrollView *sv = new BScrollView("scrollview", fReport, 0, true, true);
+	BLayoutBuilder::Group<>(this, B_VERTICAL, 0)
+		.SetInsets(0)
+		.Add(sv);
+}
@@ -0,0 +1,20 @@
+#ifndef BUILDTIMINGS_WINDOW_H
+#define BUILDTIMINGS_WINDOW_H
+
+#include <TextView.h>
+
+#include "DWindow.h"
+
+class BuildTimings;
+
+// Shows the slowest files of the last build of a project
+class BuildTimingsWindow : public DWindow
+{
+public:
+			BuildTimingsWindow(const char *projectName, BuildTimings &timings);
+	
+private:
+	BTextView	*fReport;
+};
+
+#endif
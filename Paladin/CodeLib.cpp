@@ -1,8 +1,9 @@
 #include "CodeLib.h"
 
+#include <Autolock.h>
 #include <Directory.h>
 #include <FindDirectory.h>
-#include <map>
+#include <OS.h>
 #include <Path.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -10,6 +11,8 @@
 #include <vector>
 
 #include "DNode.h"
+#include "FileHash.h"
+#include "FileUtils.h"
 #include "Globals.h"
 #include "Project.h"
 #include "SourceFile.h"
@@ -24,7 +27,16 @@ using namespace std;
 static BString sCodeLibraryPath;
 
 typedef vector<SourceFile*> SourceFileVector;
-typedef map<BString,SourceFileVector> ModuleMap;
+
+struct module_sync_data
+{
+	CodeLib				*lib;
+	SourceFileVector	files;
+	vector<uint8>		updated;
+	int32				next;
+};
+
+static int32 SyncModuleThread(void *data);
 
 
 BString
@@ -370,17 +382,13 @@ CodeModule::ExportFile(ModFile *file, const char *folder)
 	if(!node.IsFile())
 		return B_BAD_VALUE;
 	
-	BPath srcpath(file->path.GetFullPath());
-	
 	entry.SetTo(folder);
 	if (!entry.Exists())
 		create_directory(folder,0777);
 	
-	BString command;
-	command << "copyattr --data '" << srcpath.Path() << "' '" << folder << "'";
-	system(command.String());
-	
-	return B_OK;
+	DPath destpath(folder);
+	destpath << file->path.GetFileName();
+	return CopyFile(file->path.GetFullPath(), destpath.GetFullPath());
 }
 
 
@@ -392,7 +400,7 @@ CodeModule::SyncWithFile(const char *path, bool *updated)
 		return B_ERROR;
 	
 	// 1) Make sure file exists in both folders and skip to the next file if not the case
-	// 2) Get MD5 hashes of both files.
+	// 2) Get the content hashes of both files.
 	// 3) If the hashes are the same, make sure that the update time attribute and their modtimes
 	//	  are set to the earlier of the two files
 	// 4) If the hashes are different, get the mod times for each and copy the newer one over the
@@ -405,36 +413,14 @@ CodeModule::SyncWithFile(const char *path, bool *updated)
 	if (!BEntry(modfile->path.GetFullPath()).Exists())
 		return B_ERROR;
 	
-	BString command;
-	command << "md5sum '" << modfile->path.GetFullPath() << "' '" << folderfile.GetFullPath() << "'";
-	FILE *fd = popen(command.String(),"r");
-	
-	if (!fd)
-	{
-		printf("Bailed out on sync command for %s: NULL pipe descriptor\n", path);
-		return B_BAD_VALUE;
-	}
-	
-	BString out;
-	char buffer[1024];
-	while (fgets(buffer,1024,fd)) {
-		if (!ferror(fd)) {
-			out += buffer;
-		}
-	}
-	
-	int status = pclose(fd);
-	if (0 != status) {
-		STRACE(2,("pclose returned non zero (error) code: %i",status));
-	}
-	
-	BString srcmd5;
-	srcmd5 = out;
-	int32 pos = srcmd5.FindFirst("\n");
-	srcmd5.Truncate(32);
-	
-	BString destmd5 = out.String() + pos + 1;
-	destmd5.Truncate(32);
+	// Most of the time neither side has changed since the last sync, so
+	// the hashes come from the cache without reading either file.
+	uint64 srchash, desthash;
+	status_t status = gHashCache.GetFileHash(modfile->path.GetFullPath(), &srchash);
+	if (status == B_OK)
+		status = gHashCache.GetFileHash(folderfile.GetFullPath(), &desthash);
+	if (status != B_OK)
+		return status;
 	
 	DNode srcnode(modfile->path.GetFullPath());
 	DNode destnode(folderfile.GetFullPath());
@@ -443,7 +429,7 @@ CodeModule::SyncWithFile(const char *path, bool *updated)
 	srcnode.GetModificationTime(&srctime);
 	destnode.GetModificationTime(&desttime);
 	
-	if (srcmd5 == destmd5)
+	if (srchash == desthash)
 	{
 		if (srctime < desttime)
 			destnode.SetModificationTime(srctime);
@@ -453,22 +439,24 @@ CodeModule::SyncWithFile(const char *path, bool *updated)
 	}
 	else
 	{
-		command = "";
 		if (srctime < desttime)
-			command << "copyattr --data '" << folderfile.GetFullPath() << "' '" << modfile->path.GetFullPath() << "'";
+		{
+			STRACE(1,("Sync: %s -> %s\n",folderfile.GetFullPath(),
+					modfile->path.GetFullPath()));
+			status = CopyFile(folderfile.GetFullPath(), modfile->path.GetFullPath());
+		}
 		else
 		if (srctime > desttime)
 		{
-			command << "copyattr --data '" << modfile->path.GetFullPath() << "' '" << folderfile.GetFullPath() << "'";
-			if (updated)
+			STRACE(1,("Sync: %s -> %s\n",modfile->path.GetFullPath(),
+					folderfile.GetFullPath()));
+			status = CopyFile(modfile->path.GetFullPath(), folderfile.GetFullPath());
+			if (status == B_OK && updated)
 				*updated = true;
 		}
-		printf("srctime = %ld, desttime = %ld\n",srctime,desttime);
-		printf("sync command: %s\n",command.String());
-		system(command.String());
 	}
 	
-	return B_OK;
+	return status;
 }
 
 
@@ -518,9 +506,7 @@ CodeModule::ImportFile(const char *path)
 	if (node.InitCheck() == B_OK)
 		node.GetModificationTime(&oldmodtime);
 	
-	BString command;
-	command << "copyattr --data '" << srcpath.Path() << "' '" << destpath.Path() << "'";
-	system(command.String());
+	CopyFile(srcpath.Path(), destpath.Path());
 	
 	time_t newmodtime = 0;
 	node.SetTo(destpath.Path());
@@ -832,6 +818,29 @@ CodeLib::PrintToStream(void)
 }
 
 
+static int32
+SyncModuleThread(void *data)
+{
+	module_sync_data *syncData = (module_sync_data*)data;
+	
+	// Each thread takes the next file until there are none left
+	int32 index;
+	while ((index = atomic_add(&syncData->next, 1)) < (int32)syncData->files.size())
+	{
+		const char *path = syncData->files[index]->GetPath().GetFullPath();
+		CodeModule *mod = syncData->lib->FindModuleForFile(path);
+		if (!mod)
+			continue;
+		
+		bool updated = false;
+		mod->SyncWithFile(path, &updated);
+		if (updated)
+			syncData->updated[index] = 1;
+	}
+	return 0;
+}
+
+
 void
 SyncProjectModules(CodeLib &lib, Project *project)
 {
@@ -850,21 +859,22 @@ SyncProjectModules(CodeLib &lib, Project *project)
 	/*
 		Sync Process:
 		
-		1) Scan for modules and save the item for each module file into a map of vectors.
-		2) Run the rsync on a module as --list-only and parse the output to find out what files are updated.
-		2b) If any of the changed files are new, add them to the project -- need to be able to specify a group
-		2c) Run the rsync for real --> rsync -rX <user>/config/share/Paladin/CodeLibrary/<modulename>  <projectfolder>/ModuleFiles
-		2d) Iterate through the module vector and see if any files disappeared. If they did, remove them from the project
+		1) Gather the project's source files.
+		2) On several threads, find the module each file came from and sync the file with the
+		   module's copy. Content hashes are cached by inode and mod time, so unchanged files
+		   aren't read.
+		3) Mark the project files which were updated from the library for rebuilding.
+		
+		Files which were added or removed on only one side are not handled yet.
 	*/
 	
 	project->Lock();
 	
-	DPath modulesPath = project->GetPath();
-	modulesPath << "ProjectModules";
-	
-	// Step 1: Scan for modules in the project and save them into a map which
-	// contains vectors for each of the source files.
-	ModuleMap modmap;
+	// Step 1: Collect the project's files. Which module a file belongs to is
+	// kept in an attribute, so that is read by the sync threads, too.
+	module_sync_data data;
+	data.lib = &lib;
+	data.next = 0;
 	
 	for (int32 i = 0; i < project->CountGroups(); i++)
 	{
@@ -872,37 +882,43 @@ SyncProjectModules(CodeLib &lib, Project *project)
 		for (int32 j = 0; j < group->filelist.CountItems(); j++)
 		{
 			SourceFile *file = group->filelist.ItemAt(j);
-			CodeModule *mod = lib.FindModuleForFile(file->GetPath().GetFullPath());
-			
-			if (mod)
-			{
-				if (modmap.find(mod->GetName()) == modmap.end())
-					modmap.insert(pair<BString,SourceFileVector>(mod->GetName(),SourceFileVector()));
-				modmap[mod->GetName()].push_back(file);
-			}
+			data.files.push_back(file);
+			data.updated.push_back(0);
 		}
 	}
 	
-	// Step 2: Run the rsync on a module as --list-only and parse the output to find
-	// out what files are updated.
-	ModuleMap::iterator mapIndex;
-	for (mapIndex = modmap.begin(); mapIndex != modmap.end(); mapIndex++)
+	// Step 2: Compare each file with its module's copy and copy over the
+	// older one of any pair which differs
+	int32 threadCount = MIN((int32)gCPUCount, (int32)data.files.size());
+	vector<thread_id> threads;
+	for (int32 i = 0; i < threadCount; i++)
 	{
-		BString command, out;
-		
-		DPath syncPath(modulesPath);
-		syncPath << mapIndex->first;
-		
-		DPath sysmodsPath(GetCodeLibraryPath());
-		sysmodsPath << mapIndex->first;
-		
-		command = "rsync -avz --delete-during --list-only '";
-		command << syncPath.GetFullPath() << "' '" << sysmodsPath.GetFullPath() << "'";
-		RunPipedCommand(command.String(), out, false);
-		
-		printf("%s\n", out.String());
+		thread_id thread = spawn_thread(SyncModuleThread, "module sync",
+										B_NORMAL_PRIORITY, &data);
+		if (thread >= 0 && resume_thread(thread) == B_OK)
+			threads.push_back(thread);
+	}
+	
+	if (threads.empty())
+		SyncModuleThread(&data);
+	
+	for (uint32 i = 0; i < threads.size(); i++)
+	{
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+	
+	// Step 3: Project files which were replaced need to be rebuilt
+	for (uint32 i = 0; i < data.files.size(); i++)
+	{
+		if (data.updated[i])
+		{
+			data.files[i]->UpdateModTime();
+			data.files[i]->SetBuildFlag(BUILD_YES);
+		}
 	}
 	
+	gHashCache.Save();
 	
 	project->Unlock();
 #endif
@@ -0,0 +1,368 @@
+#include "FileHash.h"
+
+#include <Autolock.h>
+#include <ByteOrder.h>
+#include <File.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "DebugTools.h"
+#include "TextFile.h"
+
+#define HASH_CACHE_HEADER "# Paladin hash cache 1"
+
+// Beyond this, only the entries used in the current session are saved
+#define HASH_CACHE_MAX_ENTRIES 20000
+
+static const uint64 kPrime1 = 0x9E3779B185EBCA87ULL;
+static const uint64 kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64 kPrime3 = 0x165667B19E3779F9ULL;
+static const uint64 kPrime4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64 kPrime5 = 0x27D4EB2F165667C5ULL;
+
+
+static inline uint64
+rotate_left(uint64 value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+
+static inline uint64
+read64(const uint8 *data)
+{
+	uint64 value;
+	memcpy(&value, data, sizeof(value));
+	return B_LENDIAN_TO_HOST_INT64(value);
+}
+
+
+static inline uint32
+read32(const uint8 *data)
+{
+	uint32 value;
+	memcpy(&value, data, sizeof(value));
+	return B_LENDIAN_TO_HOST_INT32(value);
+}
+
+
+static inline uint64
+hash_round(uint64 accumulator, uint64 input)
+{
+	accumulator += input * kPrime2;
+	accumulator = rotate_left(accumulator, 31);
+	return accumulator * kPrime1;
+}
+
+
+static inline uint64
+merge_round(uint64 hash, uint64 accumulator)
+{
+	hash ^= hash_round(0, accumulator);
+	return hash * kPrime1 + kPrime4;
+}
+
+
+FileHasher::FileHasher(uint64 seed)
+{
+	Reset(seed);
+}
+
+
+void
+FileHasher::Reset(uint64 seed)
+{
+	fSeed = seed;
+	fTotalLength = 0;
+	fBufferSize = 0;
+	fAccumulators[0] = seed + kPrime1 + kPrime2;
+	fAccumulators[1] = seed + kPrime2;
+	fAccumulators[2] = seed;
+	fAccumulators[3] = seed - kPrime1;
+}
+
+
+void
+FileHasher::Update(const void *data, size_t length)
+{
+	if (!data || length == 0)
+		return;
+
+	const uint8 *input = (const uint8*)data;
+	const uint8 *end = input + length;
+	fTotalLength += length;
+
+	// Not enough for a whole stripe yet
+	if (fBufferSize + length < 32)
+	{
+		memcpy(fBuffer + fBufferSize, input, length);
+		fBufferSize += length;
+		return;
+	}
+
+	if (fBufferSize > 0)
+	{
+		uint32 fill = 32 - fBufferSize;
+		memcpy(fBuffer + fBufferSize, input, fill);
+		for (int i = 0; i < 4; i++)
+			fAccumulators[i] = hash_round(fAccumulators[i], read64(fBuffer + i * 8));
+		input += fill;
+		fBufferSize = 0;
+	}
+
+	uint64 v1 = fAccumulators[0];
+	uint64 v2 = fAccumulators[1];
+	uint64 v3 = fAccumulators[2];
+	uint64 v4 = fAccumulators[3];
+	while (input + 32 <= end)
+	{
+		v1 = hash_round(v1, read64(input));
+		v2 = hash_round(v2, read64(input + 8));
+		v3 = hash_round(v3, read64(input + 16));
+		v4 = hash_round(v4, read64(input + 24));
+		input += 32;
+	}
+	fAccumulators[0] = v1;
+	fAccumulators[1] = v2;
+	fAccumulators[2] = v3;
+	fAccumulators[3] = v4;
+
+	if (input < end)
+	{
+		fBufferSize = end - input;
+		memcpy(fBuffer, input, fBufferSize);
+	}
+}
+
+
+uint64
+FileHasher::Digest(void) const
+{
+	uint64 hash;
+	if (fTotalLength >= 32)
+	{
+		hash = rotate_left(fAccumulators[0], 1) + rotate_left(fAccumulators[1], 7)
+			+ rotate_left(fAccumulators[2], 12) + rotate_left(fAccumulators[3], 18);
+		for (int i = 0; i < 4; i++)
+			hash = merge_round(hash, fAccumulators[i]);
+	}
+	else
+		hash = fSeed + kPrime5;
+
+	hash += fTotalLength;
+
+	const uint8 *input = fBuffer;
+	const uint8 *end = fBuffer + fBufferSize;
+	while (input + 8 <= end)
+	{
+		hash ^= hash_round(0, read64(input));
+		hash = rotate_left(hash, 27) * kPrime1 + kPrime4;
+		input += 8;
+	}
+
+	if (input + 4 <= end)
+	{
+		hash ^= (uint64)read32(input) * kPrime1;
+		hash = rotate_left(hash, 23) * kPrime2 + kPrime3;
+		input += 4;
+	}
+
+	while (input < end)
+	{
+		hash ^= *input * kPrime5;
+		hash = rotate_left(hash, 11) * kPrime1;
+		input++;
+	}
+
+	hash ^= hash >> 33;
+	hash *= kPrime2;
+	hash ^= hash >> 29;
+	hash *= kPrime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+
+uint64
+HashData(const void *data, size_t length, uint64 seed)
+{
+	FileHasher hasher(seed);
+	hasher.Update(data, length);
+	return hasher.Digest();
+}
+
+
+status_t
+HashFile(const char *path, uint64 *hash)
+{
+	if (!path || !hash)
+		return B_BAD_VALUE;
+
+	BFile file(path, B_READ_ONLY);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+
+	const size_t kBufferSize = 64 * 1024;
+	char *buffer = (char*)malloc(kBufferSize);
+	if (!buffer)
+		return B_NO_MEMORY;
+
+	FileHasher hasher;
+	ssize_t bytesRead;
+	while ((bytesRead = file.Read(buffer, kBufferSize)) > 0)
+		hasher.Update(buffer, bytesRead);
+
+	free(buffer);
+	if (bytesRead < 0)
+		return bytesRead;
+
+	*hash = hasher.Digest();
+	return B_OK;
+}
+
+
+HashCache::HashCache(void)
+	:	fLock("hash cache"),
+		fDirty(false)
+{
+}
+
+
+status_t
+HashCache::Load(const char *path)
+{
+	if (!path)
+		return B_BAD_VALUE;
+
+	BAutolock lock(fLock);
+	fPath = path;
+	fEntries.clear();
+	fDirty = false;
+
+	TextFile file(path, B_READ_ONLY);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+
+	const char *start;
+	int32 length;
+	while (file.NextLine(start, length))
+	{
+		BString line(start, length);
+		if (line.CountChars() < 1 || line[0] == '#')
+			continue;
+
+		long device;
+		long long node, fileSize, modTime;
+		unsigned long long hash;
+		if (sscanf(line.String(), "%ld %lld %lld %lld %llx", &device, &node,
+				&fileSize, &modTime, &hash) != 5)
+			continue;
+
+		hash_entry entry;
+		entry.modTime = (time_t)modTime;
+		entry.size = (off_t)fileSize;
+		entry.hash = (uint64)hash;
+		entry.used = false;
+		fEntries[NodeKey((dev_t)device, (ino_t)node)] = entry;
+	}
+
+	return B_OK;
+}
+
+
+status_t
+HashCache::Save(void)
+{
+	BAutolock lock(fLock);
+	if (fPath.CountChars() < 1)
+		return B_NO_INIT;
+
+	if (!fDirty)
+		return B_OK;
+
+	bool usedOnly = fEntries.size() > HASH_CACHE_MAX_ENTRIES;
+
+	BString data(HASH_CACHE_HEADER);
+	data << "\n";
+
+	char line[128];
+	for (EntryMap::const_iterator i = fEntries.begin(); i != fEntries.end(); i++)
+	{
+		if (usedOnly && !i->second.used)
+			continue;
+
+		sprintf(line, "%ld %lld %lld %lld %016llx\n", (long)i->first.first,
+				(long long)i->first.second, (long long)i->second.size,
+				(long long)i->second.modTime, (unsigned long long)i->second.hash);
+		data << line;
+	}
+
+	BFile file(fPath.String(), B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+
+	ssize_t written = file.Write(data.String(), data.Length());
+	if (written != data.Length())
+		return B_IO_ERROR;
+
+	fDirty = false;
+	return B_OK;
+}
+
+
+status_t
+HashCache::GetFileHash(const char *path, uint64 *hash)
+{
+	if (!path || !hash)
+		return B_BAD_VALUE;
+
+	struct stat statData;
+	if (stat(path, &statData) != 0)
+		return B_ENTRY_NOT_FOUND;
+
+	NodeKey key(statData.st_dev, statData.st_ino);
+
+	fLock.Lock();
+	EntryMap::iterator i = fEntries.find(key);
+	if (i != fEntries.end() && i->second.modTime == statData.st_mtime
+		&& i->second.size == statData.st_size)
+	{
+		i->second.used = true;
+		*hash = i->second.hash;
+		fLock.Unlock();
+		return B_OK;
+	}
+	fLock.Unlock();
+
+	// Hash without holding the lock so that several files can be read at once
+	status_t status = HashFile(path, hash);
+	if (status != B_OK)
+		return status;
+
+	// Modification times only have a resolution of a second, so a file
+	// written during the current second could change again without its
+	// time changing. Don't remember those.
+	if (statData.st_mtime >= time(NULL) - 1)
+		return B_OK;
+
+	// Nor ones which changed while they were being read
+	struct stat afterData;
+	if (stat(path, &afterData) != 0 || afterData.st_mtime != statData.st_mtime
+		|| afterData.st_size != statData.st_size)
+		return B_OK;
+
+	hash_entry entry;
+	entry.modTime = statData.st_mtime;
+	entry.size = statData.st_size;
+	entry.hash = *hash;
+	entry.used = true;
+
+	BAutolock lock(fLock);
+	fEntries[key] = entry;
+	fDirty = true;
+
+	STRACE(2,("Hashed %s: %016llx\n", path, (unsigned long long)*hash));
+	return B_OK;
+}
@@ -0,0 +1,64 @@
+#ifndef FILEHASH_H
+#define FILEHASH_H
+
+#include <Locker.h>
+#include <String.h>
+#include <map>
+#include <sys/stat.h>
+
+// 64-bit XXH64 content hash. It is not meant to stand up to someone
+// tampering with files, only to tell quickly whether two files differ.
+class FileHasher
+{
+public:
+						FileHasher(uint64 seed = 0);
+
+			void		Reset(uint64 seed = 0);
+			void		Update(const void *data, size_t length);
+			uint64		Digest(void) const;
+
+private:
+			uint64		fTotalLength;
+			uint64		fAccumulators[4];
+			uint8		fBuffer[32];
+			uint32		fBufferSize;
+			uint64		fSeed;
+};
+
+uint64		HashData(const void *data, size_t length, uint64 seed = 0);
+status_t	HashFile(const char *path, uint64 *hash);
+
+
+// Remembers the hashes of files by volume and inode so that a file which
+// hasn't changed since it was last hashed doesn't have to be read again.
+// Entries are checked against the file's size and modification time, and
+// it is kept on disk between sessions.
+class HashCache
+{
+public:
+						HashCache(void);
+
+			status_t	Load(const char *path);
+			status_t	Save(void);
+
+			status_t	GetFileHash(const char *path, uint64 *hash);
+
+private:
+	struct hash_entry
+	{
+		time_t	modTime;
+		off_t	size;
+		uint64	hash;
+		bool	used;
+	};
+
+	typedef std::pair<dev_t, ino_t>			NodeKey;
+	typedef std::map<NodeKey, hash_entry>	EntryMap;
+
+	BLocker			fLock;
+	BString			fPath;
+	EntryMap		fEntries;
+	bool			fDirty;
+};
+
+#endif
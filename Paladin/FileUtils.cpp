@@ -4,10 +4,13 @@
 #include <Bitmap.h>
 #include <Catalog.h>
 #include <Directory.h>
+#include <File.h>
 #include <Locale.h>
 #include <Mime.h>
 #include <Path.h>
 #include <Roster.h>
+#include <fs_attr.h>
+#include <stdlib.h>
 
 #include "Icons.h"
 #include "Paladin.h"
@@ -159,3 +162,96 @@ FindProject(entry_ref folder, const char *name)
 		entry.GetRef(&returnRef);
 	return returnRef;
 }
+
+
+status_t
+CopyFile(const char *source, const char *dest)
+{
+	if (!source || !dest)
+		return B_BAD_VALUE;
+	
+	BFile in(source, B_READ_ONLY);
+	if (in.InitCheck() != B_OK)
+		return in.InitCheck();
+	
+	struct stat statData;
+	status_t status = in.GetStat(&statData);
+	if (status != B_OK)
+		return status;
+	
+	BString tempPath(dest);
+	tempPath << ".paladin-copy";
+	
+	BFile out(tempPath.String(), B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (out.InitCheck() != B_OK)
+		return out.InitCheck();
+	
+	// There is no kernel-side file copy to hand this to, so use a buffer big
+	// enough that most source files are copied with one read and one write.
+	size_t bufferSize = 256 * 1024;
+	if (statData.st_size > 0 && (off_t)bufferSize > statData.st_size)
+		bufferSize = statData.st_size;
+	
+	char *buffer = (char*)malloc(bufferSize > 0 ? bufferSize : 1);
+	if (!buffer)
+		status = B_NO_MEMORY;
+	
+	while (status == B_OK)
+	{
+		ssize_t bytesRead = in.Read(buffer, bufferSize);
+		if (bytesRead <= 0)
+		{
+			if (bytesRead < 0)
+				status = bytesRead;
+			break;
+		}
+		
+		ssize_t bytesWritten = out.Write(buffer, bytesRead);
+		if (bytesWritten != bytesRead)
+			status = (bytesWritten < 0) ? bytesWritten : B_IO_ERROR;
+	}
+	
+	// Attributes
+	char name[B_ATTR_NAME_LENGTH];
+	in.RewindAttrs();
+	while (status == B_OK && in.GetNextAttrName(name) == B_OK)
+	{
+		attr_info info;
+		if (in.GetAttrInfo(name, &info) != B_OK)
+			continue;
+		
+		if ((size_t)info.size > bufferSize)
+		{
+			char *newBuffer = (char*)realloc(buffer, info.size);
+			if (!newBuffer)
+			{
+				status = B_NO_MEMORY;
+				break;
+			}
+			buffer = newBuffer;
+			bufferSize = info.size;
+		}
+		
+		ssize_t size = in.ReadAttr(name, info.type, 0, buffer, info.size);
+		if (size >= 0)
+			out.WriteAttr(name, info.type, 0, buffer, size);
+	}
+	free(buffer);
+	
+	if (status == B_OK)
+		status = out.SetPermissions(statData.st_mode);
+	
+	out.Unset();
+	
+	BEntry entry(tempPath.String());
+	if (status == B_OK)
+		status = entry.Rename(dest, true);
+	
+	if (status != B_OK)
+	{
+		entry.Remove();
+		STRACE(1,("Couldn't copy %s to %s: %s\n", source, dest, strerror(status)));
+	}
+	
+	return status;
+}
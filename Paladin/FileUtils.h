@@ -12,4 +12,8 @@ entry_ref			FindProject(entry_ref folder,const char *name);
 
 void				InitFileTypes(void);
 
+// Copies a file's data, attributes and permissions. The copy is written
+// next to dest and renamed over it, so dest is never left half-written.
+status_t			CopyFile(const char *source, const char *dest);
+
 #endif
@@ -0,0 +1,157 @@
+#include "FolderScanner.h"
+
+#include <Directory.h>
+#include <Path.h>
+#include <dirent.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "DebugTools.h"
+#include "FileFactory.h"
+#include "Globals.h"
+
+// Enough to keep the disk busy. More threads than this only contend for it.
+#define MAX_SCAN_THREADS 8
+
+
+static bool
+is_skipped_folder(const char *name)
+{
+	return strcmp(name, "CVS") == 0 || strcmp(name, ".svn") == 0
+		|| strcmp(name, ".git") == 0 || strcmp(name, ".hg") == 0;
+}
+
+
+FolderScanner::FolderScanner(void)
+	:	fBusyThreads(0)
+{
+	pthread_mutex_init(&fLock, NULL);
+	pthread_cond_init(&fWorkAvailable, NULL);
+}
+
+
+FolderScanner::~FolderScanner(void)
+{
+	pthread_cond_destroy(&fWorkAvailable);
+	pthread_mutex_destroy(&fLock);
+}
+
+
+status_t
+FolderScanner::Scan(const entry_ref &folder, BStringList &files)
+{
+	files.MakeEmpty();
+	
+	BPath path(&folder);
+	if (path.InitCheck() != B_OK)
+		return path.InitCheck();
+	
+	if (is_skipped_folder(path.Leaf()))
+		return B_OK;
+	
+	fFiles.MakeEmpty();
+	fPendingFolders.MakeEmpty();
+	fPendingFolders.Add(path.Path());
+	fBusyThreads = 0;
+	
+	int32 threadCount = MIN(MAX(gCPUCount, 1), MAX_SCAN_THREADS);
+	thread_id threads[MAX_SCAN_THREADS];
+	int32 started = 0;
+	for (int32 i = 0; i < threadCount; i++)
+	{
+		threads[started] = spawn_thread(ScanThread, "folder scanner",
+										B_NORMAL_PRIORITY, this);
+		if (threads[started] >= 0 && resume_thread(threads[started]) == B_OK)
+			started++;
+	}
+	
+	// Do the work here if no threads could be started
+	if (started == 0)
+		ScanThread(this);
+	
+	for (int32 i = 0; i < started; i++)
+	{
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+	
+	fFiles.Sort();
+	files.Swap(fFiles);
+	
+	STRACE(1,("Scanned %s: %ld files to add\n", path.Path(),
+			(long)files.CountStrings()));
+	return B_OK;
+}
+
+
+int32
+FolderScanner::ScanThread(void *data)
+{
+	FolderScanner *scanner = (FolderScanner*)data;
+	
+	pthread_mutex_lock(&scanner->fLock);
+	while (true)
+	{
+		// The scan is done once nothing is left to read and no thread is
+		// still reading something which could turn up more folders
+		while (scanner->fPendingFolders.IsEmpty() && scanner->fBusyThreads > 0)
+			pthread_cond_wait(&scanner->fWorkAvailable, &scanner->fLock);
+		
+		if (scanner->fPendingFolders.IsEmpty())
+			break;
+		
+		int32 last = scanner->fPendingFolders.CountStrings() - 1;
+		BString path(scanner->fPendingFolders.StringAt(last));
+		scanner->fPendingFolders.Remove(last);
+		scanner->fBusyThreads++;
+		pthread_mutex_unlock(&scanner->fLock);
+		
+		BStringList folders, files;
+		scanner->ScanFolder(path, folders, files);
+		
+		pthread_mutex_lock(&scanner->fLock);
+		scanner->fBusyThreads--;
+		scanner->fPendingFolders.Add(folders);
+		scanner->fFiles.Add(files);
+		pthread_cond_broadcast(&scanner->fWorkAvailable);
+	}
+	pthread_mutex_unlock(&scanner->fLock);
+	
+	return 0;
+}
+
+
+void
+FolderScanner::ScanFolder(const BString &path, BStringList &folders,
+						BStringList &files)
+{
+	BDirectory directory(path.String());
+	if (directory.InitCheck() != B_OK)
+		return;
+	
+	// Reading dirents directly saves making a BEntry for everything in the
+	// folder just to find out whether it is a folder itself
+	char buffer[sizeof(dirent) + B_FILE_NAME_LENGTH];
+	dirent *entry = (dirent*)buffer;
+	while (directory.GetNextDirents(entry, sizeof(buffer), 1) == 1)
+	{
+		if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0)
+			continue;
+		
+		BString entryPath(path);
+		entryPath << "/" << entry->d_name;
+		
+		// Not traversed, so links to folders can't send the scan in circles
+		struct stat statData;
+		if (directory.GetStatFor(entry->d_name, &statData) != B_OK)
+			continue;
+		
+		if (S_ISDIR(statData.st_mode))
+		{
+			if (!is_skipped_folder(entry->d_name))
+				folders.Add(entryPath);
+		}
+		else if (gFileFactory.IsBuildFile(entryPath.String()))
+			files.Add(entryPath);
+	}
+}
@@ -0,0 +1,34 @@
+#ifndef FOLDERSCANNER_H
+#define FOLDERSCANNER_H
+
+#include <Entry.h>
+#include <String.h>
+#include <StringList.h>
+#include <pthread.h>
+
+// Finds the files under a folder which a build would do something with, as
+// decided by the file factory's source types. Subfolders are read by several
+// threads at once. Source control folders are skipped.
+class FolderScanner
+{
+public:
+							FolderScanner(void);
+							~FolderScanner(void);
+	
+			// Blocks until the whole tree has been read. The paths found are
+			// put in files, sorted.
+			status_t		Scan(const entry_ref &folder, BStringList &files);
+	
+private:
+	static	int32			ScanThread(void *data);
+			void			ScanFolder(const BString &path, BStringList &folders,
+										BStringList &files);
+	
+			pthread_mutex_t	fLock;
+			pthread_cond_t	fWorkAvailable;
+			BStringList		fPendingFolders;
+			BStringList		fFiles;
+			int32			fBusyThreads;
+};
+
+#endif
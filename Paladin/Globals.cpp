@@ -9,12 +9,15 @@
 #include <Path.h>
 #include <Roster.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "BeIDEProject.h"
 #include "DebugTools.h"
 #include "DPath.h"
 #include "FileFactory.h"
+#include "FileHash.h"
 #include "Globals.h"
+#include "JobPool.h"
 #include "Project.h"
 #include "Settings.h"
 #include "SourceTypeLib.h"
@@ -36,6 +39,8 @@ bool gBuildMode = false;
 bool gMakeMode = false;
 bool gDontManageHeaders = true;
 bool gSingleThreadedBuild = false;
+bool gKeepGoing = false;
+bool gBackgroundBuild = false;
 bool gShowFolderOnOpen = false;
 bool gAutoSyncModules = true;
 bool gUseCCache = false;
@@ -54,13 +59,92 @@ CodeLib gCodeLib;
 scm_t gDefaultSCM = SCM_HG;
 bool gUsePipeHack = false;
 
-uint8 gCPUCount = 1;
+int32 gCPUCount = 1;
+int32 gBuildJobs = 0;
+int32 gBuildMemory = 0;
+JobPool gJobPool;
+static int32 sCPUQuota = 0;
+static off_t sMemoryLimit = 0;
 
 StatCache gStatCache;
+HashCache gHashCache;
 bool gUseStatCache = true;
 platform_t gPlatform = PLATFORM_R5;
 
 
+// Container runtimes limit a container's processor time with a cgroup quota
+// instead of hiding processors from it, so without this a build inside one
+// starts a job for every processor of the host. Returns 0 if there is no
+// quota.
+static int32
+read_cpu_quota(void)
+{
+	long long quota = -1;
+	long long period = 0;
+	
+	FILE *file = fopen("/sys/fs/cgroup/cpu.max", "r");
+	if (file)
+	{
+		// "<quota> <period>", or "max <period>" when unlimited
+		char value[32];
+		if (fscanf(file, "%31s %lld", value, &period) == 2
+			&& strcmp(value, "max") != 0)
+			quota = atoll(value);
+		fclose(file);
+	}
+	else
+	{
+		file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_quota_us", "r");
+		if (file)
+		{
+			if (fscanf(file, "%lld", &quota) != 1)
+				quota = -1;
+			fclose(file);
+		}
+		
+		file = fopen("/sys/fs/cgroup/cpu/cpu.cfs_period_us", "r");
+		if (file)
+		{
+			if (fscanf(file, "%lld", &period) != 1)
+				period = 0;
+			fclose(file);
+		}
+	}
+	
+	if (quota <= 0 || period <= 0)
+		return 0;
+	
+	// Round up so that 1.5 processors still get two jobs
+	return (int32)MAX((quota + period - 1) / period, 1);
+}
+
+
+// Like the CPU quota, a container's memory is limited by its cgroup and not
+// by what the system has. Returns 0 if there is no limit.
+static off_t
+read_memory_limit(void)
+{
+	long long limit = 0;
+	
+	FILE *file = fopen("/sys/fs/cgroup/memory.max", "r");
+	if (!file)
+		file = fopen("/sys/fs/cgroup/memory/memory.limit_in_bytes", "r");
+	if (file)
+	{
+		// "max" when unlimited
+		if (fscanf(file, "%lld", &limit) != 1)
+			limit = 0;
+		fclose(file);
+	}
+	
+	// Version 1 reports no limit as a huge number rather than "max"
+	if (limit <= 0 || limit >= (1LL << 60))
+		return 0;
+	
+	return (off_t)limit;
+}
+
+
 void
 InitGlobals(void)
 {
@@ -74,8 +158,14 @@ InitGlobals(void)
 	
 	gSettings.Load(settingsPath.GetFullPath());
 	
+	DPath hashCachePath(B_USER_SETTINGS_DIRECTORY);
+	hashCachePath << "Paladin_hashcache";
+	gHashCache.Load(hashCachePath.GetFullPath());
+	
 	gDontManageHeaders = gSettings.GetBool("dontmanageheaders",true);
 	gSingleThreadedBuild = gSettings.GetBool("singlethreaded",false);
+	gKeepGoing = gSettings.GetBool("keepgoing",false);
+	gBackgroundBuild = gSettings.GetBool("backgroundbuild",false);
 	gShowFolderOnOpen = gSettings.GetBool("showfolderonopen",false);
 	gAutoSyncModules = gSettings.GetBool("autosyncmodules",true);
 	gUseCCache = gSettings.GetBool("ccache",false);
@@ -86,6 +176,16 @@ InitGlobals(void)
 	system_info sysinfo;
 	get_system_info(&sysinfo);
 	gCPUCount = sysinfo.cpu_count;
+	sCPUQuota = read_cpu_quota();
+	gBuildJobs = gSettings.GetInt32("buildjobs", 0);
+	gJobPool.SetSlots(BuildJobCount());
+	
+	off_t physicalMemory = (off_t)sysinfo.max_pages * B_PAGE_SIZE;
+	sMemoryLimit = read_memory_limit();
+	if (sMemoryLimit == 0 || sMemoryLimit > physicalMemory)
+		sMemoryLimit = physicalMemory;
+	gBuildMemory = gSettings.GetInt32("buildmemory", 0);
+	gJobPool.SetMemoryBudget(BuildMemoryBudget());
 	
 	gPlatform = DetectPlatform();
 	
@@ -645,6 +745,120 @@ IsBeIDEProject(const entry_ref &ref)
 }
 
 
+static void
+find_beide_projects(const char *path, BStringList &projects)
+{
+	BEntry entry(path, true);
+	entry_ref ref;
+	if (entry.GetRef(&ref) != B_OK)
+		return;
+	
+	if (!entry.IsDirectory())
+	{
+		if (IsBeIDEProject(ref))
+			projects.Add(DPath(ref).GetFullPath());
+		return;
+	}
+	
+	BDirectory dir(&ref);
+	while (dir.GetNextEntry(&entry) == B_OK)
+	{
+		// Skip hidden folders, which covers source control data
+		char name[B_FILE_NAME_LENGTH];
+		if (entry.GetName(name) != B_OK || name[0] == '.')
+			continue;
+		
+		BPath childPath;
+		if (entry.GetPath(&childPath) == B_OK)
+			find_beide_projects(childPath.Path(), projects);
+	}
+}
+
+
+struct beide_batch_data
+{
+	BStringList		projects;
+	vector<BString>	outpaths;
+	vector<status_t>	results;
+	int32			next;
+};
+
+
+static int32
+beide_batch_thread(void *data)
+{
+	beide_batch_data *batch = (beide_batch_data*)data;
+	
+	int32 index;
+	while ((index = atomic_add(&batch->next, 1)) < batch->projects.CountStrings())
+	{
+		batch->results[index] = BeIDE2Paladin(batch->projects.StringAt(index).String(),
+											batch->outpaths[index]);
+	}
+	return 0;
+}
+
+
+void
+BeIDE2PaladinBatch(const BStringList &paths, BStringList &outpaths,
+					BStringList &failed)
+{
+	beide_batch_data data;
+	data.next = 0;
+	
+	// Projects which were converted before are left alone, just like when
+	// one is opened
+	BStringList found;
+	for (int32 i = 0; i < paths.CountStrings(); i++)
+		find_beide_projects(paths.StringAt(i).String(), found);
+	
+	for (int32 i = 0; i < found.CountStrings(); i++)
+	{
+		DPath beidePath(found.StringAt(i).String());
+		BString palPath = beidePath.GetFolder();
+		palPath << "/" << beidePath.GetBaseName() << ".pld";
+		if (!BEntry(palPath.String()).Exists())
+			data.projects.Add(found.StringAt(i));
+	}
+	
+	int32 count = data.projects.CountStrings();
+	if (count == 0)
+		return;
+	
+	data.outpaths.resize(count);
+	data.results.resize(count, B_ERROR);
+	
+	// Each project is read and written on its own, so as many can be
+	// converted at once as there are processors
+	int32 threadCount = MIN((int32)gCPUCount, count);
+	vector<thread_id> threads;
+	for (int32 i = 0; i < threadCount; i++)
+	{
+		thread_id thread = spawn_thread(beide_batch_thread, "beide converter",
+										B_NORMAL_PRIORITY, &data);
+		if (thread >= 0 && resume_thread(thread) == B_OK)
+			threads.push_back(thread);
+	}
+	
+	if (threads.empty())
+		beide_batch_thread(&data);
+	
+	for (uint32 i = 0; i < threads.size(); i++)
+	{
+		status_t result;
+		wait_for_thread(threads[i], &result);
+	}
+	
+	for (int32 i = 0; i < count; i++)
+	{
+		if (data.results[i] == B_OK)
+			outpaths.Add(data.outpaths[i]);
+		else
+			failed.Add(data.projects.StringAt(i));
+	}
+}
+
+
 int32
 ShowAlert(const char *message, const char *button1, const char *button2,
 			const char *button3, alert_type type)
@@ -760,3 +974,44 @@ GetPartnerRef(entry_ref ref)
 	
 	return entry_ref();
 }
+
+
+int32
+DefaultJobCount(void)
+{
+	int32 count = MAX(gCPUCount, 1);
+	if (sCPUQuota > 0 && sCPUQuota < count)
+		count = sCPUQuota;
+	return count;
+}
+
+
+int32
+BuildJobCount(void)
+{
+	if (gSingleThreadedBuild)
+		return 1;
+	
+	if (gBuildJobs > 0)
+		return gBuildJobs;
+	
+	return DefaultJobCount();
+}
+
+
+off_t
+DefaultMemoryBudget(void)
+{
+	// Leave a quarter for the system and everything else that is running
+	return sMemoryLimit / 4 * 3;
+}
+
+
+off_t
+BuildMemoryBudget(void)
+{
+	if (gBuildMemory > 0)
+		return (off_t)gBuildMemory * 1048576;
+	
+	return DefaultMemoryBudget();
+}
@@ -5,6 +5,7 @@
 #include <Entry.h>
 #include <FindDirectory.h>
 #include <Message.h>
+#include <StringList.h>
 #include <View.h>
 
 #include "CodeLib.h"
@@ -12,6 +13,8 @@
 #include "Project.h"
 
 class DPath;
+class HashCache;
+class JobPool;
 class StatCache;
 
 // Define this to enable the code library
@@ -33,12 +36,30 @@ status_t	RunPipedCommand(const char *command, BString &out,
 							bool redirectStdErr);
 status_t	BeIDE2Paladin(const char *path, BString &outpath);
 bool		IsBeIDEProject(const entry_ref &ref);
+
+// Converts BeIDE projects several at a time. Folders in paths are searched
+// for projects, and ones which already have a Paladin project beside them
+// are skipped. The new Paladin projects are put in outpaths and the BeIDE
+// projects which couldn't be read in failed.
+void		BeIDE2PaladinBatch(const BStringList &paths, BStringList &outpaths,
+								BStringList &failed);
 int32		ShowAlert(const char *message, const char *button1 = NULL,
 						const char *button2 = NULL, const char *button3 = NULL,
 						alert_type type = B_INFO_ALERT);
 DPath		GetSystemPath(directory_which which);
 entry_ref	GetPartnerRef(entry_ref ref);
 
+// How many build jobs to run at once: one when building single threaded,
+// gBuildJobs when it is set and DefaultJobCount() otherwise
+int32		BuildJobCount(void);
+// The processor count, or less when a CPU quota is in effect
+int32		DefaultJobCount(void);
+// How much memory the build jobs running at once may be expected to use:
+// gBuildMemory megabytes when it is set and DefaultMemoryBudget() otherwise
+off_t		BuildMemoryBudget(void);
+// Three quarters of the memory, or of the cgroup's memory limit if lower
+off_t		DefaultMemoryBudget(void);
+
 extern Project *gCurrentProject;
 extern LockableList<Project> *gProjectList;
 extern CodeLib gCodeLib;
@@ -54,6 +75,8 @@ extern bool	gBuildMode;
 extern bool	gMakeMode;
 extern bool gDontManageHeaders;
 extern bool gSingleThreadedBuild;
+extern bool gKeepGoing;
+extern bool gBackgroundBuild;
 extern bool gShowFolderOnOpen;
 extern bool gShowTooltips;
 extern bool gAutoSyncModules;
@@ -67,9 +90,13 @@ extern bool gSvnAvailable;
 extern bool gLuaAvailable;
 extern BString gDefaultEmail;
 
-extern uint8 gCPUCount;
+extern int32 gCPUCount;
+extern int32 gBuildJobs;
+extern int32 gBuildMemory;
+extern JobPool gJobPool;
 
 extern StatCache gStatCache;
+extern HashCache gHashCache;
 extern bool	gUseStatCache;
 
 extern platform_t gPlatform;
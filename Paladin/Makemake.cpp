@@ -1,161 +1,606 @@
 #include "Makemake.h"
 
+#include <Entry.h>
 #include <File.h>
+#include <FindDirectory.h>
+#include <Path.h>
 #include <String.h>
+#include <StringList.h>
+#include <set>
+#include <string.h>
+#include <vector>
 
+#include "Globals.h"
 #include "Project.h"
-#include "Makefile.h"
 #include "SourceFile.h"
 
-static BString _SerializeBool(bool val)
+using std::set;
+using std::vector;
+
+/*
+	Both generators work from the same plan of the build. Every source file
+	gets a step of its own which says what it is built from and into, so the
+	makefile has a rule for each object and make -j can run all of them at
+	once. Objects go in a tree under OBJECT_FOLDER which mirrors the sources,
+	so files with the same name in different folders don't collide. The
+	flags are the same ones Paladin builds the project with.
+*/
+
+#define OBJECT_FOLDER "objects"
+
+struct build_step
+{
+	SourceFileType	type;
+	bool			isC;
+
+	// Paths are relative to the project folder when the file is inside it.
+	// The generated and output files are relative to the objects folder.
+	BString			source;
+	BString			generated;
+	BString			output;
+	BStringList		headers;
+};
+
+struct build_plan
 {
-	return val ? "TRUE" : "FALSE";
+	BString				target;
+	int32				targetType;
+	BString				compileFlags;
+	BString				includes;
+	BString				linkFlags;
+	BString				libs;
+
+	vector<build_step>	steps;
+	BStringList			linkFiles;
+	BStringList			resources;
+	set<BString>		headers;
+	set<BString>		folders;
+};
+
+
+static BString
+relative_path(const BString &projectFolder, const char *path)
+{
+	BString out(path);
+	if (out.FindFirst(projectFolder) == 0 && out[projectFolder.Length()] == '/')
+		out.Remove(0, projectFolder.Length() + 1);
+	return out;
 }
-//static BString _SerializeStringList(BStringList val)
-//{
-//	return val.Join(" \\\n\t");
-//}
 
-status_t
-MakeMake(Project *proj, DPath outfile)
+
+static BString
+build_path(const BString &source, const char *extension)
 {
-	if (!proj || outfile.IsEmpty())
-		return B_ERROR;
-		
-	BString mkfile(template_makefile);
-
-	mkfile.ReplaceFirst("$@NAME@$", proj->GetTargetName());
-	
-	BString typeString;
-	switch (proj->TargetType())
-	{
-	case TARGET_SHARED_LIB:
-		typeString = "SHARED";
-	break;
-	case TARGET_STATIC_LIB:
-		typeString = "STATIC";
-	break;
-	case TARGET_DRIVER:
-		typeString = "DRIVER";
-	break;
-	default:
-		typeString = "APP";
-	break;
-	}
-	mkfile.ReplaceFirst("$@TYPE@$", typeString);
-	
-	BString projfolder = proj->GetPath().GetFolder();
-	projfolder << "/";
-	
-	BString srcsString;
-	int32 i,j;
-	for (i = 0; i < proj->CountGroups(); i++)
+	// Files outside of the project keep their whole path under the objects
+	// folder
+	BString out(source);
+	if (out[0] == '/')
+		out.Prepend("_root");
+
+	int32 dot = out.FindLast(".");
+	if (dot > out.FindLast("/"))
+		out.Truncate(dot);
+	out << extension;
+	return out;
+}
+
+
+static void
+add_folder(build_plan &plan, const BString &output)
+{
+	int32 slash = output.FindLast("/");
+	while (slash > 0)
 	{
-		SourceGroup *group = proj->GroupAt(i);
-		for (j = 0; j < group->filelist.CountItems(); j++)
+		BString folder;
+		output.CopyInto(folder, 0, slash);
+		if (!plan.folders.insert(folder).second)
+			break;
+
+		slash = folder.FindLast("/");
+	}
+}
+
+
+static BString
+make_escape(const BString &path)
+{
+	BString out(path);
+	out.ReplaceAll("$", "$$");
+	out.CharacterEscape(" #", '\\');
+	return out;
+}
+
+
+static BString
+ninja_escape(const BString &path)
+{
+	BString out(path);
+	out.ReplaceAll("$", "$$");
+	out.ReplaceAll(" ", "$ ");
+	out.ReplaceAll(":", "$:");
+	return out;
+}
+
+
+static BString
+shell_quote(const BString &path)
+{
+	BString out(path);
+	out.ReplaceAll("'", "'\\''");
+	out.Prepend("'");
+	out << "'";
+	return out;
+}
+
+
+static void
+make_plan(Project *proj, build_plan &plan)
+{
+	BString projectFolder = proj->GetPath().GetFolder();
+
+	plan.target = relative_path(projectFolder, proj->GetTargetName());
+	plan.targetType = proj->TargetType();
+
+	// The same options Project::GetCompileOptions() uses
+	if (proj->Debug())
+		plan.compileFlags << "-g -O0 ";
+	else
+	{
+		plan.compileFlags << "-O" << (int)proj->OpLevel() << " ";
+		if (proj->OpForSize())
+			plan.compileFlags << "-Os ";
+	}
+
+	if (proj->Profiling())
+		plan.compileFlags << "-p ";
+
+	if (gPlatform == PLATFORM_ZETA)
+		plan.compileFlags << "-D_ZETA_TS_FIND_DIR_ ";
+
+	plan.compileFlags << "-Wall -Wno-multichar -Wno-unknown-pragmas";
+
+	if (strlen(proj->ExtraCompilerOptions()) > 0)
+		plan.compileFlags << " " << proj->ExtraCompilerOptions();
+
+	plan.includes << "-I.";
+	for (int32 i = 0; i < proj->CountLocalIncludes(); i++)
+	{
+		BString path = proj->LocalIncludeAt(i).Relative();
+		if (path.CountChars() > 0 && path != ".")
+			plan.includes << " -I" << shell_quote(path);
+	}
+
+	for (int32 i = 0; i < proj->CountSystemIncludes(); i++)
+	{
+		BString path = proj->SystemIncludeAt(i);
+		if (path.FindFirst("./") == 0)
+			path.Remove(0, 2);
+		if (path.CountChars() > 0 && path != ".")
+			plan.includes << " -I" << shell_quote(path);
+	}
+
+	// The same options Project::Link() uses
+	plan.linkFlags << "-L/boot/home/config/lib";
+	switch (plan.targetType)
+	{
+		case TARGET_DRIVER:
 		{
-			SourceFile *file = group->filelist.ItemAt(j);
-			BString ext = file->GetPath().GetExtension();
-			if (ext.ICompare("c") == 0 || ext.ICompare("cpp") == 0 ||
-				ext.ICompare("cc") == 0 || ext.ICompare("cxx") == 0)
-			{
-				BString path = file->GetPath().GetFullPath();
-				path.RemoveFirst(projfolder);
-				path.CharacterEscape("' ",'\\');
-				srcsString << " " << path;
-			}
+			plan.linkFlags << " -nostdlib";
+			break;
+		}
+		case TARGET_SHARED_LIB:
+		{
+			plan.linkFlags << " -shared -Xlinker -soname=" << proj->GetTargetName();
+			break;
+		}
+		default:
+		{
+			plan.linkFlags << " -Xlinker -soname=_APP_";
+			break;
 		}
 	}
-	mkfile.ReplaceFirst("$@SRCS@$", srcsString);
-	
-	BString rsrcsString;
-	for (i = 0; i < proj->CountGroups(); i++)
+
+	if (strlen(proj->ExtraLinkerOptions()) > 0)
+		plan.linkFlags << " " << proj->ExtraLinkerOptions();
+
+	for (int32 i = 0; i < proj->CountLibraries(); i++)
+	{
+		SourceFile *file = proj->LibraryAt(i);
+		if (!file)
+			continue;
+
+		// Libraries kept with the project are linked by path so that the
+		// target is relinked when they change
+		BString path = relative_path(projectFolder, file->GetPath().GetFullPath());
+		if (path[0] != '/')
+		{
+			plan.linkFiles.Add(path);
+			continue;
+		}
+
+		BString name = file->GetPath().GetBaseName();
+		if (name.FindFirst("lib") == 0)
+			name.RemoveFirst("lib");
+
+		if (plan.libs.CountChars() > 0)
+			plan.libs << " ";
+		plan.libs << "-l" << name;
+	}
+
+	if (plan.targetType == TARGET_DRIVER)
+	{
+		BPath path;
+		if (gPlatform == PLATFORM_HAIKU || gPlatform == PLATFORM_HAIKU_GCC4)
+		{
+			find_directory(B_SYSTEM_DEVELOP_DIRECTORY, &path, false);
+			path.Append("lib/_KERNEL_");
+		}
+		else
+			path.SetTo("/boot/develop/lib/x86/_KERNEL_");
+
+		if (plan.libs.CountChars() > 0)
+			plan.libs << " ";
+		plan.libs << shell_quote(path.Path());
+	}
+
+	set<BString> missingHeaders;
+	for (int32 i = 0; i < proj->CountGroups(); i++)
 	{
 		SourceGroup *group = proj->GroupAt(i);
-		for (j = 0; j < group->filelist.CountItems(); j++)
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
 		{
 			SourceFile *file = group->filelist.ItemAt(j);
-			BString ext = file->GetPath().GetExtension();
-			if (ext.ICompare("rsrc") == 0)
+			BString source = relative_path(projectFolder, file->GetPath().GetFullPath());
+			const char *extension = file->GetPath().GetExtension();
+
+			build_step step;
+			step.type = file->GetType();
+			step.isC = extension && strcasecmp(extension, "c") == 0;
+			step.source = source;
+
+			switch (step.type)
 			{
-				BString path = file->GetPath().GetFullPath();
-				path.RemoveFirst(projfolder);
-				rsrcsString << " " << path;
+				case TYPE_C:
+				{
+					step.output = build_path(source, ".o");
+					break;
+				}
+				case TYPE_LEX:
+				case TYPE_YACC:
+				{
+					step.generated = build_path(source, ".cpp");
+					step.output = build_path(source, ".o");
+					break;
+				}
+				case TYPE_RESOURCE:
+				{
+					if (extension && strcasecmp(extension, "rsrc") == 0)
+					{
+						plan.resources.Add(source);
+						continue;
+					}
+
+					step.output = build_path(source, ".rsrc");
+					plan.resources.Add(BString(OBJECT_FOLDER "/") << step.output);
+					break;
+				}
+				case TYPE_LIB:
+				{
+					plan.linkFiles.Add(source);
+					continue;
+				}
+				default:
+					continue;
 			}
+
+			// Headers found by Paladin's own builds. The compiler writes its
+			// own lists as the makefile is used, but with these the rules are
+			// complete without them, like when objects come from a cache.
+			BStringList headers;
+			BString(file->GetDependencies()).Split("|", true, headers);
+			for (int32 k = 0; k < headers.CountStrings(); k++)
+			{
+				// Saved projects keep these relative to the project folder
+				BString path = headers.StringAt(k);
+				if (path[0] != '/')
+					path.Prepend("/").Prepend(projectFolder);
+
+				if (missingHeaders.find(path) != missingHeaders.end())
+					continue;
+
+				BString header = relative_path(projectFolder, path.String());
+				if (plan.headers.find(header) == plan.headers.end())
+				{
+					if (!BEntry(path.String()).Exists())
+					{
+						missingHeaders.insert(path);
+						continue;
+					}
+					plan.headers.insert(header);
+				}
+				step.headers.Add(header);
+			}
+
+			add_folder(plan, step.output);
+			plan.steps.push_back(step);
 		}
 	}
-	mkfile.ReplaceFirst("$@RSRCS@$", rsrcsString);
-	
-	BString libsString;
-	for (i = 0; i < proj->CountLibraries(); i++)
+}
+
+
+static status_t
+write_file(const DPath &outfile, const BString &data)
+{
+	BFile file(outfile.GetFullPath(), B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+
+	if (file.Write(data.String(), data.Length()) != data.Length())
+		return B_ERROR;
+
+	return B_OK;
+}
+
+
+status_t
+MakeMake(Project *proj, DPath outfile)
+{
+	if (!proj || outfile.IsEmpty())
+		return B_ERROR;
+
+	build_plan plan;
+	make_plan(proj, plan);
+
+	BString mkfile;
+	mkfile << "## Makefile for " << proj->GetName() << ", generated by Paladin ##\n"
+		"\n"
+		"## Every object has a rule of its own and lists the headers it uses, so\n"
+		"## this can be built with as many jobs as you like.\n"
+		"\n"
+		"TARGET := " << make_escape(plan.target) << "\n"
+		"OBJDIR := " OBJECT_FOLDER "\n"
+		"\n"
+		"# C files are compiled as C++, just as Paladin builds them\n"
+		"CXX := g++\n"
+		"CFLAGS := " << plan.compileFlags << "\n"
+		"CXXFLAGS := $(CFLAGS) -Wno-ctor-dtor-privacy\n"
+		"INCLUDES := " << plan.includes << "\n"
+		"LDFLAGS := " << plan.linkFlags << "\n"
+		"LIBS := " << plan.libs << "\n"
+		"\n";
+
+	mkfile << "OBJS :=";
+	for (uint32 i = 0; i < plan.steps.size(); i++)
 	{
-		SourceFile *file = proj->LibraryAt(i);
-		BString ext = file->GetPath().GetExtension();
-		if (ext.ICompare("so") == 0 || ext.ICompare("a") == 0)
+		if (plan.steps[i].type != TYPE_RESOURCE)
+			mkfile << " \\\n\t$(OBJDIR)/" << make_escape(plan.steps[i].output);
+	}
+	mkfile << "\n\nLINKFILES :=";
+	for (int32 i = 0; i < plan.linkFiles.CountStrings(); i++)
+		mkfile << " \\\n\t" << make_escape(plan.linkFiles.StringAt(i));
+	mkfile << "\n\nRSRCS :=";
+	for (int32 i = 0; i < plan.resources.CountStrings(); i++)
+	{
+		// Compiled resources are listed with the folder already in them
+		BString resource = plan.resources.StringAt(i);
+		if (resource.FindFirst(OBJECT_FOLDER "/") == 0)
+			mkfile << " \\\n\t$(OBJDIR)/"
+				<< make_escape(resource.String() + strlen(OBJECT_FOLDER "/"));
+		else
+			mkfile << " \\\n\t" << make_escape(resource);
+	}
+	mkfile << "\n\n"
+		".DELETE_ON_ERROR:\n"
+		".PHONY: all clean\n"
+		"\n"
+		"all: $(TARGET)\n"
+		"\n"
+		"$(TARGET): $(OBJS) $(LINKFILES) $(RSRCS)\n";
+
+	if (plan.targetType == TARGET_STATIC_LIB)
+		mkfile << "\trm -f \"$@\"\n\tar rcs \"$@\" $(OBJS)\n";
+	else
+	{
+		mkfile << "\t$(CXX) -o \"$@\" $(OBJS) $(LINKFILES) $(LIBS) $(LDFLAGS)\n";
+		if (plan.resources.CountStrings() > 0)
+			mkfile << "\txres -o \"$@\" $(RSRCS)\n";
+		mkfile << "\tmimeset -f \"$@\"\n";
+	}
+
+	// Folders are order-only prerequisites, so a new file in one doesn't
+	// make everything else in it out of date
+	mkfile << "\n$(OBJDIR)";
+	for (set<BString>::iterator i = plan.folders.begin(); i != plan.folders.end(); i++)
+		mkfile << " $(OBJDIR)/" << make_escape(*i);
+	mkfile << ":\n\tmkdir -p \"$@\"\n";
+
+	for (uint32 i = 0; i < plan.steps.size(); i++)
+	{
+		const build_step &step = plan.steps[i];
+
+		BString folder("$(OBJDIR)");
+		int32 slash = step.output.FindLast("/");
+		if (slash > 0)
+		{
+			BString subfolder;
+			step.output.CopyInto(subfolder, 0, slash);
+			folder << "/" << make_escape(subfolder);
+		}
+
+		BString input = make_escape(step.source);
+		mkfile << "\n";
+
+		if (step.type == TYPE_LEX || step.type == TYPE_YACC)
 		{
-			BString path = file->GetPath().GetFullPath();
-			path.RemoveFirst(projfolder);
-			libsString << " " << path;
+			mkfile << "$(OBJDIR)/" << make_escape(step.generated) << ": " << input
+				<< " | " << folder << "\n";
+			if (step.type == TYPE_LEX)
+				mkfile << "\tflex -o\"$@\" \"$<\"\n";
+			else
+				mkfile << "\tbison -o \"$@\" \"$<\"\n";
+			input = BString("$(OBJDIR)/") << make_escape(step.generated);
+		}
+
+		mkfile << "$(OBJDIR)/" << make_escape(step.output) << ": " << input;
+		for (int32 j = 0; j < step.headers.CountStrings(); j++)
+			mkfile << " " << make_escape(step.headers.StringAt(j));
+		mkfile << " | " << folder << "\n";
+
+		if (step.type == TYPE_RESOURCE)
+			mkfile << "\trc -o \"$@\" \"$<\"\n";
+		else
+		{
+			mkfile << "\t$(CXX) -c " << (step.isC ? "$(CFLAGS)" : "$(CXXFLAGS)")
+				<< " $(INCLUDES) -MMD -MP -o \"$@\" \"$<\"\n";
 		}
 	}
-	mkfile.ReplaceFirst("$@LIBS@$", libsString);
-	
-	BString inclPaths;
-	for (i = 0; i < proj->CountSystemIncludes(); i++)
+
+	// A header which has since been removed shouldn't stop the build
+	if (!plan.headers.empty())
 	{
-		BString path = proj->SystemIncludeAt(i);
-		path.CharacterEscape("' ",'\\');
-		inclPaths << " " << path;
+		mkfile << "\n";
+		for (set<BString>::iterator i = plan.headers.begin(); i != plan.headers.end(); i++)
+			mkfile << make_escape(*i) << ":\n";
 	}
-	mkfile.ReplaceFirst("$@SYSTEM_INCLUDE_PATHS@$", inclPaths);
-	
-	inclPaths = "";
-	for (i = 0; i < proj->CountLocalIncludes(); i++)
+
+	mkfile << "\n"
+		"clean:\n"
+		"\trm -rf \"$(OBJDIR)\" \"$(TARGET)\"\n"
+		"\n"
+		"-include $(OBJS:.o=.d)\n";
+
+	return write_file(outfile, mkfile);
+}
+
+
+status_t
+MakeNinja(Project *proj, DPath outfile)
+{
+	if (!proj || outfile.IsEmpty())
+		return B_ERROR;
+
+	build_plan plan;
+	make_plan(proj, plan);
+
+	BString postLink;
+	if (plan.targetType != TARGET_STATIC_LIB)
 	{
-		BString path = proj->LocalIncludeAt(i).Relative();
-		path.CharacterEscape("' ",'\\');
-		inclPaths << " " << path;
-	}
-	mkfile.ReplaceFirst("$@LOCAL_INCLUDE_PATHS@$", inclPaths);
-	
-	BString optimizeString;
-	switch (proj->OpLevel())
-	{
-	case 0:
-		optimizeString = "NONE";
-	break;
-	case 1:
-	case 2:
-		optimizeString = "SOME";
-	break;
-	case 3:
-		optimizeString = "FULL";
-	break;
-	default:
-	break;
-	}
-	mkfile.ReplaceFirst("$@OPTIMIZE@$", optimizeString);
-		
-	mkfile.ReplaceFirst("$@COMPILER_FLAGS@$", proj->ExtraCompilerOptions());
-	mkfile.ReplaceFirst("$@LINKER_FLAGS@$", proj->ExtraLinkerOptions());
-	
-	// Unused stuff
-	mkfile.ReplaceFirst("$@APP_MIME_SIG@$", "");
-	mkfile.ReplaceFirst("$@RDEFS@$", "");
-	mkfile.ReplaceFirst("$@LIBPATHS@$", "");
-	mkfile.ReplaceFirst("$@LOCALES@$", "");
-	mkfile.ReplaceFirst("$@DEFINES@$", "");
-	mkfile.ReplaceFirst("$@WARNINGS@$", "");
-	mkfile.ReplaceFirst("$@SYMBOLS@$", "");
-	mkfile.ReplaceFirst("$@DEBUGGER@$", "");
-	mkfile.ReplaceFirst("$@DRIVER_PATH@$", "");
-	
-	BFile file(outfile.GetFullPath(),B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
-	if (file.InitCheck() != B_OK)
-		return file.InitCheck();
-	
-	if (file.Write(mkfile.String(), mkfile.Length()) == mkfile.Length())
-		return B_OK;
+		if (plan.resources.CountStrings() > 0)
+		{
+			postLink << " && xres -o $out";
+			for (int32 i = 0; i < plan.resources.CountStrings(); i++)
+				postLink << " " << shell_quote(plan.resources.StringAt(i));
+		}
+		postLink << " && mimeset -f $out";
+		postLink.ReplaceAll("$", "$$");
+		postLink.ReplaceAll("$$out", "$out");
+	}
+
+	BString cflags(plan.compileFlags);
+	cflags.ReplaceAll("$", "$$");
+	BString includes(plan.includes);
+	includes.ReplaceAll("$", "$$");
+	BString linkFlags(plan.linkFlags);
+	linkFlags.ReplaceAll("$", "$$");
+	BString libs(plan.libs);
+	libs.ReplaceAll("$", "$$");
+
+	BString ninja;
+	ninja << "# Ninja build file for " << proj->GetName() << ", generated by Paladin\n"
+		"\n"
+		"ninja_required_version = 1.3\n"
+		"builddir = " OBJECT_FOLDER "\n"
+		"objdir = " OBJECT_FOLDER "\n"
+		"\n"
+		"cflags = " << cflags << "\n"
+		"cxxflags = $cflags -Wno-ctor-dtor-privacy\n"
+		"includes = " << includes << "\n"
+		"ldflags = " << linkFlags << "\n"
+		"libs = " << libs << "\n"
+		"\n"
+		"rule cc\n"
+		"  command = g++ -c $cflags $includes -MMD -MF $out.d -o $out $in\n"
+		"  depfile = $out.d\n"
+		"  deps = gcc\n"
+		"  description = Compiling $in\n"
+		"\n"
+		"rule cxx\n"
+		"  command = g++ -c $cxxflags $includes -MMD -MF $out.d -o $out $in\n"
+		"  depfile = $out.d\n"
+		"  deps = gcc\n"
+		"  description = Compiling $in\n"
+		"\n"
+		"rule flex\n"
+		"  command = flex -o$out $in\n"
+		"  description = Generating $out\n"
+		"\n"
+		"rule bison\n"
+		"  command = bison -o $out $in\n"
+		"  description = Generating $out\n"
+		"\n"
+		"rule rc\n"
+		"  command = rc -o $out $in\n"
+		"  description = Compiling $in\n"
+		"\n"
+		"rule link\n"
+		"  command = g++ -o $out $in $libs $ldflags" << postLink << "\n"
+		"  description = Linking $out\n"
+		"\n"
+		"rule archive\n"
+		"  command = rm -f $out && ar rcs $out $in\n"
+		"  description = Archiving $out\n"
+		"\n";
+
+	BString objects;
+	BString implicit;
+	for (uint32 i = 0; i < plan.steps.size(); i++)
+	{
+		const build_step &step = plan.steps[i];
+		BString input = ninja_escape(step.source);
+
+		if (step.type == TYPE_LEX || step.type == TYPE_YACC)
+		{
+			ninja << "build $objdir/" << ninja_escape(step.generated) << ": "
+				<< (step.type == TYPE_LEX ? "flex " : "bison ") << input << "\n";
+			input = BString("$objdir/") << ninja_escape(step.generated);
+		}
+
+		BString output = BString("$objdir/") << ninja_escape(step.output);
+		if (step.type == TYPE_RESOURCE)
+		{
+			ninja << "build " << output << ": rc " << input << "\n";
+			implicit << " " << output;
+			continue;
+		}
+
+		// Ninja keeps the compiler's header lists itself, and a listed header
+		// which was since removed would be an error, so they aren't given here
+		ninja << "build " << output << ": " << (step.isC ? "cc " : "cxx ") << input
+			<< "\n";
+		objects << " " << output;
+	}
+
+	for (int32 i = 0; i < plan.resources.CountStrings(); i++)
+	{
+		BString resource = plan.resources.StringAt(i);
+		if (resource.FindFirst(OBJECT_FOLDER "/") != 0)
+			implicit << " " << ninja_escape(resource);
+	}
+
+	BString target = ninja_escape(plan.target);
+	if (plan.targetType == TARGET_STATIC_LIB)
+		ninja << "\nbuild " << target << ": archive" << objects << "\n";
 	else
-		return B_ERROR;
+	{
+		ninja << "\nbuild " << target << ": link" << objects;
+		for (int32 i = 0; i < plan.linkFiles.CountStrings(); i++)
+			ninja << " " << ninja_escape(plan.linkFiles.StringAt(i));
+		if (implicit.CountChars() > 0)
+			ninja << " |" << implicit;
+		ninja << "\n";
+	}
+
+	ninja << "\ndefault " << target << "\n";
+
+	return write_file(outfile, ninja);
 }
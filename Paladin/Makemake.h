@@ -5,6 +5,11 @@
 
 class Project;
 
+// Writes a makefile which builds the project the way Paladin does, with a
+// rule for every object so that it works with make -j
 status_t MakeMake(Project *proj, DPath outfile);
 
+// The same for Ninja
+status_t MakeNinja(Project *proj, DPath outfile);
+
 #endif
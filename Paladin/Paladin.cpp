@@ -22,16 +22,22 @@
 #include <Node.h>
 #include <Path.h>
 #include <Roster.h>
+#include <signal.h>
 #include <stdlib.h>
 #include <String.h>
 #include <TranslationUtils.h>
+#include <unistd.h>
 
 #include "AboutWindow.h"
+#include "BuildServer.h"
+#include "CommandRunner.h"
 #include "DebugTools.h"
 #include "DPath.h"
 #include "ErrorParser.h"
+#include "FileHash.h"
 #include "FileUtils.h"
 #include "Globals.h"
+#include "JobPool.h"
 #include "LaunchHelper.h"
 #include "Makemake.h"
 #include "MsgDefs.h"
@@ -43,7 +49,10 @@
 #include "Settings.h"
 #include "SourceFile.h"
 #include "StartWindow.h"
+#include "StatCache.h"
 #include "TemplateWindow.h"
+#include "TextFile.h"
+#include "WorkspaceBuilder.h"
 #include "PaladinFileFilter.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -57,6 +66,14 @@ static BLocker sWindowLocker;
 int32 gQuitOnZeroWindows = 1;
 
 
+static void
+stop_build(int signal)
+{
+	StopAllCommands();
+	_exit(128 + signal);
+}
+
+
 void
 RegisterWindow(void)
 {
@@ -102,19 +119,57 @@ void
 PrintUsage(void)
 {
 	#ifdef USE_TRACE_TOOLS
-	printf(B_TRANSLATE("Usage: Paladin [-b] [-m] [-r] [-s] [-d] [-v] [file1 [file2 ...]]\n"
-			"-b, Build the specified project. Only one file can be specified with this switch.\n"
+	printf(B_TRANSLATE("Usage: Paladin [-b] [-c] [--server] [-m] [-n] [-i] [-r] [-s] [-k] [-j jobs] [--memory=MB] [-d] [-v] [--timings[=file]] [file1 [file2 ...]]\n"
+			"-b, Build the specified projects. Several projects, or a workspace file (.plw)\n"
+			"    listing one project per line, are built at the same time.\n"
+			"-c, Have a running build server build the specified projects. Without one,\n"
+			"    or with options other than -r, this is the same as -b.\n"
+			"--server, Stay running as a build server for -c, keeping projects loaded\n"
+			"    between builds. The build options given here apply to every build.\n"
+			"    PALADIN_BUILD_SERVER sets the socket to use.\n"
 			"-m, Generate a makefile for the specified project.\n"
+			"-n, Generate a Ninja build file for the specified project.\n"
+			"-i, Convert the specified BeIDE projects, or all of those in the specified\n"
+			"    folders, to Paladin projects.\n"
 			"-r, Completely rebuild the project.\n"
 			"-s, Use only one thread for building.\n"
+			"-k, Keep building the other files when one has errors. Nothing is linked\n"
+			"    and all of the errors are printed at the end.\n"
+			"-j, Run this many build jobs at once. The default is one per processor, or\n"
+			"    fewer when the build is limited by a CPU quota. When run by make -j,\n"
+			"    make's jobserver also limits the jobs.\n"
+			"--memory, Hold back build jobs once the memory earlier builds of the files\n"
+			"    took would add up to more than this many megabytes. The default is\n"
+			"    three quarters of the memory.\n"
+			"--timings, Print per-file build times and write a Chrome trace file. The trace\n"
+			"    goes to BuildTimings.json in the objects folder unless a file is given.\n"
 			"-d, Print debugging output.\n"
 			"-v, Make debugging mode verbose.\n"));
 	#else
-	printf(B_TRANSLATE("Usage: Paladin [-b] [-m] [-r] [-s] [file1 [file2 ...]]\n"
-			"-b, Build the specified project. Only one file can be specified with this switch.\n"
+	printf(B_TRANSLATE("Usage: Paladin [-b] [-c] [--server] [-m] [-n] [-i] [-r] [-s] [-k] [-j jobs] [--memory=MB] [--timings[=file]] [file1 [file2 ...]]\n"
+			"-b, Build the specified projects. Several projects, or a workspace file (.plw)\n"
+			"    listing one project per line, are built at the same time.\n"
+			"-c, Have a running build server build the specified projects. Without one,\n"
+			"    or with options other than -r, this is the same as -b.\n"
+			"--server, Stay running as a build server for -c, keeping projects loaded\n"
+			"    between builds. The build options given here apply to every build.\n"
+			"    PALADIN_BUILD_SERVER sets the socket to use.\n"
 			"-m, Generate a makefile for the specified project.\n"
+			"-n, Generate a Ninja build file for the specified project.\n"
+			"-i, Convert the specified BeIDE projects, or all of those in the specified\n"
+			"    folders, to Paladin projects.\n"
 			"-r, Completely rebuild the project.\n"
-			"-s, Use only one thread for building.\n"));
+			"-s, Use only one thread for building.\n"
+			"-k, Keep building the other files when one has errors. Nothing is linked\n"
+			"    and all of the errors are printed at the end.\n"
+			"-j, Run this many build jobs at once. The default is one per processor, or\n"
+			"    fewer when the build is limited by a CPU quota. When run by make -j,\n"
+			"    make's jobserver also limits the jobs.\n"
+			"--memory, Hold back build jobs once the memory earlier builds of the files\n"
+			"    took would add up to more than this many megabytes. The default is\n"
+			"    three quarters of the memory.\n"
+			"--timings, Print per-file build times and write a Chrome trace file. The trace\n"
+			"    goes to BuildTimings.json in the objects folder unless a file is given.\n"));
 	#endif
 }
 
@@ -123,7 +178,11 @@ App::App(void)
 	:
 	BApplication(APP_SIGNATURE),
 	fBuildCleanMode(false),
-	fBuilder(NULL)
+	fMakeNinja(false),
+	fShowTimings(false),
+	fBuilder(NULL),
+	fWorkspace(NULL),
+	fServer(NULL)
 {
 	InitFileTypes();
 	InitGlobals();
@@ -140,8 +199,10 @@ App::~App(void)
 {
 	gSettings.Save();
 	
+	delete fServer;
 	if (NULL != fBuilder)
 		delete fBuilder;
+	delete fWorkspace;
 	if (NULL != fOpenPanel)
 		delete fOpenPanel;
 }
@@ -160,12 +221,63 @@ App::ArgvReceived(int32 argc,char **argv)
 {
 	bool showUsage = false;
 	bool verbose = false;
+	bool importMode = false;
+	bool serverMode = false;
 	int32 i = 1;
+	
+	// A server started through the launcher gets the arguments of a second
+	// one, which it must not act on
+	if (fServer != NULL)
+	{
+		printf(B_TRANSLATE("The build server is running. Use Paladin -c to build "
+			"with it.\n"));
+		return;
+	}
+	
 	for (i = 1; i < argc; i++)
 	{
 		int arglen = strlen(argv[i]);
 		char *arg = argv[i];
 		
+		if (strncmp(arg, "--timings", 9) == 0 && (arg[9] == '\0' || arg[9] == '='))
+		{
+			fShowTimings = true;
+			if (arg[9] == '=')
+				fTimingsPath = arg + 10;
+			continue;
+		}
+		
+		if (strcmp(arg, "--server") == 0)
+		{
+			serverMode = true;
+			continue;
+		}
+		
+		if (strncmp(arg, "--memory=", 9) == 0)
+		{
+			int32 memory = atol(arg + 9);
+			if (memory < 1)
+				showUsage = true;
+			else
+				gBuildMemory = memory;
+			continue;
+		}
+		
+		if (strncmp(arg, "-j", 2) == 0)
+		{
+			// Both "-j 8" and "-j8"
+			const char *value = arg + 2;
+			if (*value == '\0' && i + 1 < argc)
+				value = argv[++i];
+			
+			int32 jobs = atol(value);
+			if (jobs < 1)
+				showUsage = true;
+			else
+				gBuildJobs = jobs;
+			continue;
+		}
+		
 		char opt;
 		if (arglen == 2 && arg[0] == '-')
 			opt = arg[1];
@@ -175,6 +287,7 @@ App::ArgvReceived(int32 argc,char **argv)
 		switch (opt)
 		{
 			case 'b':
+			case 'c':
 			{
 				gBuildMode = true;
 				break;
@@ -184,6 +297,17 @@ App::ArgvReceived(int32 argc,char **argv)
 				gMakeMode = true;
 				break;
 			}
+			case 'n':
+			{
+				gMakeMode = true;
+				fMakeNinja = true;
+				break;
+			}
+			case 'i':
+			{
+				importMode = true;
+				break;
+			}
 			case 'r':
 			{
 				gBuildMode = true;
@@ -195,6 +319,11 @@ App::ArgvReceived(int32 argc,char **argv)
 				gSingleThreadedBuild = true;
 				break;
 			}
+			case 'k':
+			{
+				gKeepGoing = true;
+				break;
+			}
 			
 			#ifdef USE_TRACE_TOOLS
 			case 'v':
@@ -220,6 +349,9 @@ App::ArgvReceived(int32 argc,char **argv)
 	if (gPrintDebugMode > 0 && verbose)
 		gPrintDebugMode = 2;
 	
+	if (serverMode && (i < argc || gMakeMode || importMode))
+		showUsage = true;
+	
 	if (showUsage)
 	{
 		PrintUsage();
@@ -239,6 +371,59 @@ App::ArgvReceived(int32 argc,char **argv)
 	
 	if (gSingleThreadedBuild)
 		STRACE(1,("Disabling multithreaded project building\n"));
+	
+	gJobPool.SetSlots(BuildJobCount());
+	STRACE(1,("Building with %ld jobs\n",BuildJobCount()));
+	gJobPool.SetMemoryBudget(BuildMemoryBudget());
+	
+	// Under make -j, share make's job limit instead of adding to it
+	if (gBuildMode && !serverMode)
+		gJobPool.UseJobServer(getenv("MAKEFLAGS"));
+	
+	if (importMode)
+	{
+		ImportBeIDEProjects(argc - i, argv + i);
+		
+		sWindowCount++;
+		PostMessage(B_QUIT_REQUESTED);
+		return;
+	}
+	
+	if (serverMode)
+	{
+		// Builds are reported to the clients, never in windows
+		gBuildMode = true;
+		
+		BString path = BuildServer::DefaultPath();
+		fServer = new BuildServer();
+		status_t status = fServer->Start(path.String());
+		if (status != B_OK)
+		{
+			printf(B_TRANSLATE("Couldn't start the build server on %s: %s\n"),
+				path.String(), strerror(status));
+			sReturnCode = -1;
+			
+			delete fServer;
+			fServer = NULL;
+			sWindowCount++;
+			PostMessage(B_QUIT_REQUESTED);
+			return;
+		}
+		
+		printf(B_TRANSLATE("Build server listening on %s\n"), path.String());
+		fflush(stdout);
+	}
+	
+	if (gBuildMode)
+	{
+		// Compilers run in process groups of their own, so an interrupt from
+		// the terminal doesn't reach them unless it is passed along
+		signal(SIGINT, stop_build);
+		signal(SIGTERM, stop_build);
+	}
+	
+	if (serverMode)
+		return;
 
 		
 	BMessage refmsg;
@@ -252,7 +437,7 @@ App::ArgvReceived(int32 argc,char **argv)
 	{
 		// See if the project specified lacks an extension and append it
 		BString projPath(argv[i]);
-		if (projPath.FindLast(".pld") != projPath.CountChars() - 4)
+		if (!projPath.EndsWith(".pld") && !projPath.EndsWith(".plw"))
 		{
 			projPath << ".pld";
 			printf(B_TRANSLATE("Attempting to open %s\n"), projPath.String());
@@ -278,7 +463,7 @@ App::ArgvReceived(int32 argc,char **argv)
 		refcount++;
 		optind++;
 		
-		if (refcount == 1 && (gBuildMode || gMakeMode))
+		if (refcount == 1 && gMakeMode)
 			break;
 	}
 	
@@ -292,6 +477,12 @@ App::ArgvReceived(int32 argc,char **argv)
 void
 App::RefsReceived(BMessage *msg)
 {
+	if (gBuildMode)
+	{
+		BuildProjects(msg);
+		return;
+	}
+	
 	entry_ref ref;
 	int32 i = 0;
 	while (msg->FindRef("refs",i,&ref) == B_OK)
@@ -299,9 +490,6 @@ App::RefsReceived(BMessage *msg)
 		bool isPaladin = Project::IsProject(ref);
 		bool isBeIDE = IsBeIDEProject(ref);
 
-		if (gBuildMode && isPaladin)
-			BuildProject(ref);
-		else
 		if (gMakeMode && isPaladin)
 			GenerateMakefile(ref);
 		else
@@ -318,6 +506,7 @@ bool
 App::QuitRequested(void)
 {
 	gSettings.SetString("lastprojectpath",gLastProjectPath.GetFullPath());
+	gHashCache.Save();
 	return true;
 }
 
@@ -481,6 +670,25 @@ App::MessageReceived(BMessage *msg)
 				printf(B_TRANSLATE("Build failure\n%s"), errors.AsString().String());
 			}
 			sReturnCode = -1;
+			
+			Project *proj = NULL;
+			if (fWorkspace && msg->FindPointer("project", (void**)&proj) == B_OK)
+			{
+				if (fShowTimings && fWorkspace->StateOf(proj) == WORKSPACE_BUILDING)
+					ReportBuildTimings(fWorkspace->BuilderFor(proj), proj, NULL);
+				
+				if (!fWorkspace->ProjectFinished(proj, false))
+					break;
+				
+				printf(B_TRANSLATE("%ld of %ld projects failed to build\n"),
+					fWorkspace->CountFailures(), fWorkspace->CountProjects());
+			}
+			else if (fShowTimings)
+			{
+				// A failed build can send more than one failure message
+				ReportBuildTimings(fBuilder, gCurrentProject, fTimingsPath.String());
+				fShowTimings = false;
+			}
 			PostMessage(B_QUIT_REQUESTED);
 			break;
 		}
@@ -495,7 +703,32 @@ App::MessageReceived(BMessage *msg)
 
 		case M_BUILD_SUCCESS:
 		{
-			printf(B_TRANSLATE("Success\n"));
+			Project *proj = NULL;
+			if (fWorkspace && msg->FindPointer("project", (void**)&proj) == B_OK)
+			{
+				if (fWorkspace->StateOf(proj) != WORKSPACE_BUILDING)
+					break;
+				
+				printf(B_TRANSLATE("%s: Success\n"), proj->GetName());
+				if (fShowTimings)
+					ReportBuildTimings(fWorkspace->BuilderFor(proj), proj, NULL);
+				
+				if (!fWorkspace->ProjectFinished(proj, true))
+					break;
+				
+				if (fWorkspace->CountFailures() > 0)
+				{
+					printf(B_TRANSLATE("%ld of %ld projects failed to build\n"),
+						fWorkspace->CountFailures(), fWorkspace->CountProjects());
+					sReturnCode = -1;
+				}
+			}
+			else
+			{
+				printf(B_TRANSLATE("Success\n"));
+				if (fShowTimings)
+					ReportBuildTimings(fBuilder, gCurrentProject, fTimingsPath.String());
+			}
 			PostMessage(B_QUIT_REQUESTED);
 			break;
 		}
@@ -520,6 +753,30 @@ App::CheckCreateOpenPanel()
 	}
 }
 
+void
+App::ReportBuildTimings(ProjectBuilder *builder, Project *proj,
+						const char *tracePath)
+{
+	if (!builder || !proj)
+		return;
+	
+	BuildTimings &timings = builder->GetTimings();
+	printf("%s", timings.Summary().String());
+	
+	BString path(tracePath);
+	if (path.CountChars() < 1)
+	{
+		DPath objectPath(proj->GetObjectPath());
+		objectPath.Append("BuildTimings.json");
+		path = objectPath.GetFullPath();
+	}
+	
+	if (timings.WriteChromeTrace(path.String()) == B_OK)
+		printf(B_TRANSLATE("Build trace written to %s\n"), path.String());
+	else
+		printf(B_TRANSLATE("Couldn't write the build trace to %s\n"), path.String());
+}
+
 void
 App::OpenFile(entry_ref ref, int32 line, int32 column)
 {
@@ -832,8 +1089,8 @@ App::QuickImportProject(DPath folder)
 }
 
 
-void
-App::BuildProject(const entry_ref &ref)
+Project *
+App::LoadProjectForBuild(const entry_ref &ref)
 {
 	BPath path(&ref);
 	Project *proj = new Project;
@@ -844,7 +1101,7 @@ App::BuildProject(const entry_ref &ref)
 		PostMessage(&msg);
 		
 		delete proj;
-		return;
+		return NULL;
 	}
 	
 	if (proj->IsReadOnly())
@@ -858,7 +1115,7 @@ App::BuildProject(const entry_ref &ref)
 		PostMessage(&msg);
 		
 		delete proj;
-		return;
+		return NULL;
 	}
 	
 	gProjectList->Lock();
@@ -866,15 +1123,138 @@ App::BuildProject(const entry_ref &ref)
 	gProjectList->Unlock();
 	
 	gCurrentProject = proj;
-	if (!fBuilder)
-		fBuilder = new ProjectBuilder(BMessenger(this));
 	
 	if (fBuildCleanMode)
 		proj->ForceRebuild();
 	
+	return proj;
+}
+
+
+void
+App::BuildProject(const entry_ref &ref)
+{
+	Project *proj = LoadProjectForBuild(ref);
+	if (!proj)
+		return;
+	
+	if (!fBuilder)
+		fBuilder = new ProjectBuilder(BMessenger(this));
+	
+	gStatCache.MakeEmpty();
 	fBuilder->BuildProject(proj, POSTBUILD_NOTHING);
 }
 
+
+void
+App::BuildProjects(BMessage *refs)
+{
+	// Expand workspace files into the projects they list
+	BMessage projects;
+	entry_ref ref;
+	for (int32 i = 0; refs->FindRef("refs", i, &ref) == B_OK; i++)
+	{
+		BString name(ref.name);
+		if (name.EndsWith(".plw"))
+		{
+			if (ReadWorkspaceFile(ref, projects) != B_OK)
+			{
+				BString err(B_TRANSLATE("Couldn't read the workspace file %name%"));
+				err.ReplaceFirst("%name%", ref.name);
+				BMessage msg(M_BUILD_FAILURE);
+				msg.AddString("errstr", err);
+				PostMessage(&msg);
+				return;
+			}
+		}
+		else if (Project::IsProject(ref))
+			projects.AddRef("refs", &ref);
+		else
+			printf(B_TRANSLATE("%s is not a Paladin project\n"), ref.name);
+	}
+	
+	type_code type;
+	int32 count = 0;
+	projects.GetInfo("refs", &type, &count);
+	
+	if (count == 1 && projects.FindRef("refs", &ref) == B_OK)
+		BuildProject(ref);
+	else if (count > 1)
+		BuildWorkspace(&projects);
+	else
+		Quit();
+}
+
+
+void
+App::BuildWorkspace(BMessage *refs)
+{
+	fWorkspace = new WorkspaceBuilder(BMessenger(this));
+	
+	// Load everything first so that a broken project stops the build before
+	// any of the others have started
+	entry_ref ref;
+	for (int32 i = 0; refs->FindRef("refs", i, &ref) == B_OK; i++)
+	{
+		Project *proj = LoadProjectForBuild(ref);
+		if (!proj)
+			return;
+		
+		fWorkspace->AddProject(proj);
+	}
+	
+	fWorkspace->Build();
+	
+	// Everything may have been skipped, e.g. because of a dependency cycle
+	if (fWorkspace->IsDone())
+	{
+		sReturnCode = -1;
+		PostMessage(B_QUIT_REQUESTED);
+	}
+}
+
+
+status_t
+App::ReadWorkspaceFile(const entry_ref &ref, BMessage &refs)
+{
+	// A workspace file is a plain text file listing one project per line.
+	// Relative paths are relative to the workspace file and lines starting
+	// with a # are comments.
+	TextFile file(ref, B_READ_ONLY);
+	if (file.InitCheck() != B_OK)
+		return file.InitCheck();
+	
+	const char *start;
+	int32 length;
+	
+	DPath folder(ref);
+	while (file.NextLine(start, length))
+	{
+		BString line(start, length);
+		line.Trim();
+		if (line.CountChars() < 1 || line[0] == '#')
+			continue;
+		
+		BString projPath(line);
+		if (projPath[0] != '/')
+			projPath.Prepend("/").Prepend(folder.GetFolder());
+		
+		if (!projPath.EndsWith(".pld"))
+			projPath << ".pld";
+		
+		entry_ref projRef;
+		BEntry entry(projPath.String());
+		if (!entry.Exists() || entry.GetRef(&projRef) != B_OK)
+		{
+			printf(B_TRANSLATE("Can't find file %s\n"), projPath.String());
+			return B_ENTRY_NOT_FOUND;
+		}
+		refs.AddRef("refs", &projRef);
+	}
+	
+	return B_OK;
+}
+
 void
 App::GenerateMakefile(const entry_ref &ref)
 {
@@ -910,8 +1290,19 @@ App::GenerateMakefile(const entry_ref &ref)
 	
 	gCurrentProject = proj;
 	DPath out(proj->GetPath().GetFolder());
-	out.Append("Makefile");
-	if (MakeMake(proj, out) == B_OK); {
+	status_t status;
+	if (fMakeNinja)
+	{
+		out.Append("build.ninja");
+		status = MakeNinja(proj, out);
+	}
+	else
+	{
+		out.Append("Makefile");
+		status = MakeMake(proj, out);
+	}
+	
+	if (status == B_OK) {
 		BEntry entry(out.GetFullPath());
 		entry_ref new_ref;
 		if (entry.InitCheck() == B_OK) {
@@ -923,6 +1314,31 @@ App::GenerateMakefile(const entry_ref &ref)
 	}
 }
 
+
+void
+App::ImportBeIDEProjects(int32 count, char **paths)
+{
+	BStringList list;
+	for (int32 i = 0; i < count; i++)
+		list.Add(paths[i]);
+	
+	if (list.IsEmpty())
+		list.Add(".");
+	
+	BStringList converted, failed;
+	BeIDE2PaladinBatch(list, converted, failed);
+	
+	for (int32 i = 0; i < converted.CountStrings(); i++)
+		printf(B_TRANSLATE("Wrote %s\n"), converted.StringAt(i).String());
+	
+	for (int32 i = 0; i < failed.CountStrings(); i++)
+		printf(B_TRANSLATE("Couldn't convert %s\n"), failed.StringAt(i).String());
+	
+	printf(B_TRANSLATE("Converted %ld projects, %ld failed\n"),
+			converted.CountStrings(), failed.CountStrings());
+}
+
+
 void
 App::LoadProject(const entry_ref &givenRef)
 {
@@ -1106,6 +1522,12 @@ main(int argc, char **argv)
 		PrintUsage();
 		return 0;
 	}
+	else if (argc > 1 && strcmp(argv[1], "-c") == 0
+		&& BuildServer::RunClient(argc - 2, argv + 2, sReturnCode) == B_OK)
+	{
+		// The server did the build. Without one, -c builds here like -b.
+		return sReturnCode;
+	}
 	else
 	{
 		// Initialize localization under Haiku
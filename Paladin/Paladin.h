@@ -4,11 +4,14 @@
 #include <Application.h>
 #include <Entry.h>
 #include <FilePanel.h>
+#include <String.h>
 
 
+class BuildServer;
 class DelayedMessenger;
 class ProjectBuilder;
 class Project;
+class WorkspaceBuilder;
 class DPath;
 
 class App : public BApplication
@@ -28,15 +31,27 @@ public:
 	bool	QuickImportProject(DPath folder);
 
 private:
+	Project *LoadProjectForBuild(const entry_ref &ref);
 	void	BuildProject(const entry_ref &ref);
+	void	BuildProjects(BMessage *refs);
+	void	BuildWorkspace(BMessage *refs);
+	status_t ReadWorkspaceFile(const entry_ref &ref, BMessage &refs);
 	void	GenerateMakefile(const entry_ref &ref);
+	void	ImportBeIDEProjects(int32 count, char **paths);
 	void	LoadProject(const entry_ref &ref);
 	void	UpdateRecentItems(const entry_ref &ref);
 	void	PostToProjectWindow(BMessage *msg, entry_ref *file);
 	void	CheckCreateOpenPanel(void);
+	void	ReportBuildTimings(ProjectBuilder *builder, Project *proj,
+								const char *tracePath);
 	
 	bool			fBuildCleanMode;
+	bool			fMakeNinja;
+	bool			fShowTimings;
+	BString			fTimingsPath;
 	ProjectBuilder	*fBuilder;
+	WorkspaceBuilder	*fWorkspace;
+	BuildServer		*fServer;
 	BFilePanel		*fOpenPanel;
 };
 
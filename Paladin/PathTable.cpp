@@ -0,0 +1,213 @@
+#include "PathTable.h"
+
+#include <Autolock.h>
+#include <Locker.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct path_entry
+{
+	path_entry(const char *string, uint32 hashValue)
+		:	key(string),
+			path(string),
+			hash(hashValue),
+			next(NULL)
+	{
+	}
+
+	BString		key;
+	DPath		path;
+	uint32		hash;
+	path_entry	*next;
+};
+
+
+static path_entry **sBuckets = NULL;
+static uint32 sBucketCount = 0;
+static uint32 sEntryCount = 0;
+
+
+static BLocker &
+table_lock(void)
+{
+	// Made on first use so that paths can be set up by static objects
+	static BLocker sLock("path table");
+	return sLock;
+}
+
+
+static uint32
+hash_path(const char *path)
+{
+	// 32-bit FNV-1a
+	uint32 hash = 2166136261UL;
+	for (const char *c = path; *c; c++)
+	{
+		hash ^= (uint8)*c;
+		hash *= 16777619UL;
+	}
+	return hash;
+}
+
+
+static path_entry *
+find_entry(const char *path, uint32 hash)
+{
+	if (sBucketCount == 0)
+		return NULL;
+
+	path_entry *entry = sBuckets[hash & (sBucketCount - 1)];
+	while (entry)
+	{
+		if (entry->hash == hash && entry->key == path)
+			return entry;
+		entry = entry->next;
+	}
+	return NULL;
+}
+
+
+static void
+grow_table(void)
+{
+	uint32 newCount = (sBucketCount > 0) ? sBucketCount * 2 : 256;
+	path_entry **newBuckets = (path_entry**)calloc(newCount, sizeof(path_entry*));
+	if (!newBuckets)
+		return;
+
+	for (uint32 i = 0; i < sBucketCount; i++)
+	{
+		path_entry *entry = sBuckets[i];
+		while (entry)
+		{
+			path_entry *next = entry->next;
+			uint32 index = entry->hash & (newCount - 1);
+			entry->next = newBuckets[index];
+			newBuckets[index] = entry;
+			entry = next;
+		}
+	}
+
+	free(sBuckets);
+	sBuckets = newBuckets;
+	sBucketCount = newCount;
+}
+
+
+PathHandle::PathHandle(void)
+	:	fEntry(NULL)
+{
+}
+
+
+PathHandle::PathHandle(const char *path)
+	:	fEntry(NULL)
+{
+	SetTo(path);
+}
+
+
+void
+PathHandle::SetTo(const char *path)
+{
+	if (!path || !*path)
+	{
+		fEntry = NULL;
+		return;
+	}
+
+	uint32 hash = hash_path(path);
+
+	BAutolock lock(table_lock());
+	path_entry *entry = find_entry(path, hash);
+	if (!entry)
+	{
+		if (sEntryCount >= sBucketCount)
+			grow_table();
+
+		if (sBucketCount == 0)
+		{
+			fEntry = NULL;
+			return;
+		}
+
+		entry = new path_entry(path, hash);
+		uint32 index = hash & (sBucketCount - 1);
+		entry->next = sBuckets[index];
+		sBuckets[index] = entry;
+		sEntryCount++;
+	}
+	fEntry = entry;
+}
+
+
+PathHandle
+PathHandle::Find(const char *path)
+{
+	PathHandle handle;
+	if (!path || !*path)
+		return handle;
+
+	uint32 hash = hash_path(path);
+
+	BAutolock lock(table_lock());
+	handle.fEntry = find_entry(path, hash);
+	return handle;
+}
+
+
+bool
+PathHandle::IsEmpty(void) const
+{
+	return fEntry == NULL;
+}
+
+
+const DPath &
+PathHandle::Path(void) const
+{
+	static const DPath sEmptyPath;
+	return fEntry ? fEntry->path : sEmptyPath;
+}
+
+
+const char *
+PathHandle::FullPath(void) const
+{
+	return fEntry ? fEntry->path.GetFullPath() : NULL;
+}
+
+
+const char *
+PathHandle::Folder(void) const
+{
+	return fEntry ? fEntry->path.GetFolder() : NULL;
+}
+
+
+const char *
+PathHandle::FileName(void) const
+{
+	return fEntry ? fEntry->path.GetFileName() : NULL;
+}
+
+
+const char *
+PathHandle::BaseName(void) const
+{
+	return fEntry ? fEntry->path.GetBaseName() : NULL;
+}
+
+
+const char *
+PathHandle::Extension(void) const
+{
+	return fEntry ? fEntry->path.GetExtension() : NULL;
+}
+
+
+uint32
+PathHandle::Hash(void) const
+{
+	return fEntry ? fEntry->hash : 0;
+}
@@ -0,0 +1,57 @@
+#ifndef PATHTABLE_H
+#define PATHTABLE_H
+
+#include "DPath.h"
+
+struct path_entry;
+
+// A path stored once for the whole application. Each distinct path string is
+// split into its parts a single time when it is first seen; every handle to
+// it shares that copy, so handles are as cheap to copy and compare as a
+// pointer and the parts can be read without making new strings.
+//
+// Entries are never removed. A session only ever sees a few thousand paths.
+class PathHandle
+{
+public:
+							PathHandle(void);
+							PathHandle(const char *path);
+
+			void			SetTo(const char *path);
+
+			// Looks a path up without adding it. A path which isn't in the
+			// table can't belong to anything which holds a handle.
+	static	PathHandle		Find(const char *path);
+
+			bool			IsEmpty(void) const;
+
+			const DPath &	Path(void) const;
+			const char *	FullPath(void) const;
+			const char *	Folder(void) const;
+			const char *	FileName(void) const;
+			const char *	BaseName(void) const;
+			const char *	Extension(void) const;
+			uint32			Hash(void) const;
+
+			bool			operator==(const PathHandle &other) const;
+			bool			operator!=(const PathHandle &other) const;
+
+private:
+			const path_entry *	fEntry;
+};
+
+
+inline bool
+PathHandle::operator==(const PathHandle &other) const
+{
+	return fEntry == other.fEntry;
+}
+
+
+inline bool
+PathHandle::operator!=(const PathHandle &other) const
+{
+	return fEntry != other.fEntry;
+}
+
+#endif
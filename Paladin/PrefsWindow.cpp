@@ -23,10 +23,13 @@
 #include <PopUpMenu.h>
 #include <StringView.h>
 #include <TabView.h>
+#include <TextControl.h>
 #include <View.h>
+#include <stdlib.h>
 
 #include "DPath.h"
 #include "Globals.h"
+#include "JobPool.h"
 #include "PathBox.h"
 #include "Settings.h"
 
@@ -43,6 +46,10 @@ enum
 	M_SET_SHOW_PROJECT_FOLDER = 'sspf',
 	M_SET_DONT_ADD_HEADERS = 'sdah',
 	M_SET_SLOW_BUILDS = 'ssbl',
+	M_SET_BUILD_JOBS = 'sbjb',
+	M_SET_BUILD_MEMORY = 'sbmm',
+	M_SET_KEEP_GOING = 'skgo',
+	M_SET_BACKGROUND_BUILD = 'sbgb',
 	M_SET_CCACHE = 'scac',
 	M_SET_FASTDEP = 'sfsd',
 	M_SET_AUTOSYNC = 'saus',
@@ -59,6 +66,10 @@ PrefsWindow::PrefsWindow(BRect frame)
 	fShowProjectFolder(NULL),
 	fDontAddHeaders(NULL),
 	fSlowBuilds(NULL),
+	fBuildJobs(NULL),
+	fBuildMemory(NULL),
+	fKeepGoing(NULL),
+	fBackgroundBuild(NULL),
 	fCCache(NULL),
 	fFastDep(NULL),
 	fAutoSyncModules(NULL),
@@ -99,6 +110,49 @@ PrefsWindow::PrefsWindow(BRect frame)
 	if (gSingleThreadedBuild)
 		fSlowBuilds->SetValue(B_CONTROL_ON);
 
+	BString jobs;
+	if (gBuildJobs > 0)
+		jobs << gBuildJobs;
+	fBuildJobs = new BTextControl("buildjobs", B_TRANSLATE("Build jobs:"),
+		jobs.String(), new BMessage(M_SET_BUILD_JOBS));
+	SetToolTip(fBuildJobs, B_TRANSLATE("How many files are built at the same time. "
+		"Leave empty for one per processor."));
+	for (uint32 i = 0; i < 256; i++) {
+		if (i < '0' || i > '9')
+			fBuildJobs->TextView()->DisallowChar(i);
+	}
+	fBuildJobs->SetEnabled(!gSingleThreadedBuild);
+
+	BString memory;
+	if (gBuildMemory > 0)
+		memory << gBuildMemory;
+	fBuildMemory = new BTextControl("buildmemory", B_TRANSLATE("Memory (MB):"),
+		memory.String(), new BMessage(M_SET_BUILD_MEMORY));
+	SetToolTip(fBuildMemory, B_TRANSLATE("Files which took a lot of memory to build "
+		"before wait for others to finish once builds would need more than this. "
+		"Leave empty for three quarters of the system's memory."));
+	for (uint32 i = 0; i < 256; i++) {
+		if (i < '0' || i > '9')
+			fBuildMemory->TextView()->DisallowChar(i);
+	}
+	fBuildMemory->SetEnabled(!gSingleThreadedBuild);
+
+	fKeepGoing = new BCheckBox("keepgoing", B_TRANSLATE("Keep going after errors"),
+		new BMessage(M_SET_KEEP_GOING));
+	SetToolTip(fKeepGoing, B_TRANSLATE("Build every file even when some have errors, "
+		"and show all of the errors at the end. Nothing is linked until they are fixed."));
+	if (gKeepGoing)
+		fKeepGoing->SetValue(B_CONTROL_ON);
+
+	fBackgroundBuild = new BCheckBox("backgroundbuild",
+		B_TRANSLATE("Compile files in the background when saved"),
+		new BMessage(M_SET_BACKGROUND_BUILD));
+	SetToolTip(fBackgroundBuild, B_TRANSLATE("Compile a file and the ones "
+		"which include it at low priority soon after it is saved, so that "
+		"the next build has less to do"));
+	if (gBackgroundBuild)
+		fBackgroundBuild->SetValue(B_CONTROL_ON);
+
 	fCCache = new BCheckBox("ccache", B_TRANSLATE("Use ccache to build faster"),
 		new BMessage(M_SET_CCACHE));
 	SetToolTip(fCCache, B_TRANSLATE("Compiler caching is another way to speed up builds"));
@@ -128,6 +182,13 @@ PrefsWindow::PrefsWindow(BRect frame)
 	BBox* buildBox = new BBox(B_FANCY_BORDER,
 		BLayoutBuilder::Group<>(B_VERTICAL, 0)
 			.Add(fSlowBuilds)
+			.AddGroup(B_HORIZONTAL)
+				.Add(fBuildJobs)
+				.Add(fBuildMemory)
+				.AddGlue()
+				.End()
+			.Add(fKeepGoing)
+			.Add(fBackgroundBuild)
 			.Add(fCCache)
 			.Add(fFastDep)
 			.SetInsets(B_USE_DEFAULT_SPACING, B_USE_SMALL_SPACING,
@@ -303,6 +364,39 @@ PrefsWindow::MessageReceived(BMessage* message)
 			gSingleThreadedBuild = (fSlowBuilds->Value() == B_CONTROL_ON);
 			gSettings.SetBool("singlethreaded", gSingleThreadedBuild);
 			gSettings.Save();
+			fBuildJobs->SetEnabled(!gSingleThreadedBuild);
+			fBuildMemory->SetEnabled(!gSingleThreadedBuild);
+			gJobPool.SetSlots(BuildJobCount());
+			break;
+		}
+		case M_SET_BUILD_JOBS:
+		{
+			gBuildJobs = MAX(atol(fBuildJobs->Text()), 0);
+			gSettings.SetInt32("buildjobs", gBuildJobs);
+			gSettings.Save();
+			gJobPool.SetSlots(BuildJobCount());
+			break;
+		}
+		case M_SET_BUILD_MEMORY:
+		{
+			gBuildMemory = MAX(atol(fBuildMemory->Text()), 0);
+			gSettings.SetInt32("buildmemory", gBuildMemory);
+			gSettings.Save();
+			gJobPool.SetMemoryBudget(BuildMemoryBudget());
+			break;
+		}
+		case M_SET_KEEP_GOING:
+		{
+			gKeepGoing = (fKeepGoing->Value() == B_CONTROL_ON);
+			gSettings.SetBool("keepgoing", gKeepGoing);
+			gSettings.Save();
+			break;
+		}
+		case M_SET_BACKGROUND_BUILD:
+		{
+			gBackgroundBuild = (fBackgroundBuild->Value() == B_CONTROL_ON);
+			gSettings.SetBool("backgroundbuild", gBackgroundBuild);
+			gSettings.Save();
 			break;
 		}
 		case M_SET_CCACHE:
@@ -17,6 +17,7 @@
 class BCheckBox;
 class BMenuField;
 class BTabView;
+class BTextControl;
 class BView;
 
 class PathBox;
@@ -36,6 +37,10 @@ private:
 			BCheckBox*			fDontAddHeaders;
 
 			BCheckBox*			fSlowBuilds;
+			BTextControl*		fBuildJobs;
+			BTextControl*		fBuildMemory;
+			BCheckBox*			fKeepGoing;
+			BCheckBox*			fBackgroundBuild;
 			BCheckBox*			fCCache;
 			BCheckBox*			fFastDep;
 
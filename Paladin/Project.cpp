@@ -13,6 +13,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <fs_attr.h>
 
@@ -34,6 +35,8 @@
 #include "FileFactory.h"
 #include "Globals.h"
 #include "LaunchHelper.h"
+#include "ObjectManifest.h"
+#include "PathTable.h"
 #include "SCMManager.h"
 #include "SourceFile.h"
 #include "TextFile.h"
@@ -132,13 +135,13 @@ Project::Load(const char* path)
 
 	SourceGroup *srcgroup = NULL;
 	SourceFile *srcfile = NULL;
-	BString line = file.ReadLine();
-	while (line.CountChars() > 0) {
+	const char* start;
+	int32 length;
+	while (file.NextLine(start, length)) {
+		BString line(start, length);
 		int32 pos = line.FindFirst("=");
-		if (pos < 0) {
-			line = file.ReadLine();
+		if (pos < 0)
 			continue;
-		}
 
 		BString entry = line;
 		entry.Truncate(pos);
@@ -242,8 +245,6 @@ Project::Load(const char* path)
 					fPlatform = PLATFORM_R5;
 			}	
 		}
-
-		line = file.ReadLine();
 	}
 
 	// Fix one of my pet peeves when changing platforms: having to add libsupc++.so
@@ -273,64 +274,83 @@ Project::Load(const char* path)
 }
 
 
+static void
+write_entry(TextFile& file, const char* key, const char* value)
+{
+	file.WriteString(key);
+	file.WriteString("=");
+	file.WriteString(value);
+	file.WriteString("\n");
+}
+
+
 void
 Project::Save(const char* path)
 {
 	BString projectPath = fPath.GetFolder();
 	projectPath << "/";
 
-	BString data;
-	data << "NAME=" << fName << "\nTARGETNAME=" << fTargetName << "\n";
-	data << "PLATFORM=" << sPlatformArray[fPlatform] << "\n";
+	// Everything is written through the file's buffer as it is put together
+	TextFile file(path, B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
+	if (file.InitCheck() != B_OK) {
+		STRACE(2,("Couldn't create project file %s. Bailing out\n",path));
+		return;
+	}
+
+	write_entry(file, "NAME", fName.String());
+	write_entry(file, "TARGETNAME", fTargetName.String());
+	write_entry(file, "PLATFORM", sPlatformArray[fPlatform].String());
 
 	switch (fSCMType) {
 		case SCM_HG:
 		{
-			data << "SCM=hg\n";
+			file.WriteString("SCM=hg\n");
 			break;
 		}
 
 		case SCM_GIT:
 		{
-			data << "SCM=git\n";
+			file.WriteString("SCM=git\n");
 			break;
 		}
 
 		case SCM_SVN:
 		{
-			data << "SCM=svn\n";
+			file.WriteString("SCM=svn\n");
 			break;
 		}
 
 		case SCM_NONE:
 		{
-			data << "SCM=none\n";
+			file.WriteString("SCM=none\n");
 			break;
 		}
 	}
 
 	for (int32 i = 0; i < CountGroups(); i++) {
 		SourceGroup* group = GroupAt(i);
-		data << "GROUP=" << group->name << "\n";
-		data << "EXPANDGROUP=" << (group->expanded ? "yes" : "no") << "\n";
+		write_entry(file, "GROUP", group->name.String());
+		write_entry(file, "EXPANDGROUP", group->expanded ? "yes" : "no");
 		
 		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
-			SourceFile* file = group->filelist.ItemAt(j);
+			SourceFile* sourceFile = group->filelist.ItemAt(j);
 
-			BString temppath(file->GetPath().GetFullPath());
-			temppath.ReplaceAll(projectPath, "");
+			// Files in the project folder are saved relative to it
+			const char* filePath = sourceFile->GetPath().GetFullPath();
+			if (strncmp(filePath, projectPath.String(), projectPath.Length()) == 0)
+				filePath += projectPath.Length();
 
-			data << "SOURCEFILE=" << temppath << "\n";
-			if (file->GetDependencies() && strlen(file->GetDependencies()) > 0) {
-				BString deps = file->GetDependencies();
+			write_entry(file, "SOURCEFILE", filePath);
+			if (sourceFile->GetDependencies() && strlen(sourceFile->GetDependencies()) > 0) {
+				BString deps = sourceFile->GetDependencies();
 				deps.ReplaceAll(projectPath, "");
-				data << "DEPENDENCY=" << deps << "\n";
+				write_entry(file, "DEPENDENCY", deps.String());
 			}
 		}
 	}
 
 	for (int32 i = 0; i < fLocalIncludeList.CountItems(); i++)
-		data << "LOCALINCLUDE=" << fLocalIncludeList.ItemAt(i)->Relative() << "\n";
+		write_entry(file, "LOCALINCLUDE", fLocalIncludeList.ItemAt(i)->Relative().String());
 
 	for (int32 i = 0; i < fSystemIncludeList.CountItems(); i++) {
 		BString* string = fSystemIncludeList.ItemAt(i);
@@ -346,7 +366,7 @@ Project::Save(const char* path)
 		if (include.FindFirst(replacePath) == 0)
 			include.ReplaceFirst(replacePath,"B_FIND_PATH_DEVELOP_HEADERS_DIRECTORY");
 
-		data << "SYSTEMINCLUDE=" << include << "\n";
+		write_entry(file, "SYSTEMINCLUDE", include.String());
 	}
 
 	char* pathBuffer = new char[255]; // TODO validate this won't overflow, or be too short
@@ -376,11 +396,11 @@ Project::Save(const char* path)
 	}
 		
 	for (int32 i = 0; i < fLibraryList.CountItems(); i++) {
-		SourceFile* file = (SourceFile*)fLibraryList.ItemAt(i);
-		if (file == NULL)
+		SourceFile* library = (SourceFile*)fLibraryList.ItemAt(i);
+		if (library == NULL)
 			continue;
 
-		BString strpath(file->GetPath().GetFullPath());
+		BString strpath(library->GetPath().GetFullPath());
 		if (gPlatform == PLATFORM_ZETA) {
 			if (strpath.FindFirst("/boot/beos/etc/develop/zeta-r1-gcc2-x86/") == 0) {
 				strpath.ReplaceFirst("/boot/beos/etc/develop/zeta-r1-gcc2-x86/",
@@ -408,27 +428,28 @@ Project::Save(const char* path)
 		if (strpath.FindFirst(replacePath) == 0)
 			strpath.ReplaceFirst(replacePath,"B_FIND_PATH_LIB_DIRECTORY");
 
-		data << "LIBRARY=" << strpath.String() << "\n";
+		write_entry(file, "LIBRARY", strpath.String());
 	}
 
-	data << "RUNARGS=" << fRunArgs << "\n";
-	data << "CCDEBUG=" << (fDebug ? "yes" : "no") << "\n";
-	data << "CCPROFILE=" << (fProfile ? "yes" : "no") << "\n";
-	data << "CCOPSIZE=" << (fOpSize ? "yes" : "no") << "\n";
-	data << "CCOPLEVEL=" << (int)fOpLevel << "\n";
-	data << "CCTARGETTYPE=" << fTargetType << "\n";
-	data << "CCEXTRA=" << fExtraCompilerOptions << "\n";
-	data << "LDEXTRA=" << fExtraLinkerOptions << "\n";
-
-	BFile file(path,B_READ_WRITE | B_CREATE_FILE | B_ERASE_FILE);
-	if (file.InitCheck() != B_OK) {
-		STRACE(2,("Couldn't create project file %s. Bailing out\n",path));
+	BString number;
+	write_entry(file, "RUNARGS", fRunArgs.String());
+	write_entry(file, "CCDEBUG", fDebug ? "yes" : "no");
+	write_entry(file, "CCPROFILE", fProfile ? "yes" : "no");
+	write_entry(file, "CCOPSIZE", fOpSize ? "yes" : "no");
+	number << (int)fOpLevel;
+	write_entry(file, "CCOPLEVEL", number.String());
+	number = "";
+	number << fTargetType;
+	write_entry(file, "CCTARGETTYPE", number.String());
+	write_entry(file, "CCEXTRA", fExtraCompilerOptions.String());
+	write_entry(file, "LDEXTRA", fExtraLinkerOptions.String());
+
+	if (file.Flush() != B_OK) {
+		STRACE(2,("Couldn't write project file %s\n",path));
 		return;
 	}
 
-	STRACE(2,("Saved Project %s. Data as follows:\n%s\n",path,data.String()));
-
-	file.Write(data.String(),data.Length());
+	STRACE(2,("Saved Project %s\n",path));
 
 	fPath = path;
 	fObjectPath = fPath.GetFolder();
@@ -541,6 +562,37 @@ Project::AddFile(SourceFile *file, SourceGroup *group, int32 index)
 }
 
 
+void
+Project::AddFiles(const BObjectList<SourceFile> &files, SourceGroup *group)
+{
+	if (group == NULL) {
+		STRACE(2,("%s::AddFiles: NULL group in call\n",GetName()));
+		return;
+	}
+
+	bool outsideProject = false;
+	for (int32 i = 0; i < files.CountItems(); i++) {
+		SourceFile* file = files.ItemAt(i);
+		if (file == NULL)
+			continue;
+
+		group->filelist.AddItem(file);
+
+		const char* folder = file->GetPathHandle().Folder();
+		if (folder != NULL && strcmp(folder, fPath.GetFolder()) != 0) {
+			AddLocalInclude(folder);
+			outsideProject = true;
+		}
+	}
+
+	if (outsideProject)
+		UpdateBuildInfo();
+
+	STRACE(2, ("%s::AddFiles: Added %ld files to %s\n", GetName(),
+		(long)files.CountItems(), group->name.String()));
+}
+
+
 void
 Project::RemoveFile(SourceFile* file)
 {
@@ -565,20 +617,7 @@ Project::RemoveFile(SourceFile* file)
 bool
 Project::HasFile(const char* path)
 {
-	if (path == NULL)
-		return false;
-
-	for (int32 i = 0; i < CountGroups(); i++) {
-		SourceGroup* group = GroupAt(i);
-
-		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
-			SourceFile* source = group->filelist.ItemAt(j);
-			if (source != NULL && strcmp(source->GetPath().GetFullPath(), path) == 0)
-				return true;
-		}
-	}
-
-	return false;
+	return FindFile(path) != NULL;
 }
 
 
@@ -588,16 +627,20 @@ Project::HasFileName(const char* name)
 	if (name == NULL)
 		return false;
 
-	DPath newfile(name);
+	const char* newname = strrchr(name, '/');
+	newname = (newname != NULL) ? newname + 1 : name;
+
 	for (int32 i = 0; i < CountGroups(); i++) {
 		SourceGroup* group = GroupAt(i);
 
 		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
 			SourceFile* source = group->filelist.ItemAt(j);
-			if (source != NULL && strcmp(source->GetPath().GetFileName(),
-					newfile.GetFileName()) == 0) {
+			if (source == NULL)
+				continue;
+
+			const char* filename = source->GetPathHandle().FileName();
+			if (filename != NULL && strcmp(filename, newname) == 0)
 				return true;
-			}
 		}
 	}
 
@@ -633,14 +676,17 @@ Project::LocateFile(const char *name, BPath& outPath)
 SourceFile*
 Project::FindFile(const char* path)
 {
-	if (path == NULL)
+	// Every file's path is in the path table, so a path which isn't can't
+	// be in the project. Otherwise matching handles is a pointer compare.
+	PathHandle handle = PathHandle::Find(path);
+	if (handle.IsEmpty())
 		return NULL;
 
 	for (int32 i = 0; i < CountGroups(); i++) {
 		SourceGroup* group = GroupAt(i);
 		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
 			SourceFile* source = group->filelist.ItemAt(j);
-			if (source && strcmp(source->GetPath().GetFullPath(), path) == 0)
+			if (source && source->GetPathHandle() == handle)
 				return source;
 		}
 	}
@@ -703,13 +749,19 @@ Project::CountDirtyFiles(void) const
 void
 Project::SortDirtyList(void)
 {
-	for (int32 i = 0; i < CountGroups(); i++) {
-		SourceGroup* group = GroupAt(i);
-		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
-			SourceFile* file = group->filelist.ItemAt(j);
-			if (IsFileDirty(file)) {
-				MakeFileClean(file);
-				MakeFileDirty(file);
+	// Lex and Yacc files take two steps to build, so they are started first
+	// to keep them from being the last thing the link waits for
+	for (int32 pass = 0; pass < 2; pass++) {
+		for (int32 i = 0; i < CountGroups(); i++) {
+			SourceGroup* group = GroupAt(i);
+			for (int32 j = 0; j < group->filelist.CountItems(); j++) {
+				SourceFile* file = group->filelist.ItemAt(j);
+				bool generated = file->GetType() == TYPE_LEX
+					|| file->GetType() == TYPE_YACC;
+				if (IsFileDirty(file) && generated == (pass == 0)) {
+					MakeFileClean(file);
+					MakeFileDirty(file);
+				}
 			}
 		}
 	}
@@ -754,23 +806,9 @@ Project::UpdateBuildInfo(void)
 }
 
 
-void
-Project::PrecompileFile(SourceFile* file)
-{
-	if (file == NULL)
-		return;
-
-	DPath projfolder(GetPath().GetFolder());
-	file->Precompile(fBuildInfo,"");
-}
-
-
-void
-Project::CompileFile(SourceFile* file)
+BString
+Project::GetCompileOptions(void)
 {
-	if (file == NULL)
-		return;
-	
 	BString compileString;
 	if (Debug())
 		compileString << "-g -O0 ";
@@ -806,13 +844,12 @@ Project::CompileFile(SourceFile* file)
 		compileString << "-I '" << item.String() << "' ";
 	}
 
-	DPath projfolder(GetPath().GetFolder());
-	file->Compile(fBuildInfo,compileString.String());
+	return compileString;
 }
 
 
-void
-Project::Link(void)
+BString
+Project::GetLinkCommand(void)
 {
 	BString linkString;
 	BString targetPath;
@@ -925,20 +962,12 @@ Project::Link(void)
 	}
 
 	linkString << " 2>&1";
-
-	BString errorMessage;
-	PipeCommand(linkString.String(),errorMessage);
-
-	STRACE(1, ("Linking %s:\n%s\nErrors:\n%s\n", GetName(), linkString.String(),
-		errorMessage.String()));
-
-	if (errorMessage.CountChars() > 0)
-		ParseLDErrors(errorMessage.String(),fBuildInfo.errorList);
+	return linkString;
 }
 
 
-void
-Project::UpdateResources(void)
+BString
+Project::GetResourceCommand(void)
 {
 	DPath targetpath(fPath.GetFolder());
 	targetpath.Append(GetTargetName());
@@ -957,61 +986,12 @@ Project::UpdateResources(void)
 		}
 	}
 
+	BString resString;
 	if (resCount > 0) {
-		BString resString = "xres -o ";
-		resString << "'" << targetpath.GetFullPath() << "' " << resFileString;		
-		BString errorMessage;
-		PipeCommand(resString.String(),errorMessage);
-
-		STRACE(1, ("Resources for %s:\n%s\nErrors:%s\n", GetName(), resString.String(),
-			errorMessage.String()));
-
-		if (errorMessage.CountChars() > 0)
-			printf("Resource errors: %s\n",errorMessage.String());
-	} else
-		STRACE(1, ("Resources for %s: No resource files to add\n", GetName()));
-}
-
-
-int32
-Project::UpdateAttributes(void)
-{
-	BResources res;
-	
-	BPath path(fPath.GetFolder());
-	path.Append(GetTargetName());
-	
-	BFile file(path.Path(), B_READ_WRITE);
-	if (file.InitCheck() != B_OK)
-		return B_BAD_VALUE;
-	
-	if (res.SetTo(&file) != B_OK)
-		return B_ERROR;
-	
-	ResourceToAttribute(file,res,'MIMS',"BEOS:APP_SIG");
-	ResourceToAttribute(file,res,'MIMS',"BEOS:TYPE");
-	ResourceToAttribute(file,res,'MSGG',"BEOS:FILE_TYPES");
-	ResourceToAttribute(file,res,'APPV',"BEOS:APP_VERSION");
-	ResourceToAttribute(file,res,'APPF',"BEOS:APP_FLAGS");
-	ResourceToAttribute(file,res,'ICON',"BEOS:L:STD_ICON");
-	ResourceToAttribute(file,res,'MICN',"BEOS:M:STD_ICON");
-	ResourceToAttribute(file,res,'VICN',"BEOS:ICON");
-	
-	return B_OK;
-}
-
-
-void
-Project::PostBuild(SourceFile *file)
-{
-	if (!file)
-	{
-		STRACE(1,("%s: Post-rebuild\n",GetName()));
-		return;
+		resString = "xres -o ";
+		resString << "'" << targetpath.GetFullPath() << "' " << resFileString;
 	}
-
-	DPath projfolder(GetPath().GetFolder());
-	file->PostBuild(fBuildInfo,NULL);
+	return resString;
 }
 
 
@@ -1030,6 +1010,23 @@ Project::ForceRebuild(void)
 		}
 	}
 	
+	// Also catches the products of files no longer in the project
+	ObjectManifest manifest;
+	manifest.Load(fBuildInfo.objectFolder.GetFullPath());
+	manifest.RemoveAll();
+	manifest.Save();
+}
+
+
+void
+Project::GetBuildProducts(BStringList &list)
+{
+	for (int32 i = 0; i < CountGroups(); i++)
+	{
+		SourceGroup *group = GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++)
+			group->filelist.ItemAt(j)->GetBuildProducts(fBuildInfo, list);
+	}
 }
 
 
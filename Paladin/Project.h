@@ -13,6 +13,7 @@
 
 #include <Locker.h>
 #include <String.h>
+#include <StringList.h>
 #include <stdio.h>
 #include <time.h>
 #include <List.h>
@@ -95,6 +96,10 @@ public:
 			bool		LocateFile(const char *name, BPath& outPath);
 
 			void		AddFile(SourceFile *file, SourceGroup *group, int32 index = -1);
+			// Adds files to the end of a group, updating the build info only
+			// once. None of them may be in the project already.
+			void		AddFiles(const BObjectList<SourceFile> &files,
+								SourceGroup *group);
 			void		RemoveFile(SourceFile *file);
 			bool		HasFile(const char *path);
 			bool		HasFileName(const char *name);
@@ -111,12 +116,16 @@ public:
 			bool		CheckNeedsBuild(SourceFile *file, bool check_deps = true);
 			void		UpdateBuildInfo(void);
 			BuildInfo *	GetBuildInfo(void) { return &fBuildInfo; }
-			void		PrecompileFile(SourceFile *file);
-			void		CompileFile(SourceFile *file);
-			void		Link(void);
-			void		UpdateResources(void);
-			int32		UpdateAttributes(void);
-			void		PostBuild(SourceFile *file);
+			
+			// What a build runs, put together from the current settings.
+			// BuildSnapshot keeps copies of these so that a build doesn't
+			// need the project once it has started.
+			BString		GetCompileOptions(void);
+			BString		GetLinkCommand(void);
+			// Empty if there are no resource files
+			BString		GetResourceCommand(void);
+			void		GetBuildProducts(BStringList &list);
+			
 			void		ForceRebuild(void);
 			
 			void		UpdateErrorList(const ErrorList &list);
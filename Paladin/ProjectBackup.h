@@ -0,0 +1,40 @@
+#ifndef PROJECTBACKUP_H
+#define PROJECTBACKUP_H
+
+#include <String.h>
+#include <StringList.h>
+
+// Incremental backups of a project folder. File contents are cut into
+// chunks which are compressed and stored once under the name of their hash,
+// and each backup writes a snapshot listing the chunks of every file. Files
+// whose size and modification time are the same as in the previous snapshot
+// are not read again, and chunks which are already stored aren't written
+// again, so a backup costs about as much as the changes since the last one.
+//
+// The backups of a project are kept in <backup folder>/<name>.backups:
+//	objects/xx/<hash>	compressed chunks
+//	snapshots/<time>	one manifest per backup
+class ProjectBackup
+{
+public:
+						ProjectBackup(const char *projectName,
+									const char *backupFolder);
+
+			// Backs up everything in the folder except objects folders and
+			// object files. The name of the new snapshot is put in name.
+			status_t	Backup(const char *sourceFolder, BString *name = NULL);
+
+			// Recreates the folder as it was in a snapshot. The destination
+			// must not exist yet.
+			status_t	Restore(const char *snapshot, const char *destFolder);
+
+			// Snapshot names, newest first
+			status_t	GetSnapshots(BStringList &list) const;
+
+			const char *StoragePath(void) const { return fStorage.String(); }
+
+private:
+			BString		fStorage;
+};
+
+#endif
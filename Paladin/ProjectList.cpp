@@ -26,6 +26,7 @@
 #include "DebugTools.h"
 #include "MsgDefs.h"
 #include "Project.h"
+#include "SourceControl.h"
 #include "SourceFile.h"
 
 
@@ -555,7 +556,8 @@ ProjectList::charncmp(char c1, char c2)
 SourceFileItem::SourceFileItem(SourceFile *data, int32 level)
 	:	BStringItem("",level),
 		fData(NULL),
-		fDisplayState(SFITEM_NORMAL)
+		fDisplayState(SFITEM_NORMAL),
+		fSCMState(SCM_FILE_CLEAN)
 {
 	SetData(data);
 }
@@ -658,6 +660,44 @@ SourceFileItem::DrawItem(BView* owner, BRect frame, bool complete)
 	owner->SetHighColor(textColor);
 	owner->SetLowColor(backColor);
 	owner->DrawString(Text());
+
+	const char* badge = NULL;
+	rgb_color badgeColor = {0, 0, 0, 255};
+	switch (fSCMState) {
+		case SCM_FILE_MODIFIED:
+			badge = "M";
+			SET_COLOR(badgeColor, 176, 112, 0);
+			break;
+
+		case SCM_FILE_ADDED:
+			badge = "A";
+			SET_COLOR(badgeColor, 0, 144, 0);
+			break;
+
+		case SCM_FILE_REMOVED:
+			badge = "R";
+			SET_COLOR(badgeColor, 192, 0, 0);
+			break;
+
+		case SCM_FILE_UNTRACKED:
+			badge = "?";
+			SET_COLOR(badgeColor, 128, 128, 128);
+			break;
+
+		case SCM_FILE_CONFLICTED:
+			badge = "C";
+			SET_COLOR(badgeColor, 224, 0, 0);
+			break;
+	}
+
+	if (badge != NULL) {
+		BFont bold(be_bold_font);
+		owner->SetFont(&bold);
+		float x = frame.right - bold.StringWidth("M") - 4.0;
+		owner->SetHighColor(badgeColor);
+		owner->DrawString(badge, BPoint(x, frame.top + fTextOffset));
+		owner->SetFont(be_plain_font);
+	}
 }
 
 
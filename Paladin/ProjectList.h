@@ -39,11 +39,16 @@ public:
 		void		SetDisplayState(uint8 state);
 		uint8		GetDisplayState(void) const { return fDisplayState; }
 		
+		// One of the SCM_FILE_* states, shown as a letter at the right
+		void		SetSCMState(int32 state) { fSCMState = state; }
+		int32		GetSCMState(void) const { return fSCMState; }
+		
 		void		DrawItem(BView *owner, BRect frame, bool complete = false);
 		void		Update(BView *owner, const BFont *font);
 private:
 		SourceFile	*fData;
 		uint8		fDisplayState;
+		int32		fSCMState;
 		float		fTextOffset;
 };
 
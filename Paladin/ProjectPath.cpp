@@ -22,6 +22,7 @@ ProjectPath::operator=(const ProjectPath &from)
 {
 	fBase = from.fBase;
 	fPath = from.fPath;
+	fAbsolute = from.fAbsolute;
 	return *this;
 }
 
@@ -54,6 +55,7 @@ ProjectPath::SetBase(const char *base)
 	fBase = base;
 	if (fBase.CountChars() > 0 && fBase.ByteAt(fBase.CountChars() - 1) != '/')
 		fBase << "/";
+	UpdateAbsolute();
 }
 
 
@@ -79,6 +81,7 @@ ProjectPath::SetPath(const char *path)
 		if (fPath.FindFirst("/") == 0)
 			fPath.RemoveFirst("/");
 	}
+	UpdateAbsolute();
 }
 
 
@@ -104,3 +107,10 @@ ProjectPath::Relative(void) const
 	return fPath;
 }
 
+
+void
+ProjectPath::UpdateAbsolute(void)
+{
+	fAbsolute.SetTo(Absolute().String());
+}
+
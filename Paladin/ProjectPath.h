@@ -4,6 +4,8 @@
 #include <Entry.h>
 #include <String.h>
 
+#include "PathTable.h"
+
 class ProjectPath
 {
 public:
@@ -25,9 +27,15 @@ public:
 	BString			Absolute(void) const;
 	BString			Relative(void) const;
 	
+	// The absolute path, worked out once when the path is set
+	const PathHandle &	AbsoluteHandle(void) const { return fAbsolute; }
+	
 private:
+	void			UpdateAbsolute(void);
+	
 	BString		fBase,
 				fPath;
+	PathHandle	fAbsolute;
 };
 
 #endif
@@ -15,8 +15,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <time.h>
 
+#include <map>
+#include <set>
+
 #include <Alert.h>
 #include <Application.h>
 #include <Catalog.h>
@@ -29,6 +33,7 @@
 #include <Locale.h>
 #include <MenuItem.h>
 #include <Node.h>
+#include <NodeMonitor.h>
 #include <OS.h>
 #include <Roster.h>
 #include <Screen.h>
@@ -44,6 +49,8 @@
 #include "AltTabFilter.h"
 #include "AppDebug.h"
 #include "AsciiWindow.h"
+#include "BackgroundCompiler.h"
+#include "BuildTimingsWindow.h"
 #include "CodeLibWindow.h"
 #include "DebugTools.h"
 #include "ErrorParser.h"
@@ -52,6 +59,7 @@
 #include "FileFactory.h"
 #include "FindOpenFileWindow.h"
 #include "FindWindow.h"
+#include "FolderScanner.h"
 #include "GetTextWindow.h"
 #include "Globals.h"
 #include "GroupRenameWindow.h"
@@ -66,12 +74,15 @@
 #include "ProjectList.h"
 #include "ProjectSettingsWindow.h"
 #include "Project.h"
+#include "ProjectBackup.h"
 #include "ProjectStatus.h"
 #include "RunArgsWindow.h"
 #include "SCMManager.h"
 #include "SCMOutputWindow.h"
+#include "SCMStatusCache.h"
 #include "Settings.h"
 #include "SourceFile.h"
+#include "StatCache.h"
 #include "VRegWindow.h"
 
 #undef B_TRANSLATION_CONTEXT
@@ -89,6 +100,9 @@ enum {
 	M_RUN_TOOL					= 'rntl',
 	M_UPDATE_DEPENDENCIES		= 'updp',
 	M_BUILD_PROJECT				= 'blpj',
+	M_STOP_BUILD				= 'stbl',
+	M_CHECK_SYNTAX				= 'chsx',
+	M_CHECK_SYNTAX_ALL			= 'chsa',
 	M_DEBUG_PROJECT				= 'PRnD',
 	M_EDIT_FILE					= 'edfl',
 	M_ADD_NEW_FILE				= 'adnf',
@@ -96,8 +110,11 @@ enum {
 	M_RENAME_GROUP				= 'rngr',
 	M_SHOW_LICENSES				= 'shlc',
 	M_MAKE_MAKE					= 'mkmk',
+	M_MAKE_NINJA				= 'mknj',
 	M_SHOW_CODE_LIBRARY			= 'shcl',
 	M_SYNC_MODULES				= 'synm',
+	M_SHOW_BUILD_TIMINGS		= 'sbtm',
+	M_RESTORE_BACKUP			= 'rsbk',
 
 	M_GET_CHECK_IN_MSG			= 'gcim',
 	M_CHECK_IN_PROJECT			= 'prci',
@@ -110,6 +127,7 @@ enum {
 	M_TOGGLE_DEBUG_MENU			= 'sdbm',
 	M_DEBUG_DUMP_DEPENDENCIES	= 'dbdd',
 	M_DEBUG_DUMP_INCLUDES		= 'dbdi',
+	M_DEBUG_TIME_REGEX			= 'dbtr',
 	
 	M_SET_STATUS				= 'stat'
 };
@@ -119,14 +137,23 @@ static int
 compare_source_file_items(const BListItem* item1, const BListItem* item2);
 
 
+struct restore_data {
+	ProjectWindow*	parent;
+	BString			snapshot;
+};
+
+
 ProjectWindow::ProjectWindow(BRect frame, Project* project)
 	:
 	BWindow(frame, B_TRANSLATE("Paladin: Project"), B_DOCUMENT_WINDOW,
 		B_NOT_ZOOMABLE),
 	fErrorWindow(NULL),
+	fStopBuildItem(NULL),
 	fFilePanel(NULL),
 	fProject(project),
 	fSourceControl(NULL),
+	fSCMStatus(NULL),
+	fBackgroundCompiler(NULL),
 	fProjectSettingsWindow(NULL),
 	fShowingLibs(false),
 	fMenusLocked(false),
@@ -156,6 +183,8 @@ ProjectWindow::ProjectWindow(BRect frame, Project* project)
 
 			if (fSourceControl->NeedsInit(fProject->GetPath().GetFolder()))
 				fSourceControl->CreateRepository(fProject->GetPath().GetFolder());
+
+			fSCMStatus = new SCMStatusCache(fSourceControl, BMessenger(this));
 		}
 	}
 
@@ -204,6 +233,8 @@ ProjectWindow::ProjectWindow(BRect frame, Project* project)
 		SetTitle(title.String());
 
 		UpdateProjectList();
+
+		UpdateSCMStatus();
 	}
 	
 	BNode node(fProject->GetPath().GetFullPath());
@@ -265,6 +296,10 @@ ProjectWindow::~ProjectWindow()
 	if (gAutoSyncModules)
 		ProjectWindow::SyncThread(this);
 
+	stop_watching(this);
+	delete fSCMStatus;
+	delete fBackgroundCompiler;
+
 	gProjectList->Lock();
 
 	int32 index = gProjectList->IndexOf(fProject);
@@ -280,6 +315,12 @@ void
 ProjectWindow::UpdateProjectList(void) {
 	fProjectList->Clear();
 
+	// Edits to project files are picked up through the node monitor so that
+	// their source control state can be updated and they can be compiled in
+	// the background
+	stop_watching(this);
+	fWatchedFiles.clear();
+
 		for (int32 i = 0; i < fProject->CountGroups(); i++) {
 			SourceGroup* group = fProject->GroupAt(i);
 			SourceGroupItem* groupitem = new SourceGroupItem(group);
@@ -299,6 +340,10 @@ ProjectWindow::UpdateProjectList(void) {
 				}
 				BEntry entry(abspath.String());
 				if (entry.Exists()) {
+					WatchFile(abspath.String());
+					if (fSCMStatus != NULL)
+						fileitem->SetSCMState(fSCMStatus->StateFor(abspath.String()));
+
 					if (fProject->CheckNeedsBuild(file,false)) {
 						fileitem->SetDisplayState(SFITEM_NEEDS_BUILD);
 						fProjectList->InvalidateItem(fProjectList->IndexOf(fileitem));
@@ -330,6 +375,18 @@ ProjectWindow::UpdateProjectList(void) {
 				// Add item for each
 				for (int32 d = 0;d < deplist.CountStrings(); d++) {
 					BString dep = deplist.StringAt(d);
+
+					// System headers don't change while working on a project
+					BString abspath(dep);
+					if (abspath[0] != '/') {
+						abspath.Prepend("/");
+						abspath.Prepend(fProject->GetPath().GetFolder());
+					}
+					BString projectFolder(fProject->GetPath().GetFolder());
+					projectFolder << "/";
+					if (abspath.Compare(projectFolder, projectFolder.Length()) == 0)
+						WatchFile(abspath.String());
+
 					BStringItem* depitem = new BStringItem(dep);
 					bool found = false;
 					STRACE(3,("Does dep exist?: %s\n", depitem->Text()));
@@ -445,6 +502,25 @@ ProjectWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case M_RESTORE_BACKUP:
+		{
+			restore_data* data = new restore_data;
+			data->parent = this;
+			if (message->FindString("snapshot", &data->snapshot) != B_OK) {
+				delete data;
+				break;
+			}
+
+			thread_id restoreThread = spawn_thread(RestoreThread,
+				"backup restore thread", B_NORMAL_PRIORITY, data);
+			if (restoreThread >= 0) {
+				SetStatus(B_TRANSLATE("Restoring backup"));
+				resume_thread(restoreThread);
+			} else
+				delete data;
+			break;
+		}
+
 		case M_GET_CHECK_IN_MSG:
 		{
 			if (!fSourceControl) {
@@ -480,6 +556,7 @@ ProjectWindow::MessageReceived(BMessage* message)
 				SCMOutputWindow* window = new SCMOutputWindow(B_TRANSLATE("Commit"));
 				window->Show();
 				fSourceControl->Commit(commitMessage.String());
+				UpdateSCMStatus();
 			}
 			break;
 		}
@@ -496,6 +573,7 @@ ProjectWindow::MessageReceived(BMessage* message)
 				SCMOutputWindow* window = new SCMOutputWindow(B_TRANSLATE("Revert"));
 				window->Show();
 				fSourceControl->Revert(NULL);
+				UpdateSCMStatus();
 			}
 			break;
 		}
@@ -548,6 +626,7 @@ ProjectWindow::MessageReceived(BMessage* message)
 				SCMOutputWindow* window = new SCMOutputWindow(B_TRANSLATE("Pull"));
 				window->Show();
 				status = fSourceControl->Pull(NULL);
+				UpdateSCMStatus();
 
 				if (status != B_OK) {
 					ShowAlert(B_TRANSLATE("Unable to pull from the remote "
@@ -660,10 +739,19 @@ ProjectWindow::MessageReceived(BMessage* message)
 		}
 
 		case M_MAKE_MAKE:
+		case M_MAKE_NINJA:
 		{
 			DPath out(fProject->GetPath().GetFolder());
-			out.Append("Makefile");
-			if (MakeMake(fProject, out) == B_OK) {
+			status_t status;
+			if (message->what == M_MAKE_NINJA) {
+				out.Append("build.ninja");
+				status = MakeNinja(fProject, out);
+			} else {
+				out.Append("Makefile");
+				status = MakeMake(fProject, out);
+			}
+
+			if (status == B_OK) {
 				BEntry entry(out.GetFullPath());
 				entry_ref ref;
 				if (entry.InitCheck() == B_OK) {
@@ -846,6 +934,67 @@ ProjectWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case B_NODE_MONITOR:
+		{
+			int32 opcode;
+			if (message->FindInt32("opcode", &opcode) == B_OK
+				&& opcode == B_STAT_CHANGED) {
+				UpdateSCMStatus();
+				FileChanged(message);
+			}
+			break;
+		}
+
+		case M_BACKGROUND_COMPILED:
+		{
+			BString path;
+			if (fBackgroundCompiler == NULL
+				|| message->FindString("path", &path) != B_OK)
+				break;
+
+			for (int32 i = 0; i < fProjectList->FullListCountItems(); i++) {
+				SourceFileItem* item = dynamic_cast<SourceFileItem*>(
+					fProjectList->FullListItemAt(i));
+				if (item == NULL
+					|| fBackgroundCompiler->PathOf(item->GetData()) != path)
+					continue;
+
+				item->GetData()->SetBuildFlag(BUILD_NO);
+				item->SetDisplayState(SFITEM_NORMAL);
+				fProjectList->InvalidateItem(fProjectList->IndexOf(item));
+				break;
+			}
+			break;
+		}
+
+		case M_SCM_STATUS_CHANGED:
+		{
+			if (fSCMStatus == NULL)
+				break;
+
+			for (int32 i = 0; i < fProjectList->FullListCountItems(); i++) {
+				SourceFileItem* item = dynamic_cast<SourceFileItem*>(
+					fProjectList->FullListItemAt(i));
+				if (item == NULL || item->GetData() == NULL)
+					continue;
+
+				BString abspath = item->GetData()->GetPath().GetFullPath();
+				if (abspath[0] != '/') {
+					abspath.Prepend("/");
+					abspath.Prepend(fProject->GetPath().GetFolder());
+				}
+
+				int32 state = fSCMStatus->StateFor(abspath.String());
+				if (state != item->GetSCMState()) {
+					item->SetSCMState(state);
+					int32 index = fProjectList->IndexOf(item);
+					if (index >= 0)
+						fProjectList->InvalidateItem(index);
+				}
+			}
+			break;
+		}
+
 		case M_FILE_NEEDS_BUILD:
 		{
 			SourceFile* file;
@@ -984,14 +1133,26 @@ ProjectWindow::MessageReceived(BMessage* message)
 
 		case M_REMOVE_FILES:
 		{
+			// The build works from the project's files, so they have to stay
+			// until it is done
+			if (fBuilder.IsBuilding()) {
+				ShowAlert(B_TRANSLATE("Files can't be removed from the project "
+					"while it is being built."));
+				break;
+			}
+
 			bool save = false;
 			
 			for (int32 i = 0; i < fProjectList->CountItems(); i++) {
 				SourceFileItem* item = dynamic_cast<SourceFileItem*>(
 					fProjectList->ItemAt(i));
 				if (item != NULL && item->IsSelected()) {
+					if (fBackgroundCompiler != NULL)
+						fBackgroundCompiler->FileRemoved(item->GetData());
 					fProjectList->RemoveItem(item);
+					fProject->Lock();
 					fProject->RemoveFile(item->GetData());
+					fProject->Unlock();
 					delete item;
 					save = true;
 					i--;
@@ -1056,6 +1217,51 @@ ProjectWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case M_CHECK_SYNTAX:
+		case M_CHECK_SYNTAX_ALL:
+		{
+			fBuildingFile = 0;
+			DoCheckSyntax(message->what == M_CHECK_SYNTAX_ALL);
+			break;
+		}
+
+		case M_SYNTAX_CHECK_DONE:
+		{
+			SetMenuLock(false);
+
+			int32 total = 0;
+			int32 failed = 0;
+			message->FindInt32("total", &total);
+			message->FindInt32("failed", &failed);
+
+			BString out;
+			if (failed > 0)
+				out = B_TRANSLATE("Syntax errors in %failed% of %total% files.");
+			else
+				out = B_TRANSLATE("No syntax errors in %total% files.");
+			BString number;
+			number << failed;
+			out.ReplaceFirst("%failed%", number.String());
+			number = "";
+			number << total;
+			out.ReplaceFirst("%total%", number.String());
+			SetStatus(out.String());
+			break;
+		}
+
+		case M_STOP_BUILD:
+		{
+			if (!fBuilder.IsBuilding())
+				break;
+
+			SetStatus(B_TRANSLATE("Stopping build"));
+			UpdateIfNeeded();
+			fBuilder.QuitBuild();
+			SetMenuLock(false);
+			SetStatus(B_TRANSLATE("Build stopped."));
+			break;
+		}
+
 		case M_RUN_PROJECT:
 		{
 			DoBuild(POSTBUILD_RUN);
@@ -1120,10 +1326,25 @@ ProjectWindow::MessageReceived(BMessage* message)
 						&& message->FindInt32("total", &total) == B_OK)
 					{
 						fBuildingFile = MAX(fBuildingFile, count);
-						out << "(" << fBuildingFile << "/" << total << ") ";
+						out << "(" << fBuildingFile << "/" << total;
+						
+						// Only there once earlier builds were timed
+						bigtime_t remaining;
+						if (message->FindInt64("remaining", &remaining) == B_OK) {
+							int32 seconds = (int32)(remaining / 1000000) + 1;
+							BString left(B_TRANSLATE("about %time% left"));
+							BString time;
+							time.SetToFormat("%ld:%02ld", seconds / 60, seconds % 60);
+							left.ReplaceFirst("%time%", time.String());
+							out << ", " << left;
+						}
+						out << ") ";
 					}
 
-					out << B_TRANSLATE("Building ") << item->Text();
+					if (message->GetBool("syntaxonly", false))
+						out << B_TRANSLATE("Checking ") << item->Text();
+					else
+						out << B_TRANSLATE("Building ") << item->Text();
 					SetStatus(out.String());
 				}
 			}
@@ -1212,6 +1433,14 @@ ProjectWindow::MessageReceived(BMessage* message)
 			break;
 		}
 
+		case M_SHOW_BUILD_TIMINGS:
+		{
+			BuildTimingsWindow* win = new BuildTimingsWindow(fProject->GetName(),
+				fBuilder.GetTimings());
+			win->Show();
+			break;
+		}
+
 		case M_SYNC_MODULES:
 		{
 #ifdef BUILD_CODE_LIBRARY
@@ -1240,6 +1469,12 @@ ProjectWindow::MessageReceived(BMessage* message)
 			DumpIncludes(fProject);
 			break;
 		}
+
+		case M_DEBUG_TIME_REGEX:
+		{
+			TimeRegex(fProject);
+			break;
+		}
 		
 		case M_SET_STATUS:
 		{
@@ -1299,6 +1534,22 @@ ProjectWindow::MenusBeginning(void)
 	gSettings.Unlock();
 
 	fRecentMenu->SetTargetForItems(be_app);
+
+	BStringList snapshots;
+	ProjectBackup backup(fProject->GetName(), gBackupPath.GetFullPath());
+	backup.GetSnapshots(snapshots);
+	for (int32 i = 0; i < snapshots.CountStrings() && i < 20; i++) {
+		BMessage* restoreMessage = new BMessage(M_RESTORE_BACKUP);
+		restoreMessage->AddString("snapshot", snapshots.StringAt(i));
+		fRestoreMenu->AddItem(new BMenuItem(snapshots.StringAt(i).String(),
+			restoreMessage));
+	}
+
+	if (fRestoreMenu->CountItems() == 0) {
+		BMenuItem* item = new BMenuItem(B_TRANSLATE("No backups"), NULL);
+		item->SetEnabled(false);
+		fRestoreMenu->AddItem(item);
+	}
 }
 
 
@@ -1307,6 +1558,77 @@ ProjectWindow::MenusEnded(void)
 {
 	while (fRecentMenu->ItemAt(0L))
 		delete fRecentMenu->RemoveItem((int32)0);
+
+	while (fRestoreMenu->ItemAt(0L))
+		delete fRestoreMenu->RemoveItem((int32)0);
+}
+
+
+void
+ProjectWindow::WindowActivated(bool active)
+{
+	BWindow::WindowActivated(active);
+
+	// Changes may have been made outside of Paladin, e.g. from a terminal
+	if (active)
+		UpdateSCMStatus();
+}
+
+
+void
+ProjectWindow::UpdateSCMStatus(void)
+{
+	if (fSCMStatus != NULL)
+		fSCMStatus->Refresh();
+}
+
+
+void
+ProjectWindow::WatchFile(const char* path)
+{
+	BEntry entry(path);
+	node_ref nref;
+	if (entry.GetNodeRef(&nref) != B_OK)
+		return;
+
+	std::pair<dev_t, ino_t> key(nref.device, nref.node);
+	if (fWatchedFiles.find(key) != fWatchedFiles.end())
+		return;
+
+	if (watch_node(&nref, B_WATCH_STAT, this) == B_OK)
+		fWatchedFiles[key] = path;
+}
+
+
+void
+ProjectWindow::FileChanged(BMessage* message)
+{
+	if (!gBackgroundBuild)
+		return;
+
+	// Only a change of contents is worth a compile
+	int32 fields;
+	if (message->FindInt32("fields", &fields) == B_OK
+		&& (fields & (B_STAT_MODIFICATION_TIME | B_STAT_SIZE)) == 0)
+		return;
+
+	dev_t device;
+	ino_t node;
+	if (message->FindInt32("device", &device) != B_OK
+		|| message->FindInt64("node", &node) != B_OK)
+		return;
+
+	std::map<std::pair<dev_t, ino_t>, BString>::iterator i
+		= fWatchedFiles.find(std::pair<dev_t, ino_t>(device, node));
+	if (i == fWatchedFiles.end())
+		return;
+
+	if (fBackgroundCompiler == NULL) {
+		fBackgroundCompiler = new BackgroundCompiler(fProject, BMessenger(this));
+		fBackgroundCompiler->SetPaused(fBuilder.IsBuilding());
+	}
+
+	fBackgroundCompiler->FileChanged(i->second.String());
 }
 
 
@@ -1519,6 +1841,9 @@ ProjectWindow::ActOnSelectedFiles(const int32& command)
 			}
 		}
 	}
+
+	if (window != NULL)
+		UpdateSCMStatus();
 }
 
 
@@ -1642,10 +1967,20 @@ ProjectWindow::CreateMenuBar()
 		new BMessage(M_RUN_IN_TERMINAL), 'R', B_COMMAND_KEY | B_SHIFT_KEY));
 	fBuildMenu->AddItem(new BMenuItem(B_TRANSLATE("Debug"), new BMessage(M_DEBUG_PROJECT),
 		'R', B_COMMAND_KEY | B_CONTROL_KEY));
+	fBuildMenu->AddItem(new BMenuItem(B_TRANSLATE("Check syntax"),
+		new BMessage(M_CHECK_SYNTAX), 'K'));
+	fBuildMenu->AddItem(new BMenuItem(B_TRANSLATE("Check syntax of all files"),
+		new BMessage(M_CHECK_SYNTAX_ALL), 'K', B_COMMAND_KEY | B_SHIFT_KEY));
+	fStopBuildItem = new BMenuItem(B_TRANSLATE("Stop build"),
+		new BMessage(M_STOP_BUILD), '.');
+	fStopBuildItem->SetEnabled(false);
+	fBuildMenu->AddItem(fStopBuildItem);
 	fBuildMenu->AddSeparatorItem();
 	BString genMakefileStr(B_TRANSLATE("Generate makefile"));
 	fBuildMenu->AddItem(new BMenuItem(genMakefileStr,
 		new BMessage(M_MAKE_MAKE)));
+	fBuildMenu->AddItem(new BMenuItem(B_TRANSLATE("Generate Ninja build file"),
+		new BMessage(M_MAKE_NINJA)));
 	fBuildMenu->AddSeparatorItem();
 	BString setArgsStr(B_TRANSLATE("Set run arguments" B_UTF8_ELLIPSIS));
 	fBuildMenu->AddItem(new BMenuItem(setArgsStr,
@@ -1661,6 +1996,10 @@ ProjectWindow::CreateMenuBar()
 
 	fBuildMenu->AddItem(new BMenuItem(B_TRANSLATE("Force project to rebuild"),
 		new BMessage(M_FORCE_REBUILD), '-'));
+	fBuildMenu->AddSeparatorItem();
+	BString buildTimingsStr(B_TRANSLATE("Show build timings" B_UTF8_ELLIPSIS));
+	fBuildMenu->AddItem(new BMenuItem(buildTimingsStr,
+		new BMessage(M_SHOW_BUILD_TIMINGS)));
 	fMenuBar->AddItem(fBuildMenu);
 
 	// Tools menu
@@ -1689,6 +2028,8 @@ ProjectWindow::CreateMenuBar()
 	fToolsMenu->AddSeparatorItem();
 	fToolsMenu->AddItem(new BMenuItem(B_TRANSLATE("Backup project"),
 		new BMessage(M_BACKUP_PROJECT)));
+	fRestoreMenu = new BMenu(B_TRANSLATE("Restore backup"));
+	fToolsMenu->AddItem(fRestoreMenu);
 	fToolsMenu->AddSeparatorItem();
 	BString licenseStr(B_TRANSLATE("Set software license" B_UTF8_ELLIPSIS));
 	fToolsMenu->AddItem(new BMenuItem(licenseStr,
@@ -1699,13 +2040,22 @@ ProjectWindow::CreateMenuBar()
 void
 ProjectWindow::SetMenuLock(bool locked)
 {
-	if (locked) {
-		fProjectMenu->SetEnabled(false);
-		fBuildMenu->SetEnabled(false);
-	} else {
-		fProjectMenu->SetEnabled(true);
-		fBuildMenu->SetEnabled(true);
+	fProjectMenu->SetEnabled(!locked);
+
+	// The build menu itself stays enabled so that a build can be stopped
+	for (int32 i = 0; i < fBuildMenu->CountItems(); i++) {
+		BMenuItem* item = fBuildMenu->ItemAt(i);
+		if (item == fStopBuildItem)
+			item->SetEnabled(locked && fBuilder.IsBuilding());
+		else if (item->Message() != NULL
+			&& item->Message()->what == M_EMPTY_CCACHE)
+			item->SetEnabled(!locked && gCCacheAvailable);
+		else
+			item->SetEnabled(!locked);
 	}
+
+	if (fBackgroundCompiler != NULL)
+		fBackgroundCompiler->SetPaused(locked);
 }
 
 
@@ -1870,6 +2220,8 @@ ProjectWindow::ToggleDebugMenu(void)
 			new BMessage(M_DEBUG_DUMP_DEPENDENCIES)));
 		debug->AddItem(new BMenuItem("Dump includes",
 			new BMessage(M_DEBUG_DUMP_INCLUDES)));
+		debug->AddItem(new BMenuItem("Time regular expressions",
+			new BMessage(M_DEBUG_TIME_REGEX)));
 		fMenuBar->AddItem(debug);
 	}
 }
@@ -1897,8 +2249,26 @@ ProjectWindow::DoBuild(int32 postbuild)
 	SetStatus(B_TRANSLATE("Examining source files"));
 	UpdateIfNeeded();
 
-	SetMenuLock(true);
+	gStatCache.MakeEmpty();
 	fBuilder.BuildProject(fProject,postbuild);
+	SetMenuLock(true);
+}
+
+
+void
+ProjectWindow::DoCheckSyntax(bool allFiles)
+{
+	if (fErrorWindow != NULL)
+		fErrorWindow->PostMessage(M_CLEAR_ERROR_LIST);
+
+	fProject->GetErrorList()->msglist.MakeEmpty();
+
+	SetStatus(B_TRANSLATE("Examining source files"));
+	UpdateIfNeeded();
+
+	gStatCache.MakeEmpty();
+	fBuilder.CheckSyntax(fProject, allFiles);
+	SetMenuLock(true);
 }
 
 
@@ -1983,80 +2353,69 @@ ProjectWindow::AddFileThread(void* data)
 void
 ProjectWindow::AddFolder(entry_ref folderRef)
 {
-	BDirectory directory;
-	if (directory.SetTo(&folderRef) != B_OK)
+	// The whole tree is read before anything is locked, and the files are
+	// then added in one go so that a big tree doesn't cost a list update
+	// and a project save for every file.
+	FolderScanner scanner;
+	BStringList paths;
+	if (scanner.Scan(folderRef, paths) != B_OK || paths.IsEmpty())
 		return;
 
-	if (strcmp(folderRef.name,"CVS") == 0
-		|| strcmp(folderRef.name,".svn") == 0
-		|| strcmp(folderRef.name,".git") == 0
-		|| strcmp(folderRef.name,".hg") == 0) {
-		return;
-	}
-
-	directory.Rewind();
+	fProject->Lock();
+	Lock();
 
-	entry_ref ref;
-	while (directory.GetNextRef(&ref) == B_OK) {
-		if (BEntry(&ref).IsDirectory())
-			AddFolder(ref);
-		else {
-			// Here is where we actually add the file to the project.
-			//
-			// The name of the folder containing the file will be the name
-			// of the file's group. If the group doesn't exist, it will be
-			// created at the end of the list, but if it does, we will fake
-			// a drop onto the group item to reuse the code path by finding
-			// the group and getting its position in the list.
-			DPath filepath(ref);
-			if (!filepath.GetExtension() // likely to be a compiled binary
-				|| !(strcmp(filepath.GetExtension(),"cpp") == 0
-					|| strcmp(filepath.GetExtension(),"c") == 0
-					|| strcmp(filepath.GetExtension(),"cc") == 0
-					|| strcmp(filepath.GetExtension(),"cxx") == 0
-					|| strcmp(filepath.GetExtension(),"rdef") == 0
-					|| strcmp(filepath.GetExtension(),"rsrc") == 0) ) {
-				continue;
-			}
-
-			// don't bother adding build files from other systems
-			if (strcmp(filepath.GetFileName(), "Jamfile") == 0
-				|| strcmp(filepath.GetFileName(), "Makefile") == 0) {
-				continue;
-			}
+	// Objects are named after their source files, so the project doesn't
+	// take two files with the same name
+	std::set<BString> names;
+	for (int32 i = 0; i < fProject->CountGroups(); i++) {
+		SourceGroup* group = fProject->GroupAt(i);
+		for (int32 j = 0; j < group->filelist.CountItems(); j++) {
+			const char* name = group->filelist.ItemAt(j)->GetPathHandle().FileName();
+			if (name != NULL)
+				names.insert(name);
+		}
+	}
 
-			DPath parent(filepath.GetFolder());
-			SourceGroup* group = NULL;
-			SourceGroupItem* groupItem = NULL;
+	// The name of the folder containing a file is the name of its group
+	typedef std::map<BString, BObjectList<SourceFile>*> GroupFileMap;
+	GroupFileMap groupFiles;
+	int32 added = 0;
+	for (int32 i = 0; i < paths.CountStrings(); i++) {
+		DPath filepath(paths.StringAt(i));
+		if (!names.insert(filepath.GetFileName()).second) {
+			STRACE(1, ("%s is already part of the project\n",
+				filepath.GetFullPath()));
+			continue;
+		}
 
-			fProject->Lock();
-			group = fProject->FindGroup(parent.GetFileName());
+		DPath parent(filepath.GetFolder());
+		BObjectList<SourceFile>*& files = groupFiles[parent.GetFileName()];
+		if (files == NULL)
+			files = new BObjectList<SourceFile>(20, false);
 
-			Lock();
+		files->AddItem(gFileFactory.CreateSourceFileItem(filepath.GetFullPath()));
+		added++;
+	}
 
-			if (group != NULL)
-				groupItem = fProjectList->ItemForGroup(group);
-			else {
-				group = fProject->AddGroup(parent.GetFileName());
-				groupItem = new SourceGroupItem(group);
-				fProjectList->AddItem(groupItem);
-				UpdateIfNeeded();
-			}
+	for (GroupFileMap::iterator i = groupFiles.begin(); i != groupFiles.end();
+			i++) {
+		SourceGroup* group = fProject->FindGroup(i->first.String());
+		if (group == NULL)
+			group = fProject->AddGroup(i->first.String());
 
-			if (groupItem != NULL) {
-				int32 index = fProjectList->IndexOf(groupItem);
-				BPoint where = fProjectList->ItemFrame(index).LeftTop();
-				where.x += 5;
-				where.y += 5;
+		fProject->AddFiles(*i->second, group);
+		delete i->second;
+	}
 
-				AddFile(ref,&where);
-			}
+	if (added > 0) {
+		UpdateProjectList();
+		fProject->Save();
+	}
 
-			Unlock();
+	Unlock();
+	fProject->Unlock();
 
-			fProject->Unlock();
-		}
-	}
+	STRACE(1, ("Added %ld files from %s\n", (long)added, folderRef.name));
 }
 
 
@@ -2117,28 +2476,26 @@ ProjectWindow::BackupThread(void* data)
 	ProjectWindow* parent = (ProjectWindow*)data;
 	Project* project = parent->fProject;
 
-	char timestamp[32];
-	time_t t = real_time_clock();
-	strftime(timestamp, 32, "_%Y-%m-%d-%H%M%S", localtime(&t));
-
 	BPath folder(project->GetPath().GetFolder());
-	BPath folderparent;
-	folder.GetParent(&folderparent);
-	
+
 	STRACE(2,("Creating folder: %s\n", gBackupPath.GetFullPath()));
 	// ensure folder exists first
 	status_t status = create_directory(gBackupPath.GetFullPath(), 0777);
 	STRACE(2,(" - Successful?: %i\n", status));
 
-	BString command = "cd '";
-	command << folderparent.Path() << "'; zip -9 -r -y '"
-		<< gBackupPath.GetFullPath() << "/"
-		<< project->GetName() << timestamp << "' '"
-		<< folder.Leaf() << "' -x *.o";
-
-	system(command.String());
+	// Only what changed since the last backup is stored
+	ProjectBackup backup(project->GetName(), gBackupPath.GetFullPath());
+	if (status == B_OK)
+		status = backup.Backup(folder.Path());
 
 	parent->Lock();
+	if (status == B_OK)
+		parent->SetStatus(B_TRANSLATE("Project backed up."));
+	else {
+		BString errorText(B_TRANSLATE("Couldn't back up the project: %error%"));
+		errorText.ReplaceFirst("%error%", strerror(status));
+		parent->SetStatus(errorText.String());
+	}
 	parent->SetMenuLock(false);
 	parent->Unlock();
 
@@ -2146,6 +2503,40 @@ ProjectWindow::BackupThread(void* data)
 }
 
 
+int32
+ProjectWindow::RestoreThread(void* data)
+{
+	restore_data* restore = (restore_data*)data;
+	ProjectWindow* parent = restore->parent;
+
+	// A backup is never restored over the project itself
+	BString destination(gBackupPath.GetFullPath());
+	destination << "/" << parent->fProject->GetName() << "_"
+		<< restore->snapshot;
+
+	ProjectBackup backup(parent->fProject->GetName(),
+		gBackupPath.GetFullPath());
+	status_t status = backup.Restore(restore->snapshot.String(),
+		destination.String());
+
+	BString statusText;
+	if (status == B_OK) {
+		statusText = B_TRANSLATE("Backup restored to %path%.");
+		statusText.ReplaceFirst("%path%", destination.String());
+	} else {
+		statusText = B_TRANSLATE("Couldn't restore the backup: %error%");
+		statusText.ReplaceFirst("%error%", strerror(status));
+	}
+
+	parent->Lock();
+	parent->SetStatus(statusText.String());
+	parent->Unlock();
+
+	delete restore;
+	return 0;
+}
+
+
 int32
 ProjectWindow::SyncThread(void* data)
 {
@@ -16,18 +16,23 @@
 #include <MenuBar.h>
 #include <Menu.h>
 #include <Message.h>
+#include <String.h>
 #include <StringView.h>
 #include <Window.h>
 
+#include <map>
+
 #include "ProjectBuilder.h"
 #include "ProjectStatus.h"
 #include "ProjectSettingsWindow.h"
 
+class BackgroundCompiler;
 class ErrorWindow;
 class ProjectList;
 class Project;
 class ProjectWindow;
 class ProjectStatus;
+class SCMStatusCache;
 class SourceControl;
 class SourceFile;
 class PrefsWindow;
@@ -49,6 +54,7 @@ public:
 	virtual	void				MessageReceived(BMessage *message);
 	virtual	void				MenusBeginning(void);
 	virtual	void				MenusEnded(void);
+	virtual	void				WindowActivated(bool active);
 	virtual	void				AddFile(const entry_ref &ref, BPoint* where = NULL);
 			Project*			GetProject(void) const { return fProject; }
 
@@ -66,15 +72,20 @@ private:
 			void				SortGroup(int32 selection);
 			void				UpdateProjectList(void);
 			void				UpdateDependencies(void);
+			void				UpdateSCMStatus(void);
+			void				WatchFile(const char* path);
+			void				FileChanged(BMessage* message);
 			void				ToggleDebugMenu(void);
 
 			void				DoBuild(int32 postbuild);
+			void				DoCheckSyntax(bool allFiles);
 			void				AddNewFile(BString name, bool createPair);
 	static	int32				AddFileThread(void* data);
 			void				AddFolder(entry_ref folderref);
 			void				ImportFile(entry_ref ref);
 	static	int32				ImportFileThread(void* data);
 	static	int32				BackupThread(void* data);
+	static	int32				RestoreThread(void* data);
 	static	int32				SyncThread(void* data);
 	
 			void				SetStatus(const char* msg);
@@ -85,15 +96,22 @@ private:
 			BMenu*				fFileMenu;
 			BMenu*				fProjectMenu;
 			BMenu*				fBuildMenu;
+			BMenuItem*			fStopBuildItem;
 			BMenu*				fToolsMenu;
 			BMenu*				fSourceMenu;
 			BMenu*				fRecentMenu;
+			BMenu*				fRestoreMenu;
 
 			ProjectList*		fProjectList;
 			ProjectStatus*		fStatusBar;
 			BFilePanel*			fFilePanel;
 			Project*			fProject;
 			SourceControl*		fSourceControl;
+			SCMStatusCache*		fSCMStatus;
+			BackgroundCompiler*	fBackgroundCompiler;
+
+			// Paths of the watched files, by device and node
+			std::map<std::pair<dev_t, ino_t>, BString>	fWatchedFiles;
 			ProjectSettingsWindow*	fProjectSettingsWindow;
 
 			bool				fShowingLibs;
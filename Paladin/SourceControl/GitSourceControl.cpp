@@ -1,9 +1,11 @@
 #include "GitSourceControl.h"
 
 #include <Path.h>
+#include <StringList.h>
 #include <stdio.h>
 
 #include "../DebugTools.h"
+#include "../Globals.h"
 
 GitSourceControl::GitSourceControl(void)
 {
@@ -112,7 +114,7 @@ GitSourceControl::CloneRepository(const char *url, const char *dest)
 		return B_BAD_DATA;
 	
 	BString command;
-	command << "git clone ";
+	command << "git clone --progress ";
 	
 	if (GetVerboseMode())
 		command << "-v ";
@@ -199,7 +201,7 @@ GitSourceControl::Push(const char *url)
 		SetURL(url);
 	
 	BString command;
-	command << "cd '" << GetWorkingDirectory() << "'; git push --all ";
+	command << "cd '" << GetWorkingDirectory() << "'; git push --all --progress ";
 	
 	if (GetVerboseMode())
 		command << "-v ";
@@ -219,7 +221,7 @@ GitSourceControl::Pull(const char *url)
 		SetURL(url);
 	
 	BString command;
-	command << "cd '" << GetWorkingDirectory() << "'; git pull ";
+	command << "cd '" << GetWorkingDirectory() << "'; git pull --progress ";
 	
 	if (GetVerboseMode())
 		command << "-v ";
@@ -334,6 +336,103 @@ GitSourceControl::GetChangeStatus(BString &out)
 }
 
 
+// Undoes the C-style quoting git uses for paths with unusual characters in
+// them. Octal escapes are not expected because quotepath is turned off.
+static BString
+unquote_git_path(const BString &path)
+{
+	if (path.CountChars() < 2 || path[0] != '"' || path[path.Length() - 1] != '"')
+		return path;
+	
+	BString out;
+	for (int32 i = 1; i < path.Length() - 1; i++)
+	{
+		char c = path[i];
+		if (c == '\\' && i + 1 < path.Length() - 1)
+		{
+			i++;
+			switch (path[i])
+			{
+				case 'n':
+					c = '\n';
+					break;
+				case 't':
+					c = '\t';
+					break;
+				default:
+					c = path[i];
+					break;
+			}
+		}
+		out += c;
+	}
+	return out;
+}
+
+
+status_t
+GitSourceControl::GetFileStatus(SCMStatusMap &out)
+{
+	out.clear();
+	
+	// Porcelain paths are relative to the top of the repository, which isn't
+	// necessarily the project folder, so ask for it first.
+	BString command;
+	command << "cd '" << GetWorkingDirectory() << "' && git rev-parse --show-toplevel "
+			<< "&& git -c core.quotepath=off status --porcelain --untracked-files=all";
+	
+	BString output;
+	RunPipedCommand(command.String(), output, false);
+	
+	BStringList lines;
+	output.Split("\n", true, lines);
+	if (lines.CountStrings() < 1 || lines.StringAt(0)[0] != '/')
+		return B_ERROR;
+	
+	BString root(lines.StringAt(0));
+	root << "/";
+	
+	for (int32 i = 1; i < lines.CountStrings(); i++)
+	{
+		BString line(lines.StringAt(i));
+		if (line.Length() < 4)
+			continue;
+		
+		char x = line[0];
+		char y = line[1];
+		
+		int32 state;
+		if (x == '!')
+			continue;
+		else if (x == '?')
+			state = SCM_FILE_UNTRACKED;
+		else if (x == 'U' || y == 'U' || (x == 'A' && y == 'A') || (x == 'D' && y == 'D'))
+			state = SCM_FILE_CONFLICTED;
+		else if (x == 'A')
+			state = SCM_FILE_ADDED;
+		else if (x == 'D' || y == 'D')
+			state = SCM_FILE_REMOVED;
+		else
+			state = SCM_FILE_MODIFIED;
+		
+		// Renames are listed as "old -> new". Only the new name matters here.
+		BString path;
+		line.CopyInto(path, 3, line.Length() - 3);
+		int32 arrow = path.FindFirst(" -> ");
+		if (arrow >= 0 && (x == 'R' || x == 'C'))
+			path.Remove(0, arrow + 4);
+		
+		BString fullPath(root);
+		fullPath << unquote_git_path(path);
+		out[fullPath] = state;
+	}
+	
+	STRACE(2,("git: %ld files with changes in %s\n", (long)out.size(),
+			GetWorkingDirectory()));
+	return B_OK;
+}
+
+
 status_t
 GitSourceControl::GetCheckinHeader(BString &out)
 {
@@ -33,6 +33,7 @@ public:
 	virtual	status_t		Diff(const char *filename, const char *revision);
 	virtual	status_t		GetHistory(BString &out, const char *file);
 	virtual	status_t		GetChangeStatus(BString &out);
+	virtual	status_t		GetFileStatus(SCMStatusMap &out);
 	virtual status_t		GetCheckinHeader(BString &out);
 
 };
@@ -2,10 +2,15 @@
 
 #include <Directory.h>
 #include <Path.h>
+#include <StringList.h>
 #include <stdio.h>
 
+#include "../Globals.h"
 #include "LaunchHelper.h"
 
+// hg only shows its progress bar on a terminal unless told otherwise
+#define HG_PROGRESS_OPTIONS "--config progress.assume-tty=1 --config progress.delay=0 "
+
 HgSourceControl::HgSourceControl(void)
 {
 	SetShortName("hg");
@@ -118,7 +123,7 @@ HgSourceControl::CloneRepository(const char *url, const char *dest)
 	if (GetVerboseMode())
 		command << "-v ";
 	
-	command << "clone '" << url << "' '" << dest << "'";
+	command << HG_PROGRESS_OPTIONS << "clone '" << url << "' '" << dest << "'";
 	
 	BString out;
 	RunCommand(command, out);
@@ -216,7 +221,7 @@ HgSourceControl::Push(const char *url)
 	if (GetVerboseMode())
 		command << "-v ";
 	
-	command	<< "push '" << GetURL() << "'";
+	command	<< HG_PROGRESS_OPTIONS << "push '" << GetURL() << "'";
 	
 	BString out;
 	return (RunCommand(command, out) == 0) ? B_OK : B_ERROR;
@@ -235,7 +240,7 @@ HgSourceControl::Pull(const char *url)
 	if (GetVerboseMode())
 		command << "-v ";
 	
-	command	<< "pull -u '" << GetURL() << "'";
+	command	<< HG_PROGRESS_OPTIONS << "pull -u '" << GetURL() << "'";
 	
 	BString out;
 	return (RunCommand(command, out) == 0) ? B_OK : B_ERROR;
@@ -370,6 +375,60 @@ HgSourceControl::GetChangeStatus(BString &out)
 }
 
 
+status_t
+HgSourceControl::GetFileStatus(SCMStatusMap &out)
+{
+	out.clear();
+	
+	BString command;
+	command << "cd '" << GetWorkingDirectory() << "' && hg root && hg status";
+	
+	BString output;
+	RunPipedCommand(command.String(), output, false);
+	
+	BStringList lines;
+	output.Split("\n", true, lines);
+	if (lines.CountStrings() < 1 || lines.StringAt(0)[0] != '/')
+		return B_ERROR;
+	
+	// hg status paths are relative to the root of the repository
+	BString root(lines.StringAt(0));
+	root << "/";
+	
+	for (int32 i = 1; i < lines.CountStrings(); i++)
+	{
+		BString line(lines.StringAt(i));
+		if (line.Length() < 3)
+			continue;
+		
+		int32 state;
+		switch (line[0])
+		{
+			case 'M':
+				state = SCM_FILE_MODIFIED;
+				break;
+			case 'A':
+				state = SCM_FILE_ADDED;
+				break;
+			case 'R':
+			case '!':
+				state = SCM_FILE_REMOVED;
+				break;
+			case '?':
+				state = SCM_FILE_UNTRACKED;
+				break;
+			default:
+				continue;
+		}
+		
+		BString fullPath(root);
+		fullPath << (line.String() + 2);
+		out[fullPath] = state;
+	}
+	return B_OK;
+}
+
+
 status_t
 HgSourceControl::GetCheckinHeader(BString &out)
 {
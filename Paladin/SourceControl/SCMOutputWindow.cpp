@@ -5,13 +5,21 @@
 #include <LayoutBuilder.h>
 #include <ScrollView.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <String.h>
+#include <string.h>
+
+#include "SourceControl.h"
 
 
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "SCMOutputWindow"
 
 #define M_APPEND_TO_LOG 'matl'
+#define M_STOP_COMMAND 'stcm'
+
+// Older output is dropped once the log grows past this
+#define MAX_LOG_LENGTH (1024 * 1024)
 
 SCMOutputWindow::SCMOutputWindow(const char *title)
   :	DWindow(BRect(0,0,400,300), title)
@@ -21,15 +29,26 @@ SCMOutputWindow::SCMOutputWindow(const char *title)
 	
 	fClose = new BButton("close", B_TRANSLATE("Close"),
 						new BMessage(B_QUIT_REQUESTED));
+	fStop = new BButton("stop", B_TRANSLATE("Stop"),
+						new BMessage(M_STOP_COMMAND));
 	fLog = new BTextView("log");
+	fLog->MakeEditable(false);
 	BScrollView *sv = new BScrollView("scrollview", fLog, 0,
 									false, true);
+	fProgress = new BStatusBar("progress");
+	fProgress->Hide();
+	
 	BLayoutBuilder::Grid<>(this, B_USE_HALF_ITEM_SPACING)
 		/* column, row, columnSpan, rowSpan */
 		.SetInsets(0)
 		.Add(sv, 0, 0, 3, 1)
-		.Add(fClose, 1, 1);
+		.Add(fProgress, 0, 1, 3, 1)
+		.Add(fStop, 0, 2)
+		.Add(fClose, 2, 2);
 	fClose->MakeDefault(true);
+	
+	fLineStart = 0;
+	fOverwriteLine = false;
 }
 
 
@@ -52,7 +71,12 @@ SCMOutputWindow::MessageReceived(BMessage *msg)
 		{
 			BString text;
 			if (msg->FindString("text", &text) == B_OK)
-				fLog->Insert(text.String());
+				AppendText(text.String());
+			break;
+		}
+		case M_STOP_COMMAND:
+		{
+			SourceControl::StopCommands();
 			break;
 		}
 		default:
@@ -71,6 +95,89 @@ SCMOutputWindow::GetTextView(void)
 }
 
 
+void
+SCMOutputWindow::AppendText(const char *text)
+{
+	// Progress meters redraw their line by ending it with \r instead of \n,
+	// so each \r line replaces the one before it instead of piling up.
+	BString progressLine;
+	const char *start = text;
+	while (*start)
+	{
+		const char *end = start + strcspn(start, "\r\n");
+		
+		if (fOverwriteLine && end > start)
+		{
+			fLog->Delete(fLineStart, fLog->TextLength());
+			fOverwriteLine = false;
+		}
+		
+		fLog->Insert(fLog->TextLength(), start, end - start);
+		
+		if (*end == '\r' && end[1] != '\n')
+		{
+			progressLine.SetTo(fLog->Text() + fLineStart,
+								fLog->TextLength() - fLineStart);
+			fOverwriteLine = true;
+			end++;
+		}
+		else if (*end)
+		{
+			if (*end == '\r')
+				end++;
+			fLog->Insert(fLog->TextLength(), "\n", 1);
+			fLineStart = fLog->TextLength();
+			end++;
+		}
+		start = end;
+	}
+	
+	if (fLog->TextLength() > MAX_LOG_LENGTH)
+	{
+		const char *log = fLog->Text();
+		int32 cut = fLog->TextLength() - MAX_LOG_LENGTH;
+		while (cut < fLineStart && log[cut - 1] != '\n')
+			cut++;
+		if (cut > fLineStart)
+			cut = fLineStart;
+		fLog->Delete(0, cut);
+		fLineStart -= cut;
+	}
+	
+	if (progressLine.CountChars() > 0)
+		UpdateProgress(progressLine);
+	
+	fLog->ScrollToOffset(fLog->TextLength());
+}
+
+
+void
+SCMOutputWindow::UpdateProgress(const BString &line)
+{
+	// git and hg both show how far along they are as a percentage
+	int32 percent = line.FindLast('%');
+	if (percent < 1)
+		return;
+	
+	int32 digits = percent;
+	while (digits > 0 && line[digits - 1] >= '0' && line[digits - 1] <= '9')
+		digits--;
+	if (digits == percent)
+		return;
+	
+	BString label(line);
+	int32 colon = label.FindFirst(':');
+	if (colon > 0)
+		label.Truncate(colon);
+	label.Trim();
+	
+	if (fProgress->IsHidden())
+		fProgress->Show();
+	
+	fProgress->SetTo(atoi(line.String() + digits), label.String());
+}
+
+
 void
 SCMOutputCallback(const char *text)
 {
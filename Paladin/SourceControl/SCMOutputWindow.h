@@ -2,6 +2,7 @@
 #define SCMOUTPUTWINDOW_H
 
 #include <Button.h>
+#include <StatusBar.h>
 
 #include "DWindow.h"
 #include "TextView.h"
@@ -16,8 +17,17 @@ public:
 	BTextView *	GetTextView(void);
 	
 private:
+	void		AppendText(const char *text);
+	void		UpdateProgress(const BString &line);
+	
 	BTextView	*fLog;
-	BButton		*fClose;
+	BStatusBar	*fProgress;
+	BButton		*fStop,
+				*fClose;
+	
+	// Start of the line a progress meter is redrawing with \r
+	int32		fLineStart;
+	bool		fOverwriteLine;
 };
 
 
@@ -0,0 +1,113 @@
+#include "SCMStatusCache.h"
+
+#include <Autolock.h>
+#include <string.h>
+
+#include "../DebugTools.h"
+
+SCMStatusCache::SCMStatusCache(SourceControl *scm, const BMessenger &target)
+  :	fSCM(scm),
+	fTarget(target),
+	fLock("scm status cache"),
+	fThread(-1),
+	fPending(false),
+	fQuitting(false)
+{
+}
+
+
+SCMStatusCache::~SCMStatusCache(void)
+{
+	fLock.Lock();
+	fQuitting = true;
+	thread_id thread = fThread;
+	fLock.Unlock();
+	
+	if (thread >= 0)
+	{
+		status_t result;
+		wait_for_thread(thread, &result);
+	}
+}
+
+
+void
+SCMStatusCache::Refresh(void)
+{
+	BAutolock lock(fLock);
+	if (!fSCM || fQuitting)
+		return;
+	
+	if (fThread >= 0)
+	{
+		fPending = true;
+		return;
+	}
+	
+	fThread = spawn_thread(RefreshThread, "scm status", B_LOW_PRIORITY, this);
+	if (fThread < 0 || resume_thread(fThread) != B_OK)
+		fThread = -1;
+}
+
+
+int32
+SCMStatusCache::StateFor(const char *path) const
+{
+	if (!path)
+		return SCM_FILE_CLEAN;
+	
+	BAutolock lock(fLock);
+	SCMStatusMap::const_iterator i = fStates.find(BString(path));
+	return (i == fStates.end()) ? SCM_FILE_CLEAN : i->second;
+}
+
+
+int32
+SCMStatusCache::RefreshThread(void *data)
+{
+	SCMStatusCache *cache = (SCMStatusCache*)data;
+	
+	bool again = true;
+	while (again)
+	{
+		SCMStatusMap states;
+		status_t status = cache->fSCM->GetFileStatus(states);
+		if (status != B_OK)
+			STRACE(1,("Couldn't get SCM file status: %s\n", strerror(status)));
+		
+		bool changed = false;
+		
+		cache->fLock.Lock();
+		if (cache->fQuitting)
+		{
+			cache->fLock.Unlock();
+			break;
+		}
+		
+		if (status == B_OK && states != cache->fStates)
+		{
+			cache->fStates.swap(states);
+			changed = true;
+		}
+		
+		// Once fThread is cleared the cache may be deleted at any time, so
+		// nothing in it is touched after unlocking.
+		BMessenger target(cache->fTarget);
+		again = cache->fPending;
+		cache->fPending = false;
+		if (!again)
+			cache->fThread = -1;
+		cache->fLock.Unlock();
+		
+		// Not sent while locked because the window looks up states while
+		// handling it. The timeout keeps a busy window from stalling
+		// the cache's destructor.
+		if (changed)
+		{
+			BMessage msg(M_SCM_STATUS_CHANGED);
+			target.SendMessage(&msg, (BHandler*)NULL, 500000);
+		}
+	}
+	
+	return 0;
+}
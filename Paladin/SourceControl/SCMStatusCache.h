@@ -0,0 +1,44 @@
+#ifndef SCMSTATUSCACHE_H
+#define SCMSTATUSCACHE_H
+
+#include <Locker.h>
+#include <Messenger.h>
+#include <OS.h>
+
+#include "SourceControl.h"
+
+enum
+{
+	M_SCM_STATUS_CHANGED = 'scsc'
+};
+
+// Keeps the source control state of a project's files so that the project
+// list can show it without waiting on the SCM tool. Refreshing happens in a
+// thread of its own, one status command at a time. Requests which come in
+// while one is running are folded into a single follow-up run. Whenever the
+// states change, M_SCM_STATUS_CHANGED is sent to the target.
+class SCMStatusCache
+{
+public:
+							SCMStatusCache(SourceControl *scm,
+											const BMessenger &target);
+							~SCMStatusCache(void);
+	
+			void			Refresh(void);
+	
+			// Returns one of the SCM_FILE_* states for an absolute path
+			int32			StateFor(const char *path) const;
+	
+private:
+	static	int32			RefreshThread(void *data);
+	
+			SourceControl	*fSCM;
+			BMessenger		fTarget;
+	mutable	BLocker			fLock;
+			SCMStatusMap	fStates;
+			thread_id		fThread;
+			bool			fPending;
+			bool			fQuitting;
+};
+
+#endif
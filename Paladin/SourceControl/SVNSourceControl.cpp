@@ -1,7 +1,9 @@
 #include "SVNSourceControl.h"
 #include <Directory.h>
 #include <Path.h>
+#include <StringList.h>
 
+#include "../Globals.h"
 #include "DPath.h"
 
 static BString sRepoPath = "/boot/home/projects/Paladin SVN Repos";
@@ -251,6 +253,60 @@ SVNSourceControl::GetChangeStatus(BString &out)
 }
 
 
+status_t
+SVNSourceControl::GetFileStatus(SCMStatusMap &out)
+{
+	out.clear();
+	
+	BString command;
+	command << "svn status --non-interactive '" << GetWorkingDirectory() << "'";
+	
+	BString output;
+	RunPipedCommand(command.String(), output, false);
+	
+	BStringList lines;
+	output.Split("\n", true, lines);
+	for (int32 i = 0; i < lines.CountStrings(); i++)
+	{
+		// The first seven columns are status flags and the path starts
+		// at the eighth. Lines with anything else in them are summaries.
+		BString line(lines.StringAt(i));
+		if (line.Length() < 9 || line[7] != ' ')
+			continue;
+		
+		int32 state;
+		switch (line[0])
+		{
+			case 'M':
+			case 'R':
+				state = SCM_FILE_MODIFIED;
+				break;
+			case 'A':
+				state = SCM_FILE_ADDED;
+				break;
+			case 'D':
+			case '!':
+				state = SCM_FILE_REMOVED;
+				break;
+			case '?':
+				state = SCM_FILE_UNTRACKED;
+				break;
+			case 'C':
+				state = SCM_FILE_CONFLICTED;
+				break;
+			default:
+				continue;
+		}
+		
+		BString path(line.String() + 8);
+		if (path[0] != '/')
+			path.Prepend("/").Prepend(GetWorkingDirectory());
+		out[path] = state;
+	}
+	return B_OK;
+}
+
+
 status_t
 SVNSourceControl::GetHistory(BString &out, const char *file)
 {
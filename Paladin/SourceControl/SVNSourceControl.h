@@ -30,6 +30,7 @@ public:
 			status_t		Revert(const char *relPath);
 			status_t		Diff(const char *filename, const char *revision = NULL);
 			status_t		GetChangeStatus(BString &out);
+			status_t		GetFileStatus(SCMStatusMap &out);
 			status_t		GetHistory(BString &out, const char *file);
 			status_t		GetCheckinHeader(BString &out);
 	
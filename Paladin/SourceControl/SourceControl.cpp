@@ -5,6 +5,7 @@
 #include <Catalog.h>
 #include <Locale.h>
 
+#include "../BuildSystem/CommandRunner.h"
 #include "../DebugTools.h"
 #include "../Globals.h"
 
@@ -12,6 +13,79 @@
 #undef B_TRANSLATION_CONTEXT
 #define B_TRANSLATION_CONTEXT "SourceControl"
 
+// Output is passed on at least this often while a command is running...
+#define OUTPUT_FLUSH_INTERVAL 100000
+
+// ...or once this much of it has piled up
+#define OUTPUT_FLUSH_SIZE 16384
+
+typedef struct
+{
+	SourceControlCallback	callback;
+	BString					pending;
+	bigtime_t				lastFlush;
+} output_stream;
+
+static int32 sRunningCommands = 0;
+
+
+static CommandGroup &
+command_group(void)
+{
+	static CommandGroup sGroup;
+	return sGroup;
+}
+
+
+static void
+flush_output(output_stream *stream, bool all)
+{
+	int32 length = stream->pending.Length();
+	if (!all)
+	{
+		// Send whole lines when possible. Progress meters end theirs with \r.
+		int32 lineEnd = length - 1;
+		while (lineEnd >= 0 && stream->pending[lineEnd] != '\n'
+				&& stream->pending[lineEnd] != '\r')
+			lineEnd--;
+		
+		if (lineEnd >= 0)
+			length = lineEnd + 1;
+		else if (length >= OUTPUT_FLUSH_SIZE)
+		{
+			// A very long line. Don't split a UTF-8 character, though.
+			while (length > 0 && (stream->pending[length - 1] & 0xC0) == 0x80)
+				length--;
+			if (length > 0 && (stream->pending[length - 1] & 0x80) != 0)
+				length--;
+		}
+		else
+			length = 0;
+	}
+	
+	stream->lastFlush = system_time();
+	if (length < 1)
+		return;
+	
+	BString text;
+	stream->pending.MoveInto(text, 0, length);
+	stream->callback(text.String());
+}
+
+
+static void
+stream_output(const char *data, size_t length, void *cookie)
+{
+	output_stream *stream = (output_stream*)cookie;
+	if (length > 0)
+		stream->pending.Append(data, length);
+	
+	if (stream->pending.Length() >= OUTPUT_FLUSH_SIZE
+		|| system_time() - stream->lastFlush >= OUTPUT_FLUSH_INTERVAL)
+		flush_output(stream, false);
+}
+
+
 SourceControl::SourceControl(void)
   :	fFlags(0),
   	fDebug(false),
@@ -194,6 +268,13 @@ SourceControl::GetChangeStatus(BString &out)
 }
 
 
+status_t
+SourceControl::GetFileStatus(SCMStatusMap &out)
+{
+	return B_NOT_SUPPORTED;
+}
+
+
 status_t
 SourceControl::GetCheckinHeader(BString &out)
 {
@@ -313,62 +394,66 @@ SourceControl::RunCommand(BString in, BString &out)
 	if (in.CountChars() < 1)
 		return -1;
 	
-	//in << "\necho \"Source control command return value: $?\"";
-	/*
-	FILE *fd = popen(in.String(),"r");
+	out = "";
 	
-	if (!fd)
-		return -2;
-	*/
+	output_stream stream;
+	stream.callback = fCallback;
+	stream.lastFlush = system_time();
 	
-	out = "";
+	CommandRunner runner;
+	if (fCallback)
+		runner.SetOutputHook(stream_output, &stream);
 	
-	/*
-	char buffer[1024];
-	while (fgets(buffer,1024,fd))
-	{
-		if (!ferror(fd)) {
-			if (fCallback)
-				fCallback(buffer);
-			out += buffer;
-		} else {
-			STRACE(2,("Command response buffer in error for SCM command"));
-		}
-	}
+	// A stop only applies to the commands running at the time it was asked
+	// for, not to ones started afterwards
+	if (atomic_add(&sRunningCommands, 1) == 0)
+		command_group().Reset();
 	
-	int result = pclose(fd);
-	*/
-	BString cmd(in);
-	//cmd << "sh -c \"" << in << "\"";
-	STRACE(2,("SourceControl::RunCommand:Command: %s\n",cmd.String()));
-	status_t retval = RunPipedCommand(cmd.String(),out,true);
+	CommandGroup *previousGroup = CommandGroup::ThreadGroup();
+	CommandGroup::SetThreadGroup(&command_group());
+	
+	STRACE(2,("SourceControl::RunCommand:Command: %s\n",in.String()));
+	status_t retval = runner.Run(in.String(), out, true);
 	STRACE(2,("Command complete\n"));
+	
+	CommandGroup::SetThreadGroup(previousGroup);
+	atomic_add(&sRunningCommands, -1);
+	
 	int result = 0;
-	if (B_OK != retval) 
+	if (retval != B_OK || runner.ExitStatus() != 0)
 		result = -1;
 	
 	if (fDebug)
 		STRACE(1,("%s: out:\n------------\n%s------------\n",
 				GetShortName(), out.String()));
 	
-	// Grab the return value of the command
-	//int32 pos = out.FindLast("Source control command return value");
-	
-	//int returnValue = atoi(out.String() + pos + strlen("Source control command return value: "));
-	//out.Truncate(pos);
-	out << "----------\n";
-	if (-1 == result) {
-		out << B_TRANSLATE("Command resulted in an error.\n");
+	BString footer;
+	footer << "----------\n";
+	if (retval == B_CANCELED) {
+		footer << B_TRANSLATE("Command stopped.\n");
+	} else if (-1 == result) {
+		footer << B_TRANSLATE("Command resulted in an error.\n");
 	} else {
-		out << 	B_TRANSLATE("Command succeeded. Use 'Import existing project' "
+		footer << 	B_TRANSLATE("Command succeeded. Use 'Import existing project' "
 				"function in the main window "
 				"to load the project from the local filesystem\n");
 	}
-	out << "----------\n";
+	footer << "----------\n";
+	out << footer;
 	
 	if (fCallback)
-		fCallback(out);
+	{
+		stream.pending << footer;
+		flush_output(&stream, true);
+	}
 	
 	return result;
 }
 
+
+void
+SourceControl::StopCommands(void)
+{
+	command_group().Cancel();
+}
+
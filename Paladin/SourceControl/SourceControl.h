@@ -4,6 +4,7 @@
 #include <Entry.h>
 #include <Path.h>
 #include <String.h>
+#include <map>
 
 enum
 {
@@ -12,6 +13,19 @@ enum
 	SCM_TRACKS_DIRECTORIES	= 0x00000004
 };
 
+enum
+{
+	SCM_FILE_CLEAN = 0,
+	SCM_FILE_MODIFIED,
+	SCM_FILE_ADDED,
+	SCM_FILE_REMOVED,
+	SCM_FILE_UNTRACKED,
+	SCM_FILE_CONFLICTED
+};
+
+// The SCM_FILE_* state of each file which isn't clean, by absolute path
+typedef std::map<BString, int32> SCMStatusMap;
+
 typedef void (*SourceControlCallback)(const char *newText);
 
 class SourceControl
@@ -65,6 +79,11 @@ public:
 	
 	virtual	status_t		GetHistory(BString &out, const char *file);
 	virtual	status_t		GetChangeStatus(BString &out);
+	
+	// Gets the state of the files in the working directory in a form that
+	// can be looked up. Unlike the other commands, it doesn't send anything
+	// to the update callback, and it may be called from any thread.
+	virtual	status_t		GetFileStatus(SCMStatusMap &out);
 	virtual	status_t		GetCheckinHeader(BString &out);
 			
 			void			SetURL(const char *url);
@@ -80,6 +99,10 @@ public:
 			bool			GetVerboseMode(void) const;
 			
 			void			RunCustomCommand(const char *command);
+	
+	// Stops the source control commands which are running right now. Their
+	// output up to that point has already been sent to the update callback.
+	static	void			StopCommands(void);
 protected:
 			void			SetShortName(const char *name);
 			void			SetLongName(const char *name);
@@ -88,6 +111,8 @@ protected:
 			BString			GetUsername(void) const;
 			BString			GetPassword(void) const;
 			
+			// Runs a shell command, passing its output to the update
+			// callback as it comes in. Returns 0 if the command succeeded.
 			int				RunCommand(BString in, BString &out);
 
 private:
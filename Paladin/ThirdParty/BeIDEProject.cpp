@@ -25,7 +25,9 @@
 
 #include <ByteOrder.h>
 #include <File.h>
+#include <algorithm>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // Define this if you intend on using this class in a command line import
@@ -60,8 +62,41 @@
 	skipped are the file handling rules. It is unlikely that anyone will not
 	use them and the code for parsing them isn't very simple, so they are not
 	worth bothering with.
+	
+	Everything read from the file is checked against the size of the data, so
+	a truncated or damaged project fails to load instead of crashing.
 */
 
+
+static off_t
+find_tag(const uint8 *buffer, off_t size, const int32 &id, off_t offset)
+{
+	uint8 tag[4];
+	tag[0] = (uint8)((id & 0xFF000000) >>  24);
+	tag[1] = (uint8)((id & 0x00FF0000) >>  16);
+	tag[2] = (uint8)((id & 0x0000FF00) >>  8);
+	tag[3] = (uint8)((id & 0x000000FF));
+	
+	// memchr() is much faster than comparing byte by byte, and the rest of
+	// the tag only needs checking where the first byte matches
+	const uint8 *start = buffer + offset;
+	const uint8 *last = buffer + size - 4;
+	while (start <= last)
+	{
+		const uint8 *match = (const uint8*)memchr(start, tag[0], last - start + 1);
+		if (!match)
+			break;
+		
+		if (memcmp(match, tag, 4) == 0)
+			return match - buffer;
+		
+		start = match + 1;
+	}
+	
+	return -1;
+}
+
+
 BeIDEProject::BeIDEProject(const char *path)
 {
 	InitObject();
@@ -77,6 +112,7 @@ BeIDEProject::BeIDEProject(void)
 
 BeIDEProject::~BeIDEProject(void)
 {
+	free(fBuffer);
 }
 
 
@@ -90,6 +126,8 @@ BeIDEProject::InitCheck(void) const
 status_t
 BeIDEProject::SetTo(const char *path)
 {
+	Unset();
+	
 	BFile file(path, B_READ_ONLY);
 	if (file.InitCheck() != B_OK)
 	{
@@ -105,7 +143,7 @@ BeIDEProject::SetTo(const char *path)
 		return fInit;
 	}
 	
-	fBuffer = new uint8[fBufferSize];
+	fBuffer = (uint8*)malloc(fBufferSize);
 	if (!fBuffer)
 	{
 		fInit = B_NO_MEMORY;
@@ -113,15 +151,17 @@ BeIDEProject::SetTo(const char *path)
 	}
 	
 	if (file.Read(fBuffer, fBufferSize) != fBufferSize)
-	{
 		fInit = B_ERROR;
-		return fInit;
+	else
+	{
+		IndexTags();
+		ParseData();
 	}
 	
-	ParseData();
-	
-	delete [] fBuffer;
+	free(fBuffer);
 	fBuffer = NULL;
+	for (int32 i = 0; i < kIndexedTagCount; i++)
+		fTagOffsets[i].clear();
 	
 	return fInit;
 }
@@ -131,9 +171,12 @@ void
 BeIDEProject::Unset(void)
 {
 	fInit = B_NO_INIT;
-	if (fBuffer)
-		delete [] fBuffer;
+	free(fBuffer);
 	fBuffer = NULL;
+	fBufferSize = 0;
+	fDamaged = false;
+	for (int32 i = 0; i < kIndexedTagCount; i++)
+		fTagOffsets[i].clear();
 	fProjectFiles.clear();
 	
 	fTargetName = "BeApp";
@@ -332,7 +375,7 @@ BeIDEProject::CountSystemIncludes(void) const
 const char *
 BeIDEProject::SystemIncludeAt(const uint32 &index)
 {
-	if (index > fSysIncludes.size() - 1)
+	if (index >= fSysIncludes.size())
 		return NULL;
 	
 	return fSysIncludes[index].String();
@@ -349,7 +392,7 @@ BeIDEProject::CountLocalIncludes(void) const
 const char *
 BeIDEProject::LocalIncludeAt(const uint32 &index)
 {
-	if (index > fLocalIncludes.size() - 1)
+	if (index >= fLocalIncludes.size())
 		return NULL;
 	
 	return fLocalIncludes[index].String();
@@ -367,7 +410,7 @@ ProjectFile
 BeIDEProject::FileAt(const uint32 &index)
 {
 	ProjectFile empty;
-	if (index > fProjectFiles.size() - 1)
+	if (index >= fProjectFiles.size())
 		return empty;
 	
 	return fProjectFiles[index];
@@ -381,6 +424,8 @@ BeIDEProject::InitObject(void)
 {
 	fInit = B_NO_INIT;
 	fBuffer = NULL;
+	fBufferSize = 0;
+	fDamaged = false;
 	fTargetName = "BeApp";
 	fTargetType = TARGET_APPLICATION;
 	fSystemIncludesAsLocal = false;
@@ -415,34 +460,72 @@ BeIDEProject::TagIDToString(const uint32 &id)
 off_t
 BeIDEProject::FindTagID(const int32 &id, const off_t &offset)
 {
-	if (offset < 0 || offset > fBufferSize)
+	if (offset < 0 || offset > fBufferSize - 4)
 		return -1;
 	
-	uint8 byte1 = (uint8)((id & 0xFF000000) >>  24);
-	uint8 byte2 = (uint8)((id & 0x00FF0000) >>  16);
-	uint8 byte3 = (uint8)((id & 0x0000FF00) >>  8);
-	uint8 byte4 = (uint8)((id & 0x000000FF));
-	
-	uint8 *end = fBuffer + fBufferSize;
-	for (uint8 *i = fBuffer + offset; i <= end; i++)
+	for (int32 i = 0; i < kIndexedTagCount; i++)
 	{
-		if (*i == byte1 && *(i + 1) == byte2 &&
-			*(i + 2) == byte3 && *(i + 3) == byte4)
-			return (i - fBuffer);
+		if (kIndexedTags[i] != id)
+			continue;
+		
+		vector<off_t>::const_iterator match = std::lower_bound(fTagOffsets[i].begin(),
+															fTagOffsets[i].end(), offset);
+		return (match == fTagOffsets[i].end()) ? -1 : *match;
 	}
 	
-	return -1;
+	return find_tag(fBuffer, fBufferSize, id, offset);
+}
+
+
+void
+BeIDEProject::IndexTags(void)
+{
+	for (int32 i = 0; i < kIndexedTagCount; i++)
+		fTagOffsets[i].clear();
+	
+	if (fBufferSize < 4)
+		return;
+	
+	// Only bytes which start one of the tags need a closer look
+	bool firstByte[256];
+	memset(firstByte, 0, sizeof(firstByte));
+	for (int32 i = 0; i < kIndexedTagCount; i++)
+		firstByte[((uint32)kIndexedTags[i]) >> 24] = true;
+	
+	const uint8 *end = fBuffer + fBufferSize - 3;
+	for (const uint8 *i = fBuffer; i < end; i++)
+	{
+		if (!firstByte[*i])
+			continue;
+		
+		int32 value = (int32)(((uint32)i[0] << 24) | ((uint32)i[1] << 16)
+							| ((uint32)i[2] << 8) | (uint32)i[3]);
+		for (int32 j = 0; j < kIndexedTagCount; j++)
+		{
+			if (value == kIndexedTags[j])
+				fTagOffsets[j].push_back(i - fBuffer);
+		}
+	}
 }
 
 
 int32
 BeIDEProject::ReadInt32(off_t &offset)
 {
-	int32 data = *((int32*)(fBuffer + offset));
-	swap_data(B_INT32_TYPE, &data, sizeof(int32), B_SWAP_BENDIAN_TO_HOST);
+	if (offset < 0 || offset > fBufferSize - (off_t)sizeof(int32))
+	{
+		// Everything after this point fails, too
+		fDamaged = true;
+		offset = fBufferSize;
+		return 0;
+	}
+	
+	// The data isn't aligned, so it is copied out instead of dereferenced
+	int32 data;
+	memcpy(&data, fBuffer + offset, sizeof(int32));
 	offset += sizeof(int32);
 	
-	return data;
+	return B_BENDIAN_TO_HOST_INT32(data);
 }
 
 
@@ -451,33 +534,46 @@ BeIDEProject::ReadString(off_t &offset)
 {
 	BString out;
 	
-	if (offset < 0 || offset > fBufferSize)
+	if (offset < 0 || offset >= fBufferSize)
+	{
+		fDamaged = true;
+		offset = fBufferSize;
 		return out;
+	}
 	
-	uint8 *end = fBuffer + fBufferSize;
-	for (uint8 *i = fBuffer + offset; i <= end; i++)
+	const char *start = (const char*)fBuffer + offset;
+	const char *terminator = (const char*)memchr(start, 0, fBufferSize - offset);
+	if (!terminator)
 	{
-		if (*i == 0)
-		{
-			uint32 size = i - fBuffer + 1;
-			char *tempBuffer = out.LockBuffer(size);
-			strncpy(tempBuffer, (char*)fBuffer + offset, size);
-			out.UnlockBuffer();
-			
-			offset += out.CountChars() + 1;
-			return out;
-		}
+		fDamaged = true;
+		offset = fBufferSize;
+		return out;
 	}
 	
+	out.SetTo(start, terminator - start);
+	offset += (terminator - start) + 1;
 	return out;
 }
 
 
 void
-BeIDEProject::ParseData()
+BeIDEProject::Skip(off_t &offset, int64 count)
 {
-	BMemoryIO io(fBuffer,fBufferSize);
+	// Records follow one another, so a negative size is garbage
+	if (count < 0 || offset + count > fBufferSize)
+	{
+		fDamaged = true;
+		offset = fBufferSize;
+		return;
+	}
 	
+	offset += count;
+}
+
+
+void
+BeIDEProject::ParseData()
+{
 	// Skip over the header and other junk to get to the access paths
 	off_t pos = FindTagID('DAcc');
 	if (pos < 0)
@@ -504,7 +600,7 @@ BeIDEProject::ParseData()
 			countSysIncludes, countLocalIncludes));
 	
 	// Read the system paths
-	for (int32 sysCount = 0; sysCount < countSysIncludes; sysCount++)
+	for (int32 sysCount = 0; sysCount < countSysIncludes && !fDamaged; sysCount++)
 	{
 		pos += (sizeof(int32) * 3) + 1;
 		DTRACE(("Position: %lld\n", pos));
@@ -513,11 +609,12 @@ BeIDEProject::ParseData()
 		fSysIncludes.push_back(path.String());
 		
 		// Skip over the rest of the path's fixed string storage
-		pos += 258 - path.CountChars();
+		Skip(pos, 258 - path.Length());
 	}
 	
 	// Read the local paths
-	for (int32 localCount = 0; localCount < countLocalIncludes; localCount++)
+	for (int32 localCount = 0; localCount < countLocalIncludes && !fDamaged;
+			localCount++)
 	{
 		pos += (sizeof(int32) * 3) + 1;
 		DTRACE(("Position: %lld\n", pos));
@@ -526,7 +623,7 @@ BeIDEProject::ParseData()
 		fLocalIncludes.push_back(path.String());
 		
 		// Skip over the rest of the path's fixed string storage
-		pos += 258 - path.CountChars();
+		Skip(pos, 258 - path.Length());
 	}
 	
 	// -----------------------------------------------------------------------
@@ -925,7 +1022,7 @@ BeIDEProject::ParseData()
 				{
 					pos += sizeof(int32);
 					fCompilerOptions = ReadString(pos);
-					pos += 1023 - fCompilerOptions.CountChars();
+					Skip(pos, 1023 - fCompilerOptions.Length());
 					STRACE(("Extra compiler options: %s\n",
 							fCompilerOptions.CountChars() > 0 ? fCompilerOptions.String() :
 																"None"));
@@ -934,7 +1031,7 @@ BeIDEProject::ParseData()
 				{
 					DTRACE(("Skipping record for unsupported 'cccg' subtag name %s\n",
 							subTagName.String()));
-					pos += subRecordSize - 8 - subTagName.CountChars() - 1;
+					Skip(pos, (int64)subRecordSize - 8 - subTagName.Length() - 1);
 				}
 				break;
 			}
@@ -962,7 +1059,7 @@ BeIDEProject::ParseData()
 				{
 					pos += sizeof(int32);
 					fLinkerOptions = ReadString(pos);
-					pos += 1023 - fLinkerOptions.CountChars();
+					Skip(pos, 1023 - fLinkerOptions.Length());
 					STRACE(("Extra linker options: %s\n",
 							fLinkerOptions.CountChars() > 0 ? fLinkerOptions.String() :
 																"None"));
@@ -971,7 +1068,7 @@ BeIDEProject::ParseData()
 				{
 					DTRACE(("Skipping record for unsupported 'dlcg' subtag name %s\n",
 							subTagName.String()));
-					pos += subRecordSize - 8 - subTagName.CountChars() - 1;
+					Skip(pos, (int64)subRecordSize - 8 - subTagName.Length() - 1);
 				}
 				break;
 			}
@@ -984,12 +1081,18 @@ BeIDEProject::ParseData()
 				DTRACE(("Position: %lld\n", pos));
 				pos += (sizeof(int32) * 2);
 				
+				if (pos >= fBufferSize)
+				{
+					fDamaged = true;
+					break;
+				}
+				
 				fTargetType = fBuffer[pos];
 				STRACE(("Target type is %d\n", fTargetType));
 				pos += 65;
 				
 				fTargetName = ReadString(pos);
-				pos += 66 - fTargetName.CountChars();
+				Skip(pos, 66 - fTargetName.Length());
 				STRACE(("Target name: %s\n", fTargetName.String()));
 				break;
 			}
@@ -997,7 +1100,7 @@ BeIDEProject::ParseData()
 			{
 				DTRACE(("Skipping record for unsupported subtag %s\n",
 						TagIDToString(subTag).String()));
-				pos += subRecordSize - 8 - subTagName.CountChars() - 1;
+				Skip(pos, (int64)subRecordSize - 8 - subTagName.Length() - 1);
 				break;
 			}
 		}
@@ -1040,7 +1143,7 @@ BeIDEProject::ParseData()
 		STRACE(("\nGroup: %s\n", groupName.String()));
 		
 		// Skip over the rest of the path's fixed string storage
-		pos += 18 - groupName.CountChars();
+		Skip(pos, 18 - groupName.Length());
 		DTRACE(("Position: %lld\n", pos));
 		
 		// A lot of group records have this goofy DPrf record afterward, whatever
@@ -1054,7 +1157,7 @@ BeIDEProject::ParseData()
 			currentTag = ReadInt32(pos);
 		}
 		
-		for (int32 i = 0; i < groupFileCount; i++)
+		for (int32 i = 0; i < groupFileCount && !fDamaged; i++)
 		{
 			BString fileName;
 			BString mimeType;
@@ -1123,16 +1226,24 @@ BeIDEProject::ParseData()
 				}
 			}
 			
+			// The last record may end the file
+			if (pos > fBufferSize - (off_t)sizeof(int32))
+			{
+				currentTag = 0;
+				break;
+			}
 			currentTag = ReadInt32(pos);
 		}
 		
 		if (currentTag != 'Sect')
 		{
 			pos = FindTagID('Sect', pos);
+			if (pos < 0)
+				break;
 			currentTag = ReadInt32(pos);
 		}
 	}
 	
-	fInit = B_OK;
+	fInit = fDamaged ? B_BAD_DATA : B_OK;
 }
 
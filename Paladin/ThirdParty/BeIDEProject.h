@@ -156,6 +156,11 @@ public:
 	BString toolName;
 };
 
+// The tags which ParseData() searches for. Their positions are found in a
+// single pass when the file is loaded.
+static const int32 kIndexedTags[] = { 'DAcc', 'GPrf', 'Sect' };
+static const int32 kIndexedTagCount = sizeof(kIndexedTags) / sizeof(kIndexedTags[0]);
+
 
 class BeIDEProject
 {
@@ -221,13 +226,19 @@ private:
 	
 	// Convenience methods for working with file tags
 	BString		TagIDToString(const uint32 &id);
+	
+	// Returns the position of the first instance of the tag at or after the
+	// offset, or -1 if there is none. The tags the parser looks for are
+	// indexed when the file is loaded, so finding them is a lookup.
 	off_t		FindTagID(const int32 &id, const off_t &offset = 0);
+	void		IndexTags(void);
 	
-	// The Read methods modify the offset, too, just like reading from a file
+	// The Read methods modify the offset, too, just like reading from a file.
+	// Reading past the end of the data returns 0 or an empty string and marks
+	// the file as damaged instead.
 	int32		ReadInt32(off_t &offset);
-	
-	// Assumes that string is NULL-terminated
 	BString		ReadString(off_t &offset);
+	void		Skip(off_t &offset, int64 count);
 	
 	// Does all of the real work
 	void		ParseData(void);
@@ -235,6 +246,8 @@ private:
 	status_t				fInit;
 	uint8					*fBuffer;
 	off_t					fBufferSize;
+	bool					fDamaged;
+	vector<off_t>			fTagOffsets[kIndexedTagCount];
 	
 	// Project Data
 	vector<ProjectFile>		fProjectFiles;
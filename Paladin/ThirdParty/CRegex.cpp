@@ -5,22 +5,343 @@
 
 #include "CRegex.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 const status_t krx_NoMatch = PCRE_ERROR_NOMATCH;
 const status_t krx_NotBOL = PCRE_NOTBOL;
 const status_t krx_NotEOL = PCRE_NOTEOL;
 
-CRegex::CRegex()
+// Writes the replacement for the current match to output. Runs of plain
+// characters are written in one go. groupOffset is added to the number of
+// each group the replacement refers to.
+static status_t ExpandReplacement(const char* repl, const char* subject,
+								  const CRegexMatch& match, int groupOffset,
+								  BDataIO& output)
+{
+	const char* run = repl;
+	const char* c = repl;
+	while (*c)
+	{
+		if ((*c != '\\' && *c != '$') || c[1] == '\0')
+		{
+			c++;
+			continue;
+		}
+
+		if (c > run)
+			output.Write(run, c - run);
+
+		char next = c[1];
+		if (next >= '1' && next <= '9')
+		{
+			int group = next - '0' + groupOffset;
+			if (group < match.Count() && match.Len(group) > 0)
+				output.Write(subject + match.Start(group), match.Len(group));
+		}
+		else if (*c == '\\')
+		{	// de-escape newline, carriage-return, tab and backslash:
+			if (next == 'n')
+				output.Write("\n", 1);
+			else if (next == 'r')
+				output.Write("\r", 1);
+			else if (next == 't')
+				output.Write("\t", 1);
+			else if (next == '\\')
+				output.Write("\\", 1);
+		}
+		c += 2;
+		run = c;
+	}
+	if (c > run)
+		output.Write(run, c - run);
+	return B_OK;
+}
+
+// How many bytes the character at the start of text takes up in UTF-8
+static int32 CharLength(const char* text, int32 len)
+{
+	int32 i = 1;
+	while (i < len && (text[i] & 0xc0) == 0x80)
+		i++;
+	return i;
+}
+
+
+#pragma mark - CRegexPattern
+
+
+CRegexPattern::CRegexPattern()
 	: fInitCheck(B_NO_INIT)
 	, fRegex(NULL)
+	, fExtra(NULL)
+	, fCaptureCount(0)
+	, fJIT(false)
+{
+}
+
+CRegexPattern::CRegexPattern(const char* pattern, int options)
+	: fInitCheck(B_NO_INIT)
+	, fRegex(NULL)
+	, fExtra(NULL)
+	, fCaptureCount(0)
+	, fJIT(false)
+{
+	SetTo(pattern, options);
+}
+
+CRegexPattern::~CRegexPattern()
+{
+	_Cleanup();
+}
+
+status_t CRegexPattern::SetTo(const char* pattern, int options)
+{
+	_Cleanup();
+	if (!pattern || !strlen(pattern))
+	{
+		fErrorStr = "Pattern is empty!";
+		return fInitCheck = B_BAD_VALUE;
+	}
+
+	const char* errStr;
+	int errPos;
+	fRegex = pcre_compile(pattern, options, &errStr, &errPos, NULL);
+	if (!fRegex)
+	{
+		fErrorStr << errStr << " at:\n\t" << pattern+errPos;
+		return fInitCheck = B_ERROR;
+	}
+
+	// Studying is what makes a compiled pattern worth keeping. Where PCRE
+	// has a JIT compiler, this also turns the pattern into machine code.
+	int studyOptions = 0;
+#ifdef PCRE_STUDY_JIT_COMPILE
+	studyOptions |= PCRE_STUDY_JIT_COMPILE;
+#endif
+	fExtra = pcre_study(fRegex, studyOptions, &errStr);
+
+#ifdef PCRE_STUDY_JIT_COMPILE
+	int jit = 0;
+	if (fExtra && pcre_fullinfo(fRegex, fExtra, PCRE_INFO_JIT, &jit) == 0)
+		fJIT = jit != 0;
+#endif
+
+	if (pcre_fullinfo(fRegex, fExtra, PCRE_INFO_CAPTURECOUNT,
+			&fCaptureCount) != 0)
+		fCaptureCount = 0;
+
+	return fInitCheck = B_OK;
+}
+
+status_t CRegexPattern::ReplaceAll(const char* subject, int32 len,
+								   const char* replacement, BDataIO& output,
+								   int32* replaced, int options) const
+{
+	if (fInitCheck != B_OK)
+		return fInitCheck;
+	if (!subject || !replacement)
+		return B_BAD_VALUE;
+
+	int32 count = 0;
+	int32 copied = 0;
+	CRegexIterator it(*this, subject, len, options);
+	while (it.Next())
+	{
+		const CRegexMatch& match = it.Match();
+		if (match.Start() > copied)
+			output.Write(subject + copied, match.Start() - copied);
+		ExpandReplacement(replacement, subject, match, 0, output);
+		copied = match.End();
+		count++;
+	}
+	if (len > copied)
+		output.Write(subject + copied, len - copied);
+
+	if (replaced)
+		*replaced = count;
+	return it.Status();
+}
+
+int CRegexPattern::_Exec(const char* subject, int32 len, int32 offset,
+						 int options, int* ovector, int ovecsize) const
+{
+	int res = pcre_exec(fRegex, fExtra, subject, len, offset, options,
+		ovector, ovecsize);
+#ifdef PCRE_ERROR_JIT_STACKLIMIT
+	if (res == PCRE_ERROR_JIT_STACKLIMIT && fExtra)
+	{
+		// The JIT code ran out of its default stack. Rather than handing
+		// out stacks per thread for a rare case, fall back to the
+		// interpreter for this one match. The copy keeps this thread-safe.
+		pcre_extra extra = *fExtra;
+		extra.flags &= ~PCRE_EXTRA_EXECUTABLE_JIT;
+		res = pcre_exec(fRegex, &extra, subject, len, offset,
+			options | PCRE_NO_UTF8_CHECK, ovector, ovecsize);
+	}
+#endif
+	return res;
+}
+
+void CRegexPattern::_Cleanup()
+{
+	if (fExtra)
+	{
+#ifdef PCRE_STUDY_JIT_COMPILE
+		pcre_free_study(fExtra);
+#else
+		pcre_free(fExtra);
+#endif
+		fExtra = NULL;
+	}
+	if (fRegex)
+	{
+		pcre_free(fRegex);
+		fRegex = NULL;
+	}
+	fErrorStr.Truncate(0);
+	fCaptureCount = 0;
+	fJIT = false;
+	fInitCheck = B_NO_INIT;
+}
+
+
+#pragma mark - CRegexMatch
+
+
+CRegexMatch::CRegexMatch()
+	: fCount(0)
+{
+}
+
+status_t CRegexMatch::Exec(const CRegexPattern& pattern, const char* subject,
+						   int32 len, int32 offset, int options)
+{
+	fCount = 0;
+	if (pattern.InitCheck() != B_OK)
+		return B_NO_INIT;
+	if (!subject)
+		return B_BAD_VALUE;
+
+	// Only grows, so after the first match with a pattern this is free
+	int size = (pattern.CaptureCount() + 1) * 3;
+	if ((int)fVector.size() < size)
+		fVector.resize(size);
+
+	int res = pattern._Exec(subject, len, offset, options, &fVector[0], size);
+	if (res < 0)
+		return res;
+
+	// 0 means there were more groups than room for them, which can't happen
+	// since the vector is sized from the pattern
+	fCount = res > 0 ? res : size / 3;
+	return B_OK;
+}
+
+int CRegexMatch::Start(int index) const
+{
+	if (index < 0 || index >= fCount)
+		return 0;
+	return fVector[index * 2];
+}
+
+int CRegexMatch::End(int index) const
+{
+	if (index < 0 || index >= fCount)
+		return 0;
+	return fVector[index * 2 + 1];
+}
+
+int CRegexMatch::Len(int index) const
+{
+	// Groups which didn't take part in the match are -1, -1
+	return End(index) - Start(index);
+}
+
+
+#pragma mark - CRegexIterator
+
+
+CRegexIterator::CRegexIterator(const CRegexPattern& pattern,
+							   const char* subject, int32 len, int options,
+							   CRegexMatch* scratch)
+	: fPattern(pattern)
+	, fSubject(subject)
+	, fLength(len)
+	, fOptions(options)
+	, fOffset(0)
+	, fLastWasEmpty(false)
+	, fStatus(B_OK)
+	, fMatch(scratch ? scratch : &fOwnMatch)
+{
+}
+
+bool CRegexIterator::Next()
+{
+	while (fOffset <= fLength)
+	{
+		int options = fOptions;
+		if (fLastWasEmpty)
+		{
+			// Perl's rule: after an empty match, look for a non-empty one at
+			// the same place before moving on
+			options |= PCRE_NOTEMPTY_ATSTART | PCRE_ANCHORED;
+		}
+
+		status_t res = fMatch->Exec(fPattern, fSubject, fLength, fOffset,
+			options);
+
+		// PCRE checks the whole subject for valid UTF-8 on every call unless
+		// told not to. Once is enough.
+		fOptions |= PCRE_NO_UTF8_CHECK;
+
+		if (res == B_OK)
+		{
+			fLastWasEmpty = fMatch->Start() == fMatch->End();
+			fOffset = fMatch->End();
+			return true;
+		}
+
+		if (res != krx_NoMatch)
+		{
+			fStatus = res;
+			return false;
+		}
+
+		if (!fLastWasEmpty)
+			break;
+
+		// Nothing non-empty here either, so step over one character
+		fLastWasEmpty = false;
+		if (fOffset >= fLength)
+			break;
+		if (fSubject[fOffset] == '\r' && fOffset + 1 < fLength
+			&& fSubject[fOffset + 1] == '\n')
+			fOffset += 2;
+		else
+			fOffset += CharLength(fSubject + fOffset, fLength - fOffset);
+	}
+	fOffset = fLength + 1;
+	fStatus = B_OK;
+	return false;
+}
+
+
+#pragma mark - CRegex
+
+
+CRegex::CRegex()
+	: fInitCheck(B_NO_INIT)
 	, fErrorStr(NULL)
+	, fBackward(false)
 {
 }
 
 CRegex::CRegex(const char* pattern, bool ignoreCase, bool fullWord, 
 			   bool backward)
 	: fInitCheck(B_NO_INIT)
-	, fRegex(NULL)
 	, fErrorStr(NULL)
+	, fBackward(false)
 {
 	_Init(pattern, ignoreCase, fullWord, backward);
 }
@@ -40,113 +361,85 @@ status_t CRegex::SetTo(const char* pattern, bool ignoreCase, bool fullWord,
 status_t CRegex::Match(const char* subject, int32 len, int32 offset, 
 					   int options)
 {
-	if (!fRegex)
+	if (fInitCheck != B_OK)
 		return B_NO_INIT;
 	if (!subject)
 		return B_BAD_VALUE;
-	int res;
-	int infoCount;
-	res = pcre_fullinfo(fRegex, NULL, PCRE_INFO_CAPTURECOUNT, &infoCount);
-	if (res != 0)
-		return res;
-	infoCount++;
-	int vs = infoCount*3;
-	int *mvect = new int [vs];
-	res = pcre_exec(fRegex, NULL, subject, len, offset, options, mvect, vs);
-	fMatchInfos.clear();
-	if (res >= 0)
-	{
-		for( int i=0; i<res; ++i)
-		{
-			MatchInfo mi;
-			mi.start = mvect[i*2];
-			mi.len = mvect[1+i*2]-mvect[i*2];
-			if (i==1 && fBackward)
-			{	// [zooey]: we inserted a greedy anchor-to-front in order to
-				// match the last occurence of the pattern. Now we need to
-				// skip this anchor match and adjust the total match as needed.
-				// If anyone knows a better way, please tell!
-				fMatchInfos[0].start += mi.len;
-				fMatchInfos[0].len -= mi.len;
-				continue;
-			}
-			fMatchInfos.push_back(mi);
-		}
-		res = 0;
-	}
-	delete [] mvect;
-	return res;
+
+	int count = MatchCount();
+	for (int i = 0; i < count && i < (int)fMatchStrs.size(); ++i)
+		fMatchStrs[i].Truncate(0);
+
+	return fMatch.Exec(fPattern, subject, len, offset, options);
+}
+
+int CRegex::_GroupIndex(unsigned int index) const
+{
+	// [zooey]: we inserted a greedy anchor-to-front in order to match the
+	// last occurence of the pattern, so its group has to be skipped.
+	if (fBackward && index > 0)
+		return index + 1;
+	return index;
 }
 
 int CRegex::MatchStart(unsigned int index) const
 {
-	if (fMatchInfos.size() <= index)
+	if ((int)index >= MatchCount())
 		return 0;
-	return fMatchInfos[index].start;
+	if (fBackward && index == 0)
+		return fMatch.End(1);
+	return fMatch.Start(_GroupIndex(index));
 }
 
 int CRegex::MatchLen(unsigned int index) const
 {
-	if (fMatchInfos.size() <= index)
+	if ((int)index >= MatchCount())
 		return 0;
-	return fMatchInfos[index].len;
+	if (fBackward && index == 0)
+		return fMatch.End(0) - fMatch.End(1);
+	return fMatch.Len(_GroupIndex(index));
 }
 
 static BString DefaultString;
 
 const BString& CRegex::MatchStr(const char* subject, unsigned int index) const
 {
-	if (!subject || fMatchInfos.size() <= index)
+	if (!subject || (int)index >= MatchCount())
 		return DefaultString;
-	const MatchInfo& mi = fMatchInfos[index];
-	if (mi.len && !mi.str.Length())
-		mi.str.SetTo(subject+mi.start, mi.len);
-	return mi.str;
+	if (fMatchStrs.size() <= index)
+		fMatchStrs.resize(index + 1);
+	BString& str = fMatchStrs[index];
+	int len = MatchLen(index);
+	if (len > 0 && !str.Length())
+		str.SetTo(subject + MatchStart(index), len);
+	return str;
 }
 
 int
 CRegex::MatchCount(void) const
 {
-	return fMatchInfos.size();
+	int count = fMatch.Count();
+	if (fBackward && count > 1)
+		count--;
+	return count;
 }
 
 char* CRegex::ReplaceString(const char* subject, int32 len, const char* repl)
 {
-	if (!subject || fInitCheck != B_OK || fMatchInfos.empty())
+	if (!subject || !repl || fInitCheck != B_OK || MatchCount() == 0)
 		return NULL;
 	
-	BString replStr;
+	// Skip the group of the anchor added for backward searches so that \1
+	// still means the pattern's own first group
+	BMallocIO replStr;
+	ExpandReplacement(repl, subject, fMatch, fBackward ? 1 : 0, replStr);
 
-	char c;
-	int rl = strlen(repl);
-	for(int i=0; i<rl; ++i)
-	{
-		c = repl[i];
-		if (c == '\\' || c == '$')
-		{
-			c = repl[++i];
-			if (c >= '1' && c <= '9')
-				replStr << MatchStr(subject, c-'0');
-			else if (c == '\\') 
-			{	// de-escape newline, carriage-return, tab and backslash:
-				if (c == 'n')
-					replStr << '\n';
-				else if (c == 'r')
-					replStr << '\r';
-				else if (c == 't')
-					replStr << '\t';
-				else if (c == '\\')
-					replStr << '\\';
-			}
-		}
-		else
-			replStr << c;
-	}
-	char* resBuf = (char*)malloc(replStr.Length()+1);
+	size_t size = replStr.BufferLength();
+	char* resBuf = (char*)malloc(size + 1);
 	if (resBuf)
 	{
-		replStr.CopyInto(resBuf, 0, replStr.Length());
-		resBuf[replStr.Length()] = '\0';
+		memcpy(resBuf, replStr.Buffer(), size);
+		resBuf[size] = '\0';
 	}
 	return resBuf;
 }
@@ -157,7 +450,7 @@ status_t CRegex::_Init(const char* patt, bool ignoreCase, bool fullWord,
 	if (!patt || !strlen(patt))
 	{
 		fErrorStr = "Pattern is empty!";
-		return B_BAD_VALUE;
+		return fInitCheck = B_BAD_VALUE;
 	}
 	uint32 options = PCRE_UTF8 | PCRE_MULTILINE;
 	if (ignoreCase)
@@ -173,29 +466,17 @@ status_t CRegex::_Init(const char* patt, bool ignoreCase, bool fullWord,
 		pattern = BString("(\\A(?s).*)") << pattern;
 		fBackward = true;
 	}
-	const char* errStr;
-	int errPos;
-	fRegex = pcre_compile(pattern.String(), options, &errStr, &errPos, NULL);
-	if (!fRegex) 
-	{
-		fErrorStr << errStr << " at:\n\t" << pattern.String()+errPos;
-		fInitCheck = B_ERROR;
-	}
-	else
-		fInitCheck = B_OK;
+	fInitCheck = fPattern.SetTo(pattern.String(), options);
+	if (fInitCheck != B_OK)
+		fErrorStr = fPattern.ErrorStr();
 	return fInitCheck;
 }
 
 void CRegex::_Cleanup()
 {
-	if (fRegex)
-	{
-		pcre_free(fRegex);
-		fRegex = NULL;
-	}
 	fErrorStr.Truncate(0);
 	fBackward = false;
 	fInitCheck = B_NO_INIT;
-	fMatchInfos.clear();
+	fMatch = CRegexMatch();
+	fMatchStrs.clear();
 }
-
@@ -6,6 +6,7 @@
 #ifndef _CRegex_h_
 #define _CRegex_h_
 
+#include <DataIO.h>
 #include <String.h>
 #include <vector>
 #include <pcre.h>
@@ -16,6 +17,107 @@ extern const status_t krx_NoMatch;
 extern const status_t krx_NotBOL;
 extern const status_t krx_NotEOL;
 
+class CRegexMatch;
+
+// A pattern which is compiled and studied once (and JIT-compiled where the
+// PCRE library supports it) so that it can be matched many times cheaply.
+// It isn't changed by matching, so one pattern can be shared by several
+// threads as long as each of them uses its own CRegexMatch.
+class CRegexPattern
+{
+public:
+		CRegexPattern();
+		CRegexPattern(const char* pattern,
+					  int options = PCRE_UTF8 | PCRE_MULTILINE);
+		~CRegexPattern();
+
+		status_t SetTo(const char* pattern,
+					   int options = PCRE_UTF8 | PCRE_MULTILINE);
+
+		status_t InitCheck() const;
+		const BString& ErrorStr() const;
+		int CaptureCount() const;
+		bool IsJITCompiled() const;
+
+		// Replaces every match in subject, writing the result to output as
+		// it goes instead of building it up in memory. In the replacement,
+		// \1-\9 and $1-$9 insert captured groups and \n, \r, \t and \\ are
+		// unescaped.
+		status_t ReplaceAll(const char* subject, int32 len,
+							const char* replacement, BDataIO& output,
+							int32* replaced = NULL, int options = 0) const;
+
+private:
+		friend class CRegexMatch;
+
+		int _Exec(const char* subject, int32 len, int32 offset, int options,
+				  int* ovector, int ovecsize) const;
+		void _Cleanup();
+
+		status_t fInitCheck;
+		pcre* fRegex;
+		pcre_extra* fExtra;
+		int fCaptureCount;
+		bool fJIT;
+		BString fErrorStr;
+
+		// hide copy constructor
+		CRegexPattern(const CRegexPattern&);
+};
+
+// The results of matching a CRegexPattern. The space for them is kept
+// between calls, so matching in a loop doesn't allocate. Each thread needs
+// its own.
+class CRegexMatch
+{
+public:
+		CRegexMatch();
+
+		// Returns B_OK, krx_NoMatch or another PCRE error
+		status_t Exec(const CRegexPattern& pattern, const char* subject,
+					  int32 len, int32 offset, int options = 0);
+
+		int Count() const;
+		int Start(int index = 0) const;
+		int End(int index = 0) const;
+		int Len(int index = 0) const;
+
+private:
+		vector<int> fVector;
+		int fCount;
+};
+
+// Steps through all of the non-overlapping matches of a pattern in a buffer.
+// Empty matches are handled the way Perl does, so the loop always ends.
+//
+//	CRegexIterator it(pattern, text, length);
+//	while (it.Next())
+//		printf("%d\n", it.Match().Start());
+class CRegexIterator
+{
+public:
+		CRegexIterator(const CRegexPattern& pattern, const char* subject,
+					   int32 len, int options = 0,
+					   CRegexMatch* scratch = NULL);
+
+		bool Next();
+		const CRegexMatch& Match() const;
+
+		// B_OK if the iteration ended because there were no more matches
+		status_t Status() const;
+
+private:
+		const CRegexPattern& fPattern;
+		const char* fSubject;
+		int32 fLength;
+		int fOptions;
+		int32 fOffset;
+		bool fLastWasEmpty;
+		status_t fStatus;
+		CRegexMatch fOwnMatch;
+		CRegexMatch* fMatch;
+};
+
 class CRegex
 {
 public:
@@ -37,29 +139,62 @@ public:
 		int MatchLen(unsigned int index = 0) const;
 		int MatchCount(void) const;
 		const BString& MatchStr(const char* subject, unsigned int index = 0) const;
+
+		const CRegexPattern& Pattern() const;
 private:
 		status_t _Init(const char* pattern, bool ignoreCase, bool fullWord,
 					   bool backward);
 		void _Cleanup();
+		int _GroupIndex(unsigned int index) const;
 
 		status_t fInitCheck;
 
-		pcre* fRegex;
+		CRegexPattern fPattern;
+		CRegexMatch fMatch;
 		BString fErrorStr;
 		bool fBackward;
 
-		struct MatchInfo
-		{
-			int start;
-			int len;
-			mutable BString str;
-		};
-		vector<MatchInfo> fMatchInfos;
+		mutable vector<BString> fMatchStrs;
 
 		// hide copy constructor
 		CRegex(const CRegex&);
 };
 
+inline status_t CRegexPattern::InitCheck() const
+{
+	return fInitCheck;
+}
+
+inline const BString& CRegexPattern::ErrorStr() const
+{
+	return fErrorStr;
+}
+
+inline int CRegexPattern::CaptureCount() const
+{
+	return fCaptureCount;
+}
+
+inline bool CRegexPattern::IsJITCompiled() const
+{
+	return fJIT;
+}
+
+inline int CRegexMatch::Count() const
+{
+	return fCount;
+}
+
+inline const CRegexMatch& CRegexIterator::Match() const
+{
+	return *fMatch;
+}
+
+inline status_t CRegexIterator::Status() const
+{
+	return fStatus;
+}
+
 inline status_t CRegex::InitCheck() const
 {
 	return fInitCheck;
@@ -70,4 +205,9 @@ inline const BString& CRegex::ErrorStr() const
 	return fErrorStr;
 }
 
+inline const CRegexPattern& CRegex::Pattern() const
+{
+	return fPattern;
+}
+
 #endif
@@ -4,9 +4,55 @@
 	Released under the MIT license.
 */
 #include "TextFile.h"
+#include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <OS.h>
+#include <Path.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Files smaller than this are just read. Mapping only pays off for big ones.
+#define MAP_THRESHOLD (64 * 1024)
+
+#define WRITE_BUFFER_SIZE (64 * 1024)
+
+
+// Finds the next line feed a machine word at a time, using the usual trick
+// for spotting a zero byte in a word after XORing with a line of feeds
+static const char *
+find_line_feed(const char *start, const char *end)
+{
+	const char *c = start;
+	
+	while (c < end && ((addr_t)c & (sizeof(addr_t) - 1)) != 0)
+	{
+		if (*c == '\n')
+			return c;
+		c++;
+	}
+	
+	const addr_t kOnes = (addr_t)-1 / 0xff;
+	const addr_t kHighs = kOnes * 0x80;
+	const addr_t kFeeds = kOnes * '\n';
+	while (c + sizeof(addr_t) <= end)
+	{
+		addr_t word = *(const addr_t*)c ^ kFeeds;
+		if (((word - kOnes) & ~word & kHighs) != 0)
+			break;
+		c += sizeof(addr_t);
+	}
+	
+	while (c < end)
+	{
+		if (*c == '\n')
+			return c;
+		c++;
+	}
+	return NULL;
+}
+
 
 TextFile::TextFile(void)
 	:	BFile()
@@ -19,6 +65,7 @@ TextFile::TextFile(const char *path, const uint32 &openmode)
 	:	BFile(path,openmode)
 {
 	InitObject();
+	fPath = path;
 }
 
 
@@ -26,80 +73,250 @@ TextFile::TextFile(const entry_ref &ref, const uint32 &openmode)
 	:	BFile(&ref,openmode)
 {
 	InitObject();
+	fPath = BPath(&ref).Path();
 }
 
 
 TextFile::~TextFile(void)
 {
-	delete [] fBuffer;
-	delete [] fReadBuffer;
+	Flush();
+	FreeData();
+	free(fReadBuffer);
+	free(fWriteBuffer);
+}
+
+
+status_t
+TextFile::SetTo(const char *path, uint32 openmode)
+{
+	Flush();
+	FreeData();
+	fPath = path;
+	return BFile::SetTo(path, openmode);
+}
+
+
+status_t
+TextFile::SetTo(const entry_ref *ref, uint32 openmode)
+{
+	Flush();
+	FreeData();
+	fPath = ref ? BPath(ref).Path() : NULL;
+	return BFile::SetTo(ref, openmode);
+}
+
+
+void
+TextFile::Unset(void)
+{
+	Flush();
+	FreeData();
+	fPath = "";
+	BFile::Unset();
 }
 
 
 void
 TextFile::InitObject(void)
 {
-	fReadBuffer = new char[4096];
-	fReadBufferSize = 4096;
+	fData = NULL;
+	fDataSize = 0;
+	fReadOffset = 0;
+	fDataLoaded = false;
+	fMapped = false;
 	
-	if (InitCheck() == B_OK) {
-		GetSize(&fBufferSize);
-		fBuffer = new char[fBufferSize+1];
-		
-		Read(fBuffer,fBufferSize);
-		Seek(0,SEEK_SET);
-		
-		fBuffer[fBufferSize]=0;
-	} else {
-		fBuffer = NULL;
-		fBufferSize = 0;
-	}
+	fReadBuffer = NULL;
+	fReadBufferSize = 0;
+	
+	fWriteBuffer = NULL;
+	fWriteBufferUsed = 0;
+	fWriteError = B_OK;
 }
 
 
-const char *
-TextFile::ReadLine(void)
+void
+TextFile::FreeData(void)
 {
-	off_t pos = Position();
+	if (fMapped)
+		munmap((void*)fData, fDataSize);
+	else
+		free((void*)fData);
 	
-	char *c = fBuffer;
-	c += sizeof(char) * pos;
+	fData = NULL;
+	fDataSize = 0;
+	fReadOffset = 0;
+	fDataLoaded = false;
+	fMapped = false;
+}
+
+
+status_t
+TextFile::LoadData(void)
+{
+	// The data is only loaded on the first read so that files which are
+	// just written don't get read first
+	if (fDataLoaded)
+		return B_OK;
 	
-	char *eol = strchr(c,'\n');
+	fDataLoaded = true;
+	if (InitCheck() != B_OK)
+		return InitCheck();
 	
-	if (!eol) {
-		// This means that there are no more linefeeds before the the
-		// end of the file
-		eol = strchr(c,'\0');
-		if (!eol)
-			return NULL;
+	off_t size;
+	if (GetSize(&size) != B_OK || size <= 0)
+		return B_OK;
+	
+	if (size >= MAP_THRESHOLD && fPath.CountChars() > 0)
+	{
+		int fd = open(fPath.String(), O_RDONLY);
+		if (fd >= 0)
+		{
+			void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			close(fd);
+			if (data != MAP_FAILED)
+			{
+				fData = (const char*)data;
+				fDataSize = size;
+				fMapped = true;
+				return B_OK;
+			}
+		}
 	}
 	
-	int32 length = eol-c;
+	char *buffer = (char*)malloc(size);
+	if (!buffer)
+		return B_NO_MEMORY;
 	
-	if (length > fReadBufferSize) {
-		fReadBufferSize = length;
-		delete fReadBuffer;
-		fReadBuffer = new char[fReadBufferSize];
+	ssize_t bytesRead = ReadAt(0, buffer, size);
+	if (bytesRead < 0)
+	{
+		free(buffer);
+		return bytesRead;
 	}
 	
-	strncpy(fReadBuffer,c,length);
-	fReadBuffer[length] = 0;
+	fData = buffer;
+	fDataSize = bytesRead;
+	return B_OK;
+}
+
+
+bool
+TextFile::NextLine(const char *&line, int32 &length)
+{
+	if (LoadData() != B_OK || fReadOffset >= fDataSize)
+		return false;
+	
+	const char *start = fData + fReadOffset;
+	const char *end = fData + fDataSize;
+	const char *eol = find_line_feed(start, end);
+	if (!eol)
+		eol = end;
 	
-	Seek(length + 1, SEEK_CUR);
+	line = start;
+	length = eol - start;
+	fReadOffset = (eol < end) ? eol - fData + 1 : fDataSize;
+	return true;
+}
+
+
+const char *
+TextFile::ReadLine(void)
+{
+	const char *line;
+	int32 length;
+	if (!NextLine(line, length))
+		return NULL;
+	
+	if (length + 1 > fReadBufferSize)
+	{
+		int32 newSize = MAX(length + 1, 4096);
+		char *newBuffer = (char*)realloc(fReadBuffer, newSize);
+		if (!newBuffer)
+			return NULL;
+		fReadBuffer = newBuffer;
+		fReadBufferSize = newSize;
+	}
 	
-	// do we need to add a \0?
+	memcpy(fReadBuffer, line, length);
+	fReadBuffer[length] = 0;
 	return fReadBuffer;
 }
 
 
+void
+TextFile::Rewind(void)
+{
+	fReadOffset = 0;
+}
+
+
 ssize_t
 TextFile::WriteString(const char *string)
 {
 	if (!string)
 		return B_ERROR;
 	
-	size_t size = strlen(string);
-	return Write(string, size);
+	return WriteString(string, strlen(string));
+}
+
+
+ssize_t
+TextFile::WriteString(const char *string, size_t length)
+{
+	if (!string)
+		return B_ERROR;
+	
+	if (fWriteError != B_OK)
+		return fWriteError;
+	
+	if (!fWriteBuffer)
+	{
+		fWriteBuffer = (char*)malloc(WRITE_BUFFER_SIZE);
+		if (!fWriteBuffer)
+			return BFile::Write(string, length);
+	}
+	
+	if (fWriteBufferUsed + length > WRITE_BUFFER_SIZE)
+	{
+		status_t status = Flush();
+		if (status != B_OK)
+			return status;
+		
+		// Too big to be worth copying
+		if (length >= WRITE_BUFFER_SIZE)
+			return BFile::Write(string, length);
+	}
+	
+	memcpy(fWriteBuffer + fWriteBufferUsed, string, length);
+	fWriteBufferUsed += length;
+	return length;
 }
 
+
+status_t
+TextFile::Flush(void)
+{
+	if (fWriteBufferUsed == 0)
+		return fWriteError;
+	
+	ssize_t written = BFile::Write(fWriteBuffer, fWriteBufferUsed);
+	if (written < 0)
+		fWriteError = written;
+	else if ((size_t)written != fWriteBufferUsed)
+		fWriteError = B_IO_ERROR;
+	
+	fWriteBufferUsed = 0;
+	return fWriteError;
+}
+
+
+ssize_t
+TextFile::Write(const void *buffer, size_t size)
+{
+	// Keep things in the order they were written
+	status_t status = Flush();
+	if (status != B_OK)
+		return status;
+	
+	return BFile::Write(buffer, size);
+}
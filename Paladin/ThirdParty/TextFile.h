@@ -7,6 +7,7 @@
 #define TEXTFILE_H
 
 #include <File.h>
+#include <String.h>
 
 class TextFile : public BFile
 {
@@ -15,16 +16,48 @@ public:
 					TextFile(const char *path, const uint32 &openmode);
 					TextFile(const entry_ref &ref, const uint32 &openmode);
 					~TextFile(void);
+	
+	status_t		SetTo(const char *path, uint32 openmode);
+	status_t		SetTo(const entry_ref *ref, uint32 openmode);
+	void			Unset(void);
+	
+	// Returns the next line without its line feed, or NULL at the end of the
+	// file. The string stays valid until the next call.
 	const char *	ReadLine(void);
+	
+	// Like ReadLine(), but without copying. line points into the file's
+	// data and is not terminated. Returns false at the end of the file.
+	bool			NextLine(const char *&line, int32 &length);
+	
+	// Starts reading lines from the beginning again
+	void			Rewind(void);
+	
+	// Strings are gathered and written in large blocks. They are written out
+	// by Flush(), by Write(), and when the file is closed.
 	ssize_t			WriteString(const char *string);
+	ssize_t			WriteString(const char *string, size_t length);
+	status_t		Flush(void);
+	
+	virtual	ssize_t	Write(const void *buffer, size_t size);
 	
 private:
 	void			InitObject(void);
+	void			FreeData(void);
+	status_t		LoadData(void);
+	
+	BString			fPath;
+	const char		*fData;
+	off_t			fDataSize;
+	off_t			fReadOffset;
+	bool			fDataLoaded;
+	bool			fMapped;
 	
-	char			*fBuffer;
-	off_t			fBufferSize;
 	char			*fReadBuffer;
 	int32			fReadBufferSize;
+	
+	char			*fWriteBuffer;
+	size_t			fWriteBufferUsed;
+	status_t		fWriteError;
 };
 
 #endif
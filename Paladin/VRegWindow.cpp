@@ -99,27 +99,43 @@ VRegWindow::RunSearch(void)
 		return;
 	}
 
-	CRegex regex(fRegexTextControl->Text(), false, false, false);
-	int32 startingPosition = 0;
-	status_t result = regex.Match(fSourceView->Text(), strlen(fSourceView->Text()),
-		startingPosition, PCRE_NO_UTF8_CHECK);
+	CRegexPattern pattern(fRegexTextControl->Text());
+	if (pattern.InitCheck() != B_OK) {
+		BString error(B_TRANSLATE("Invalid regular expression:"));
+		error << "\n" << pattern.ErrorStr();
+		fMatchView->SetText(error.String());
+		return;
+	}
+
+	const char* text = fSourceView->Text();
+	CRegexIterator iterator(pattern, text, strlen(text));
 
+	// Build the output first; inserting into the view once per match is
+	// much slower than the matching itself
+	BString output;
 	int32 resultCount = 0;
-	while (result == B_OK) {
-		if (regex.MatchCount() > 0) {
-			startingPosition = regex.MatchStart(regex.MatchCount() - 1)
-				+ regex.MatchLen(regex.MatchCount() - 1) + 1;
+	while (iterator.Next()) {
+		const CRegexMatch& match = iterator.Match();
+		for (int32 i = 0; i < match.Count(); i++) {
+			output << resultCount << ":\t";
+			if (match.Len(i) > 0)
+				output.Append(text + match.Start(i), match.Len(i));
 		}
-
-		BString match;
-		for (int32 i = 0; i < regex.MatchCount(); i++)
-			match << resultCount << ":\t" << regex.MatchStr(fSourceView->Text(), i);
-
-		match << "\n";
-		fMatchView->Insert(match.String());
-		result = regex.Match(fSourceView->Text(), strlen(fSourceView->Text()),
-			startingPosition, PCRE_NO_UTF8_CHECK);
-
+		output << "\n";
 		resultCount++;
 	}
+
+	if (iterator.Status() != B_OK) {
+		if (iterator.Status() == PCRE_ERROR_BADUTF8)
+			output << B_TRANSLATE("The text is not valid UTF-8.");
+		else {
+			BString error(B_TRANSLATE("Matching failed with error %error%."));
+			BString code;
+			code << (int32)iterator.Status();
+			error.ReplaceFirst("%error%", code);
+			output << error;
+		}
+		output << "\n";
+	}
+	fMatchView->SetText(output.String());
 }